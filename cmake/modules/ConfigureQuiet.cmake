@@ -0,0 +1,30 @@
+include_guard(DIRECTORY)
+
+#
+# usage:
+#   configure_quiet_scope()
+#
+# With CONFIGURE_QUIET on, drops the STATUS and VERBOSE messages of the calling function and everything it
+# calls (per-target "** ..." lines, flag probes), warnings and errors still show. Call it at the top of a function,
+# the log level goes back when the function returns. An explicit CMAKE_MESSAGE_LOG_LEVEL is left alone.
+#
+macro(configure_quiet_scope)
+    if (CONFIGURE_QUIET AND NOT DEFINED CACHE{CMAKE_MESSAGE_LOG_LEVEL})
+        set(CMAKE_MESSAGE_LOG_LEVEL NOTICE)
+    endif ()
+endmacro()
+
+#
+# usage:
+#   status_once(KEY MESSAGE)
+#
+# Prints MESSAGE as a STATUS line the first time KEY is given in this configure run, for notes every target
+# would otherwise repeat. Prefix KEY with the module name (BOLT_NOT_FOUND, LEAN_NO_ICF, ...).
+#
+function(status_once KEY MESSAGE)
+    get_property(_printed GLOBAL PROPERTY _STATUS_ONCE_${KEY})
+    if (NOT _printed)
+        set_property(GLOBAL PROPERTY _STATUS_ONCE_${KEY} TRUE)
+        message(STATUS "${MESSAGE}")
+    endif ()
+endfunction()
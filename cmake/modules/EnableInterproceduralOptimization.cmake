@@ -1,16 +1,28 @@
 include_guard(DIRECTORY)
 include(CheckIPOSupported)
+include(CheckLinkerFlag)
+include(GetCurrentCompiler)
+include(ToolchainProfile)
 
 #
 # usage:
 #   enable_global_interprocedural_optimization()
 #
 function(enable_global_interprocedural_optimization)
-    check_ipo_supported(RESULT result OUTPUT output)
+    _check_ipo_supported_cached(result output)
 
     if (result)
         set(CMAKE_INTERPROCEDURAL_OPTIMIZATION ON PARENT_SCOPE)
         message(STATUS "** Global IPO enabled: ${output}")
+
+        # Only targets that keep INTERPROCEDURAL_OPTIMIZATION on get the LTO mode/cache flags
+        _get_lto_options(LTO_COMPILE_OPTIONS LTO_LINK_OPTIONS)
+        foreach (_option ${LTO_COMPILE_OPTIONS})
+            add_compile_options("$<$<BOOL:$<TARGET_PROPERTY:INTERPROCEDURAL_OPTIMIZATION>>:${_option}>")
+        endforeach ()
+        foreach (_option ${LTO_LINK_OPTIONS})
+            add_link_options("$<$<BOOL:$<TARGET_PROPERTY:INTERPROCEDURAL_OPTIMIZATION>>:${_option}>")
+        endforeach ()
     else ()
         message(STATUS "** IPO is not supported: ${output}")
     endif ()
@@ -25,14 +37,150 @@ function(target_enable_interprocedural_optimization TARGET_NAME)
         message(FATAL_ERROR "target_enable_interprocedural_optimization: Target '${TARGET_NAME}' does not exist")
     endif ()
 
-    check_ipo_supported(RESULT result OUTPUT output)
+    # Linker.cmake only rules out gold for global IPO
+    get_current_compiler(CURRENT_COMPILER)
+    string(TOLOWER "${IPO_LTO_MODE}" _mode)
+    if ("${LINKER_SELECTED}" STREQUAL "gold" AND "${CURRENT_COMPILER}" MATCHES "^CLANG" AND NOT _mode STREQUAL "full")
+        message(FATAL_ERROR "target_enable_interprocedural_optimization: '${TARGET_NAME}' would link ThinLTO with gold, use LINKER=lld/mold or IPO_LTO_MODE=full")
+    endif ()
+
+    _check_ipo_supported_cached(result output)
 
     if (result)
         set_target_properties(${TARGET_NAME} PROPERTIES
                 INTERPROCEDURAL_OPTIMIZATION TRUE
         )
-        message(STATUS "** IPO enabled for target '${TARGET_NAME}': ${output}")
+
+        # Global IPO already added the mode/cache flags to every target in the directory tree
+        if (NOT CMAKE_INTERPROCEDURAL_OPTIMIZATION)
+            _get_lto_options(LTO_COMPILE_OPTIONS LTO_LINK_OPTIONS)
+            if (LTO_COMPILE_OPTIONS)
+                target_compile_options(${TARGET_NAME} PRIVATE ${LTO_COMPILE_OPTIONS})
+            endif ()
+            if (LTO_LINK_OPTIONS)
+                target_link_options(${TARGET_NAME} PRIVATE ${LTO_LINK_OPTIONS})
+            endif ()
+        endif ()
+        message(STATUS "** IPO enabled for target '${TARGET_NAME}'")
     else ()
         message(STATUS "** IPO is not supported for target '${TARGET_NAME}': ${output}")
     endif ()
 endfunction()
+
+#
+
+# Helper function to run check_ipo_supported() once per compiler/language/configuration, kept in the toolchain profile.
+# The try-project compiles and links, which is far too slow to repeat for every target.
+function(_check_ipo_supported_cached RESULT_VAR OUTPUT_VAR)
+    get_property(_languages GLOBAL PROPERTY ENABLED_LANGUAGES)
+    set(_ipo_languages "")
+    foreach (_lang C CXX Fortran)
+        if (_lang IN_LIST _languages)
+            list(APPEND _ipo_languages ${_lang})
+        endif ()
+    endforeach ()
+
+    # The toolchain profile is dropped when the compiler changes, the key covers the rest
+    string(MD5 _key "${_ipo_languages};${CMAKE_BUILD_TYPE};${CMAKE_LINKER};${LINKER_SELECTED}")
+    string(SUBSTRING "${_key}" 0 12 _key)
+
+    toolchain_profile_get(IPO_SUPPORTED_${_key} _result)
+    toolchain_profile_get(IPO_OUTPUT_${_key} _output)
+    if (NOT _result_FOUND)
+        check_ipo_supported(RESULT _result OUTPUT _output LANGUAGES ${_ipo_languages})
+        if (_result)
+            set(_output "supported (${CMAKE_CXX_COMPILER_ID} ${CMAKE_CXX_COMPILER_VERSION}, ${_ipo_languages})")
+        endif ()
+        toolchain_profile_set(IPO_SUPPORTED_${_key} "${_result}")
+        toolchain_profile_set(IPO_OUTPUT_${_key} "${_output}")
+    endif ()
+
+    set(${RESULT_VAR} "${_result}" PARENT_SCOPE)
+    set(${OUTPUT_VAR} "${_output}" PARENT_SCOPE)
+endfunction()
+
+# Helper function to get the flags selecting the LTO flavour (IPO_LTO_MODE) and its incremental cache (IPO_LTO_CACHE_DIR)
+function(_get_lto_options COMPILE_OPTIONS_VAR LINK_OPTIONS_VAR)
+    get_current_compiler(CURRENT_COMPILER)
+    string(TOLOWER "${IPO_LTO_MODE}" _mode)
+
+    set(_compile_options "")
+    set(_link_options "")
+
+    if ("${CURRENT_COMPILER}" MATCHES "^CLANG")
+        # CMake defaults Clang to ThinLTO, make the chosen mode explicit
+        if (_mode STREQUAL "full")
+            list(APPEND _compile_options -flto=full)
+            if (NOT "${CURRENT_COMPILER}" STREQUAL "CLANG-MSVC")
+                list(APPEND _link_options -flto=full)
+            endif ()
+        else ()
+            list(APPEND _compile_options -flto=thin)
+            if (NOT "${CURRENT_COMPILER}" STREQUAL "CLANG-MSVC")
+                list(APPEND _link_options -flto=thin)
+            endif ()
+            _get_thinlto_cache_option("${CURRENT_COMPILER}" _cache_option)
+            list(APPEND _link_options ${_cache_option})
+        endif ()
+
+    elseif ("${CURRENT_COMPILER}" STREQUAL "GCC")
+        if (_mode STREQUAL "thin")
+            message(STATUS "** ThinLTO is not available with GCC, using full LTO")
+        endif ()
+        if (IPO_LTO_CACHE_DIR)
+            check_linker_flag(CXX "-flto-incremental=${IPO_LTO_CACHE_DIR}" LINKER_SUPPORTS_LTO_INCREMENTAL)
+            if (LINKER_SUPPORTS_LTO_INCREMENTAL)
+                file(MAKE_DIRECTORY "${IPO_LTO_CACHE_DIR}")
+                list(APPEND _link_options "-flto-incremental=${IPO_LTO_CACHE_DIR}")
+            endif ()
+        endif ()
+
+    elseif ("${CURRENT_COMPILER}" STREQUAL "MSVC")
+        # Incremental LTCG only recompiles functions whose code changed. Its state lives in .iobj/.ipdb files
+        # beside the objects and the linker takes no directory for it, so IPO_LTO_CACHE_DIR is not used here
+        if (IPO_MSVC_INCREMENTAL_LTCG)
+            list(APPEND _link_options /LTCG:INCREMENTAL)
+        endif ()
+    endif ()
+
+    set(${COMPILE_OPTIONS_VAR} ${_compile_options} PARENT_SCOPE)
+    set(${LINK_OPTIONS_VAR} ${_link_options} PARENT_SCOPE)
+endfunction()
+
+# Helper function to find the ThinLTO cache flag understood by the active linker
+function(_get_thinlto_cache_option CURRENT_COMPILER RESULT_VAR)
+    set(${RESULT_VAR} "" PARENT_SCOPE)
+    if (NOT IPO_LTO_CACHE_DIR)
+        return()
+    endif ()
+    file(MAKE_DIRECTORY "${IPO_LTO_CACHE_DIR}")
+
+    if ("${CURRENT_COMPILER}" STREQUAL "CLANG-MSVC")
+        set(${RESULT_VAR} "/lldltocache:${IPO_LTO_CACHE_DIR}" PARENT_SCOPE)
+        return()
+    endif ()
+
+    # lld, ld64 and gold/bfd (LLVM plugin) spell the cache option differently, probe once
+    set(_candidates
+            "LLD|LINKER:--thinlto-cache-dir=${IPO_LTO_CACHE_DIR}"
+            "LD64|LINKER:-cache_path_lto,${IPO_LTO_CACHE_DIR}"
+            "PLUGIN|LINKER:-plugin-opt,cache-dir=${IPO_LTO_CACHE_DIR}"
+    )
+    foreach (_candidate ${_candidates})
+        string(REPLACE "|" ";" _candidate "${_candidate}")
+        list(GET _candidate 0 _name)
+        list(GET _candidate 1 _flag)
+        set(_result_var LINKER_SUPPORTS_THINLTO_CACHE_${_name})
+        if (LINKER_SELECTED_FLAG)
+            string(TOUPPER "${LINKER_SELECTED}" _linker)
+            set(_result_var ${_result_var}_${_linker})
+        endif ()
+        check_linker_flag(CXX "${LINKER_SELECTED_FLAG};-flto=thin;${_flag}" ${_result_var})
+        if (${_result_var})
+            set(${RESULT_VAR} "${_flag}" PARENT_SCOPE)
+            return()
+        endif ()
+    endforeach ()
+
+    message(STATUS "** The active linker has no known ThinLTO cache option, IPO_LTO_CACHE_DIR ignored")
+endfunction()
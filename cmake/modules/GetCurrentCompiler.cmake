@@ -25,6 +25,33 @@ function(get_current_compiler OUTPUT_VARIABLE)
         set(UNKNOWN_COMPILER "${ARG_DEFAULT}")
     endif ()
 
+    # The toolchain profile (load_toolchain_profile()) already detected it for this configure run
+    get_property(_profile_loaded GLOBAL PROPERTY _TOOLCHAIN_PROFILE_LOADED)
+    if (_profile_loaded)
+        set(DETECTED_COMPILER "${_TOOLCHAIN_PROFILE_COMPILER}")
+        set(COMPILER_VERSION "${_TOOLCHAIN_PROFILE_COMPILER_VERSION}")
+    else ()
+        _detect_current_compiler(DETECTED_COMPILER COMPILER_VERSION)
+    endif ()
+    if (DETECTED_COMPILER STREQUAL "")
+        set(DETECTED_COMPILER "${UNKNOWN_COMPILER}")
+    endif ()
+
+    # Add version info if requested
+    if (ARG_INCLUDE_VERSION AND
+            NOT DETECTED_COMPILER STREQUAL "${UNKNOWN_COMPILER}" AND
+            DEFINED COMPILER_VERSION)
+        set(DETECTED_COMPILER "${DETECTED_COMPILER}-${COMPILER_VERSION}")
+    endif ()
+
+    # Set the output variable in the parent scope
+    set(${OUTPUT_VARIABLE} "${DETECTED_COMPILER}" PARENT_SCOPE)
+endfunction()
+
+#
+
+# Helper function to detect the compiler from CMAKE_CXX_COMPILER_ID, empty when unsupported
+function(_detect_current_compiler COMPILER_VAR VERSION_VAR)
     if ("${CMAKE_CXX_COMPILER_ID}" STREQUAL "MSVC")
         set(DETECTED_COMPILER "MSVC")
         set(COMPILER_VERSION ${MSVC_VERSION})
@@ -52,17 +79,10 @@ function(get_current_compiler OUTPUT_VARIABLE)
 
     else ()
         message(WARNING "Unsupported compiler: ${CMAKE_CXX_COMPILER_ID}")
-        set(DETECTED_COMPILER "${UNKNOWN_COMPILER}")
+        set(DETECTED_COMPILER "")
         set(COMPILER_VERSION "")
     endif ()
 
-    # Add version info if requested
-    if (ARG_INCLUDE_VERSION AND
-            NOT DETECTED_COMPILER STREQUAL "${UNKNOWN_COMPILER}" AND
-            DEFINED COMPILER_VERSION)
-        set(DETECTED_COMPILER "${DETECTED_COMPILER}-${COMPILER_VERSION}")
-    endif ()
-
-    # Set the output variable in the parent scope
-    set(${OUTPUT_VARIABLE} "${DETECTED_COMPILER}" PARENT_SCOPE)
-endfunction()
\ No newline at end of file
+    set(${COMPILER_VAR} "${DETECTED_COMPILER}" PARENT_SCOPE)
+    set(${VERSION_VAR} "${COMPILER_VERSION}" PARENT_SCOPE)
+endfunction()
@@ -0,0 +1,24 @@
+include_guard(DIRECTORY)
+
+#
+# usage:
+#   get_user_cache_directory(SUBDIR RESULT_VAR)
+#
+# Sets RESULT_VAR to <user cache>/cmake-initializer/SUBDIR, shared by every build tree of the user:
+#   $XDG_CACHE_HOME, then %LOCALAPPDATA%, then ~/.cache
+# RESULT_VAR is empty when none of them is defined.
+#
+function(get_user_cache_directory SUBDIR RESULT_VAR)
+    if (DEFINED ENV{XDG_CACHE_HOME})
+        set(_root "$ENV{XDG_CACHE_HOME}")
+    elseif (DEFINED ENV{LOCALAPPDATA})
+        file(TO_CMAKE_PATH "$ENV{LOCALAPPDATA}" _root)
+    elseif (DEFINED ENV{HOME})
+        set(_root "$ENV{HOME}/.cache")
+    else ()
+        set(${RESULT_VAR} "" PARENT_SCOPE)
+        return()
+    endif ()
+
+    set(${RESULT_VAR} "${_root}/cmake-initializer/${SUBDIR}" PARENT_SCOPE)
+endfunction()
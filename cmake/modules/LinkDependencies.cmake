@@ -1,4 +1,6 @@
 include_guard(DIRECTORY)
+include(TargetDependencyClosure)
+include(TargetRuntimeDependencies)
 
 #
 # Helper function to link dependencies and handle all shared library management
@@ -53,52 +55,17 @@ function(_target_copy_all_dependencies TARGET_NAME)
 
     # Collect all shared library dependencies
     set(shared_deps "")
-    set(visited_targets "")
     set(external_dlls "")
 
-    # Function to collect all dependency targets recursively
-    function(collect_all_deps target_name)
-        # Avoid infinite recursion
-        if (target_name IN_LIST visited_targets)
-            return()
-        endif ()
-        list(APPEND visited_targets ${target_name})
-
-        if (TARGET ${target_name})
-            get_target_property(target_type ${target_name} TYPE)
-
-            # Collect shared libraries
-            if (target_type STREQUAL "SHARED_LIBRARY")
-                list(APPEND shared_deps ${target_name})
-            endif ()
-
-            # Check this target's dependencies
-            get_target_property(target_deps ${target_name} LINK_LIBRARIES)
-            if (target_deps)
-                foreach (dep ${target_deps})
-                    collect_all_deps(${dep})
-                endforeach ()
-            endif ()
-
-            # Check interface dependencies
-            get_target_property(interface_deps ${target_name} INTERFACE_LINK_LIBRARIES)
-            if (interface_deps)
-                foreach (dep ${interface_deps})
-                    if (TARGET ${dep})
-                        collect_all_deps(${dep})
-                    endif ()
-                endforeach ()
-            endif ()
+    foreach (lib ${targets_to_process})
+        _resolve_dependency_target(${lib} lib)
+        get_target_property(lib_type ${lib} TYPE)
+        if (lib_type STREQUAL "SHARED_LIBRARY")
+            list(APPEND shared_deps ${lib})
         endif ()
 
-        # Propagate results back to parent scope
-        set(shared_deps ${shared_deps} PARENT_SCOPE)
-        set(visited_targets ${visited_targets} PARENT_SCOPE)
-        set(external_dlls ${external_dlls} PARENT_SCOPE)
-    endfunction()
-
-    foreach (lib ${targets_to_process})
-        collect_all_deps(${lib})
+        get_target_shared_dependencies(${lib} lib_shared_deps)
+        list(APPEND shared_deps ${lib_shared_deps})
     endforeach ()
 
     # Remove duplicates
@@ -107,16 +74,8 @@ function(_target_copy_all_dependencies TARGET_NAME)
     endif ()
 
     # Copy all shared libraries
+    target_copy_runtime_dependencies(${TARGET_NAME} TARGETS ${shared_deps})
     foreach (shared_lib ${shared_deps})
-        add_custom_command(
-                TARGET ${TARGET_NAME} POST_BUILD
-                COMMAND ${CMAKE_COMMAND} -E copy_if_different
-                "$<TARGET_FILE:${shared_lib}>"
-                "$<TARGET_FILE_DIR:${TARGET_NAME}>"
-                COMMENT "Copying shared library: $<TARGET_FILE_NAME:${shared_lib}>"
-                VERBATIM
-        )
-
         # Install shared library
         install(FILES "$<TARGET_FILE:${shared_lib}>"
                 DESTINATION ${CMAKE_INSTALL_BINDIR}
@@ -130,14 +89,7 @@ function(_target_copy_all_dependencies TARGET_NAME)
         list(GET dll_parts 0 dll_path)
         list(GET dll_parts 1 dll_name)
 
-        add_custom_command(
-                TARGET ${TARGET_NAME} POST_BUILD
-                COMMAND ${CMAKE_COMMAND} -E copy_if_different
-                "${dll_path}"
-                "$<TARGET_FILE_DIR:${TARGET_NAME}>"
-                COMMENT "Copying external dependency: ${dll_name}"
-                VERBATIM
-        )
+        target_copy_runtime_dependencies(${TARGET_NAME} FILES "${dll_path}")
 
         # Install external DLL
         install(FILES "${dll_path}"
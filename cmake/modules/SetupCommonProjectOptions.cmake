@@ -1,9 +1,16 @@
 include_guard(DIRECTORY)
 include(CompilerWarnings)
+include(TargetExceptions)
+include(EnableInterproceduralOptimization)
 include(TargetHardening)
 include(TargetSanitizers)
 include(StaticAnalysis)
 include(StaticLinking)
+include(TargetPrecompiledHeaders)
+include(TargetUnityBuild)
+include(TargetBuildProfiling)
+include(TargetProfiler)
+include(ConfigureQuiet)
 
 #
 # Apply common project options to a target
@@ -18,8 +25,17 @@ include(StaticLinking)
 #   [ENABLE_SANITIZER_THREAD ON/OFF]             # Override thread sanitizer setting
 #   [ENABLE_SANITIZER_MEMORY ON/OFF]             # Override memory sanitizer setting
 #   [ENABLE_HARDENING ON/OFF]                    # Override hardening setting
+#   [HARDENING_LEVEL none/lightweight/full]      # Override HARDENING_LEVEL
 #   [ENABLE_CLANG_TIDY ON/OFF]                   # Override clang-tidy setting
 #   [ENABLE_CPPCHECK ON/OFF]                     # Override cppcheck setting
+#   [ENABLE_PCH ON/OFF]                          # Override precompiled headers setting
+#   [PRECOMPILE_HEADERS <header> ...]            # Headers to precompile for this target
+#   [REUSE_PCH_FROM <target>]                    # Reuse the PCH of another target
+#   [ENABLE_UNITY_BUILD ON/OFF]                  # Override unity build setting
+#   [UNITY_BATCH_SIZE <n>]                       # Sources per unity file
+#   [UNITY_EXCLUDE <source> ...]                 # Sources kept out of unity files
+#   [ENABLE_BUILD_PROFILING ON/OFF]              # Override compile time tracing (build-profile target)
+#   [ENABLE_PROFILER none/tracy/perfetto/itt]    # Override the runtime profiler
 # )
 #
 function(target_setup_common_options TARGET_NAME)
@@ -33,17 +49,26 @@ function(target_setup_common_options TARGET_NAME)
             ENABLE_SANITIZER_THREAD
             ENABLE_SANITIZER_MEMORY
             ENABLE_HARDENING
+            HARDENING_LEVEL
             ENABLE_CLANG_TIDY
             ENABLE_CPPCHECK
             ENABLE_PCH
             ENABLE_UNITY_BUILD
+            ENABLE_BUILD_PROFILING
+            ENABLE_PROFILER
+            REUSE_PCH_FROM
+            UNITY_BATCH_SIZE
+    )
+    set(multiValueArgs
+            PRECOMPILE_HEADERS
+            UNITY_EXCLUDE
     )
 
     cmake_parse_arguments(
             ARG
             ""
             "${oneValueArgs}"
-            ""
+            "${multiValueArgs}"
             ${ARGN}
     )
 
@@ -52,6 +77,7 @@ function(target_setup_common_options TARGET_NAME)
     if (NOT TARGET ${TARGET_NAME})
         message(FATAL_ERROR "Target ${TARGET_NAME} does not exist")
     endif ()
+    configure_quiet_scope()
 
     # Configure exceptions (per-target override or use global setting)
     set(ENABLE_EXCEPTIONS_VALUE ${ENABLE_GLOBAL_EXCEPTIONS})
@@ -60,7 +86,6 @@ function(target_setup_common_options TARGET_NAME)
     endif ()
 
     if (ENABLE_EXCEPTIONS_VALUE)
-        include(TargetExceptions)
         target_configure_exceptions(${TARGET_NAME} ${ENABLE_EXCEPTIONS_VALUE})
     endif ()
 
@@ -71,7 +96,6 @@ function(target_setup_common_options TARGET_NAME)
     endif ()
 
     if (ENABLE_IPO_VALUE)
-        include(EnableInterproceduralOptimization)
         target_enable_interprocedural_optimization(${TARGET_NAME})
     endif ()
 
@@ -127,7 +151,6 @@ function(target_setup_common_options TARGET_NAME)
     endif ()
 
     if (NOT "${SANITIZER_ARGS}" STREQUAL "")
-        include(TargetSanitizers)
         target_enable_sanitizers(${TARGET_NAME} ${SANITIZER_ARGS})
     endif ()
 
@@ -138,8 +161,11 @@ function(target_setup_common_options TARGET_NAME)
     endif ()
 
     if (ENABLE_HARDENING_VALUE)
-        include(TargetHardening)
-        target_enable_hardening(${TARGET_NAME} PRIVATE)
+        set(HARDENING_ARGS "")
+        if (DEFINED ARG_HARDENING_LEVEL)
+            list(APPEND HARDENING_ARGS LEVEL ${ARG_HARDENING_LEVEL})
+        endif ()
+        target_enable_hardening(${TARGET_NAME} PRIVATE ${HARDENING_ARGS})
     endif ()
 
     # Configure static analysis (per-target override or use global settings)
@@ -152,7 +178,6 @@ function(target_setup_common_options TARGET_NAME)
     endif ()
 
     if (ENABLE_CLANG_TIDY_VALUE OR ENABLE_CPPCHECK_VALUE)
-        include(StaticAnalysis)
         set(STATIC_ANALYSIS_ARGS)
         if (ENABLE_CLANG_TIDY_VALUE)
             list(APPEND STATIC_ANALYSIS_ARGS ENABLE_CLANG_TIDY)
@@ -172,18 +197,48 @@ function(target_setup_common_options TARGET_NAME)
 
     # Enable static linking if needed
     if (ENABLE_STATIC_RUNTIME)
-        include(StaticLinking)
         targets_enable_static_linking(
                 TARGETS ${TARGET_NAME}
         )
     endif ()
 
-    # Enable unity build if needed
-    if (ARG_ENABLE_UNITY_BUILD)
-        set_target_properties(
-                ${TARGET_NAME}
-                PROPERTIES
-                UNITY_BUILD ${ARG_ENABLE_UNITY_BUILD}
-        )
+    # Configure precompiled headers (no-op if register_*() already configured them)
+    set(PCH_ARGS "")
+    if (DEFINED ARG_ENABLE_PCH)
+        list(APPEND PCH_ARGS ENABLE ${ARG_ENABLE_PCH})
+    endif ()
+    if (ARG_PRECOMPILE_HEADERS)
+        list(APPEND PCH_ARGS HEADERS ${ARG_PRECOMPILE_HEADERS})
+    endif ()
+    if (DEFINED ARG_REUSE_PCH_FROM)
+        list(APPEND PCH_ARGS REUSE_FROM ${ARG_REUSE_PCH_FROM})
+    endif ()
+    target_enable_precompiled_headers(${TARGET_NAME} ${PCH_ARGS})
+
+    # Configure unity build (no-op if register_*() already configured it)
+    set(UNITY_ARGS "")
+    if (DEFINED ARG_ENABLE_UNITY_BUILD)
+        list(APPEND UNITY_ARGS ENABLE ${ARG_ENABLE_UNITY_BUILD})
+    endif ()
+    if (DEFINED ARG_UNITY_BATCH_SIZE)
+        list(APPEND UNITY_ARGS BATCH_SIZE ${ARG_UNITY_BATCH_SIZE})
+    endif ()
+    if (ARG_UNITY_EXCLUDE)
+        list(APPEND UNITY_ARGS EXCLUDE ${ARG_UNITY_EXCLUDE})
+    endif ()
+    target_enable_unity_build(${TARGET_NAME} ${UNITY_ARGS})
+
+    # Configure compile time tracing (no-op if register_*() already configured it)
+    set(PROFILING_ARGS "")
+    if (DEFINED ARG_ENABLE_BUILD_PROFILING)
+        list(APPEND PROFILING_ARGS ENABLE ${ARG_ENABLE_BUILD_PROFILING})
+    endif ()
+    target_enable_build_profiling(${TARGET_NAME} ${PROFILING_ARGS})
+
+    # Configure the runtime profiler (no-op if register_*() already configured it)
+    set(PROFILER_ARGS "")
+    if (DEFINED ARG_ENABLE_PROFILER)
+        list(APPEND PROFILER_ARGS PROFILER ${ARG_ENABLE_PROFILER})
     endif ()
+    target_enable_profiler(${TARGET_NAME} ${PROFILER_ARGS})
 endfunction()
@@ -1,4 +1,5 @@
 include_guard(DIRECTORY)
+include(GetCurrentCompiler)
 
 #
 # usage:
@@ -8,6 +9,11 @@ include_guard(DIRECTORY)
 #   [ENABLE_EXCEPTIONS]
 # )
 #
+# clang-tidy runs according to CLANG_TIDY_MODE:
+#   target  - <target>_tidy build target (and the global tidy target), one job per translation unit, results
+#             cached in CLANG_TIDY_CACHE_DIR by hash of the preprocessed source, .clang-tidy and the command line
+#   compile - with every compile of the target (CXX_CLANG_TIDY)
+#
 function(target_enable_static_analysis TARGET_NAME)
     set(options
             ENABLE_CLANG_TIDY
@@ -36,7 +42,7 @@ endfunction()
 
 #
 
-# Helper function to create clang-tidy custom targets
+# Helper function to set up clang-tidy for a target according to CLANG_TIDY_MODE
 function(_configure_clang_tidy TARGET_NAME ENABLE_EXCEPTIONS)
     _find_clang_tidy(CLANG_TIDY_EXE)
     if (NOT CLANG_TIDY_EXE)
@@ -44,20 +50,150 @@ function(_configure_clang_tidy TARGET_NAME ENABLE_EXCEPTIONS)
         return()
     endif ()
 
-    message(STATUS "** clang-tidy found: ${CLANG_TIDY_EXE}")
-    _add_clang_tidy_custom_target(${TARGET_NAME} ${ENABLE_EXCEPTIONS} ${CLANG_TIDY_EXE})
+    string(TOLOWER "${CLANG_TIDY_MODE}" _mode)
+    if (_mode STREQUAL "")
+        set(_mode "target")
+    endif ()
+    if (NOT _mode MATCHES "^(target|compile)$")
+        message(FATAL_ERROR "Unknown CLANG_TIDY_MODE '${CLANG_TIDY_MODE}' (expected target or compile)")
+    endif ()
+
+    if (_mode STREQUAL "compile")
+        _add_clang_tidy_custom_target(${TARGET_NAME} ${ENABLE_EXCEPTIONS} ${CLANG_TIDY_EXE})
+    else ()
+        # Sources added after register_*() returns are only known at the end of the directory.
+        # Deferred arguments are expanded when the call runs, so the values are baked in here.
+        if (NOT ENABLE_EXCEPTIONS)
+            set(ENABLE_EXCEPTIONS OFF)
+        endif ()
+        cmake_language(EVAL CODE "cmake_language(DEFER CALL _add_clang_tidy_build_target [[${TARGET_NAME}]] [[${ENABLE_EXCEPTIONS}]] [[${CLANG_TIDY_EXE}]])")
+    endif ()
 endfunction()
 
-# Helper function to create clang-tidy custom targets
+# Helper function to run clang-tidy with every compile of a target
 function(_add_clang_tidy_custom_target TARGET_NAME ENABLE_EXCEPTIONS CLANG_TIDY_EXE)
     if (NOT CLANG_TIDY_EXE)
         return()
     endif ()
 
-    # Build clang-tidy arguments
-    set(CXX_CLANG_TIDY_ARGS "${CLANG_TIDY_EXE}")
-    list(APPEND CXX_CLANG_TIDY_ARGS "--config-file=${PROJECT_SOURCE_DIR}/.clang-tidy")
-    file(RELATIVE_PATH BINARY_DIR_RELATIVE "${PROJECT_SOURCE_DIR}" "${CMAKE_BINARY_DIR}")
+    _get_clang_tidy_arguments(CXX_CLANG_TIDY_ARGS ${ENABLE_EXCEPTIONS})
+    set_target_properties(${TARGET_NAME} PROPERTIES
+            CXX_CLANG_TIDY "${CLANG_TIDY_EXE};${CXX_CLANG_TIDY_ARGS}"
+    )
+
+    if (MSVC)
+        set_property(TARGET ${TARGET_NAME} PROPERTY VS_GLOBAL_EnableMicrosoftCodeAnalysis false)
+        set_property(TARGET ${TARGET_NAME} PROPERTY VS_GLOBAL_EnableClangTidyCodeAnalysis true)
+        set_property(TARGET ${TARGET_NAME} PROPERTY VS_GLOBAL_RunCodeAnalysis true)
+    endif ()
+endfunction()
+
+# Helper function to add <target>_tidy, one cached clang-tidy run per C++ source of the target,
+# and to hook it into the global tidy target
+function(_add_clang_tidy_build_target TARGET_NAME ENABLE_EXCEPTIONS CLANG_TIDY_EXE)
+    if (TARGET ${TARGET_NAME}_tidy)
+        return()
+    endif ()
+
+    get_target_property(_sources ${TARGET_NAME} SOURCES)
+    get_target_property(_source_dir ${TARGET_NAME} SOURCE_DIR)
+    set(_tidy_sources "")
+    foreach (_source ${_sources})
+        # Generator expressions ($<TARGET_OBJECTS:...>) and generated files have nothing to lint
+        if (_source MATCHES "\\$<" OR NOT _source MATCHES "\\.(cpp|cc|cxx|c\\+\\+)$")
+            continue()
+        endif ()
+        get_filename_component(_source "${_source}" ABSOLUTE BASE_DIR "${_source_dir}")
+        get_source_file_property(_generated "${_source}" TARGET_DIRECTORY ${TARGET_NAME} GENERATED)
+        string(FIND "${_source}" "${CMAKE_BINARY_DIR}/" _in_binary_dir)
+        if (_generated OR _in_binary_dir EQUAL 0)
+            continue()
+        endif ()
+        list(APPEND _tidy_sources "${_source}")
+    endforeach ()
+    if (NOT _tidy_sources)
+        return()
+    endif ()
+
+    _write_clang_tidy_script(_script)
+    set(_dir "${CMAKE_CURRENT_BINARY_DIR}/CMakeFiles/${TARGET_NAME}_tidy.dir")
+    set(_flags_file "${_dir}/flags-$<CONFIG>.txt")
+    _get_clang_tidy_compile_flags(${TARGET_NAME} _compile_flags)
+    # Evaluated once per enabled language, $<COMPILE_LANGUAGE> options would write different contents otherwise
+    file(GENERATE OUTPUT "${_flags_file}" CONTENT "${_compile_flags}" CONDITION "$<COMPILE_LANGUAGE:CXX>" TARGET ${TARGET_NAME})
+
+    _get_clang_tidy_arguments(_tidy_args ${ENABLE_EXCEPTIONS})
+    string(REPLACE ";" "|" _tidy_args "${_tidy_args}")
+    set(_config_file "${PROJECT_SOURCE_DIR}/.clang-tidy")
+    set(_config_depends "")
+    if (EXISTS "${_config_file}")
+        set(_config_depends "${_config_file}")
+    endif ()
+
+    # GNU-style drivers write the include dependencies while preprocessing, so unchanged units are not even
+    # started. Other drivers run every time and rely on the result cache.
+    set(_depfile_supported FALSE)
+    if (NOT CMAKE_CXX_COMPILER_FRONTEND_VARIANT STREQUAL "MSVC" AND NOT MSVC
+            AND CMAKE_GENERATOR MATCHES "Ninja|Makefiles")
+        set(_depfile_supported TRUE)
+    endif ()
+
+    set(_job_pool "")
+    if (CLANG_TIDY_JOBS GREATER 0 AND CMAKE_GENERATOR MATCHES "Ninja")
+        # Ninja rejects a pool defined twice, keep a clang_tidy pool the project defined itself
+        get_property(_pools GLOBAL PROPERTY JOB_POOLS)
+        if (NOT "${_pools};${CMAKE_JOB_POOLS}" MATCHES "(^|;)clang_tidy=")
+            set_property(GLOBAL APPEND PROPERTY JOB_POOLS clang_tidy=${CLANG_TIDY_JOBS})
+        endif ()
+        set(_job_pool JOB_POOL clang_tidy)
+    endif ()
+
+    set(_stamps "")
+    foreach (_source ${_tidy_sources})
+        file(RELATIVE_PATH _relative "${_source_dir}" "${_source}")
+        string(REPLACE "../" "__/" _relative "${_relative}")
+        set(_stamp "${_dir}/${_relative}.tidy")
+
+        set(_depfile_args "")
+        if (_depfile_supported)
+            set(_depfile_args DEPFILE "${_stamp}.d")
+        else ()
+            set_source_files_properties("${_stamp}" PROPERTIES SYMBOLIC TRUE)
+        endif ()
+
+        add_custom_command(
+                OUTPUT "${_stamp}"
+                COMMAND ${CMAKE_COMMAND}
+                "-DSOURCE=${_source}"
+                "-DSTAMP=${_stamp}"
+                "-DFLAGS_FILE=${_flags_file}"
+                "-DCOMPILER=${CMAKE_CXX_COMPILER}"
+                "-DMSVC_DRIVER=$<BOOL:${MSVC}>"
+                "-DDEPFILE=${_depfile_supported}"
+                "-DCLANG_TIDY=${CLANG_TIDY_EXE}"
+                "-DCLANG_TIDY_ARGS=${_tidy_args}"
+                "-DCONFIG_FILE=${_config_file}"
+                "-DCACHE_DIR=${CLANG_TIDY_CACHE_DIR}"
+                -P "${_script}"
+                DEPENDS "${_source}" "${_flags_file}" "${_script}" ${_config_depends}
+                ${_depfile_args}
+                ${_job_pool}
+                COMMENT "clang-tidy ${_relative}"
+                VERBATIM
+        )
+        list(APPEND _stamps "${_stamp}")
+    endforeach ()
+
+    add_custom_target(${TARGET_NAME}_tidy DEPENDS ${_stamps})
+    if (NOT TARGET tidy)
+        add_custom_target(tidy)
+    endif ()
+    add_dependencies(tidy ${TARGET_NAME}_tidy)
+endfunction()
+
+# Helper function to get the clang-tidy arguments shared by every mode, without the executable and the source
+function(_get_clang_tidy_arguments OUT_ARGS ENABLE_EXCEPTIONS)
+    set(CXX_CLANG_TIDY_ARGS "--config-file=${PROJECT_SOURCE_DIR}/.clang-tidy")
 
     if (WIN32)
         list(APPEND CXX_CLANG_TIDY_ARGS "--extra-arg=-Wno-dll-attribute-on-redeclaration")
@@ -95,15 +231,146 @@ function(_add_clang_tidy_custom_target TARGET_NAME ENABLE_EXCEPTIONS CLANG_TIDY_
         endif ()
     endif ()
 
-    set_target_properties(${TARGET_NAME} PROPERTIES
-            CXX_CLANG_TIDY "${CXX_CLANG_TIDY_ARGS}"
-    )
+    set(${OUT_ARGS} "${CXX_CLANG_TIDY_ARGS}" PARENT_SCOPE)
+endfunction()
 
+# Helper function to get the compile flags of a target, one per line, as a generator expression.
+# Reading the build properties through $<TARGET_PROPERTY> includes the usage requirements of linked targets.
+function(_get_clang_tidy_compile_flags TARGET_NAME OUT_FLAGS)
     if (MSVC)
-        set_property(TARGET ${TARGET_NAME} PROPERTY VS_GLOBAL_EnableMicrosoftCodeAnalysis false)
-        set_property(TARGET ${TARGET_NAME} PROPERTY VS_GLOBAL_EnableClangTidyCodeAnalysis true)
-        set_property(TARGET ${TARGET_NAME} PROPERTY VS_GLOBAL_RunCodeAnalysis true)
+        set(_include "/I")
+        set(_define "/D")
+        set(_standard "/std:c++")
+    else ()
+        set(_include "-I")
+        set(_define "-D")
+        set(_standard "-std=c++")
     endif ()
+
+    set(_includes "$<TARGET_PROPERTY:${TARGET_NAME},INCLUDE_DIRECTORIES>")
+    set(_definitions "$<TARGET_PROPERTY:${TARGET_NAME},COMPILE_DEFINITIONS>")
+    set(_options "$<TARGET_PROPERTY:${TARGET_NAME},COMPILE_OPTIONS>")
+    set(_cxx_standard "$<TARGET_PROPERTY:${TARGET_NAME},CXX_STANDARD>")
+
+    set(_lines
+            "$<$<BOOL:${_cxx_standard}>:${_standard}${_cxx_standard}>"
+            "$<$<BOOL:${_includes}>:${_include}$<JOIN:${_includes},\n${_include}>>"
+            "$<$<BOOL:${_definitions}>:${_define}$<JOIN:${_definitions},\n${_define}>>"
+            "$<JOIN:${_options},\n>"
+    )
+
+    # Global flags (sanitizers, MARCH, NDEBUG of the configuration) change what the preprocessor sees
+    separate_arguments(_global NATIVE_COMMAND "${CMAKE_CXX_FLAGS}")
+    list(JOIN _global "\n" _global)
+    list(APPEND _lines "${_global}")
+    set(_configs ${CMAKE_CONFIGURATION_TYPES} ${CMAKE_BUILD_TYPE})
+    list(REMOVE_DUPLICATES _configs)
+    foreach (_config ${_configs})
+        string(TOUPPER "${_config}" _config_upper)
+        separate_arguments(_config_flags NATIVE_COMMAND "${CMAKE_CXX_FLAGS_${_config_upper}}")
+        list(JOIN _config_flags "\n" _config_flags)
+        string(REPLACE ">" "$<ANGLE-R>" _config_flags "${_config_flags}")
+        string(REPLACE "," "$<COMMA>" _config_flags "${_config_flags}")
+        list(APPEND _lines "$<$<CONFIG:${_config}>:${_config_flags}>")
+    endforeach ()
+
+    list(JOIN _lines "\n" _flags)
+    set(${OUT_FLAGS} "${_flags}" PARENT_SCOPE)
+endfunction()
+
+# Helper function to write the script of the <target>_tidy steps, once per configure
+function(_write_clang_tidy_script OUT_SCRIPT)
+    set(_script "${CMAKE_BINARY_DIR}/CMakeFiles/ClangTidyRun.cmake")
+    set(${OUT_SCRIPT} "${_script}" PARENT_SCOPE)
+    get_property(_written GLOBAL PROPERTY _CLANG_TIDY_SCRIPT_WRITTEN)
+    if (_written)
+        return()
+    endif ()
+    set_property(GLOBAL PROPERTY _CLANG_TIDY_SCRIPT_WRITTEN TRUE)
+
+    file(CONFIGURE OUTPUT "${_script}" @ONLY CONTENT [=[
+# Runs clang-tidy on SOURCE unless CACHE_DIR holds the result for the same preprocessed source,
+# .clang-tidy and command line, generated by StaticAnalysis.cmake
+cmake_policy(VERSION 3.21)
+file(STRINGS "${FLAGS_FILE}" _flags)
+list(FILTER _flags EXCLUDE REGEX "^$")
+string(REPLACE "|" ";" CLANG_TIDY_ARGS "${CLANG_TIDY_ARGS}")
+
+# COMPILE_OPTIONS may hold "SHELL:" groups
+set(_compile_flags "")
+foreach (_flag ${_flags})
+    if (_flag MATCHES "^SHELL:(.*)$")
+        separate_arguments(_group NATIVE_COMMAND "${CMAKE_MATCH_1}")
+        list(APPEND _compile_flags ${_group})
+    else ()
+        list(APPEND _compile_flags "${_flag}")
+    endif ()
+endforeach ()
+
+set(_preprocessed "${STAMP}.i")
+if (MSVC_DRIVER)
+    set(_preprocess /nologo /E)
+elseif (DEPFILE)
+    set(_preprocess -E -MD -MF "${STAMP}.d" -MT "${STAMP}")
+else ()
+    set(_preprocess -E)
+endif ()
+get_filename_component(_stamp_dir "${STAMP}" DIRECTORY)
+file(MAKE_DIRECTORY "${_stamp_dir}")
+execute_process(
+        COMMAND "${COMPILER}" ${_compile_flags} ${_preprocess} "${SOURCE}"
+        OUTPUT_FILE "${_preprocessed}"
+        ERROR_VARIABLE _error
+        RESULT_VARIABLE _result
+)
+if (NOT _result EQUAL 0)
+    file(REMOVE "${_preprocessed}")
+    message(FATAL_ERROR "Preprocessing ${SOURCE} for clang-tidy failed:\n${_error}")
+endif ()
+
+file(SHA256 "${_preprocessed}" _source_hash)
+file(REMOVE "${_preprocessed}")
+set(_config_hash "")
+if (EXISTS "${CONFIG_FILE}")
+    file(SHA256 "${CONFIG_FILE}" _config_hash)
+endif ()
+string(SHA256 _key "${_source_hash}|${_config_hash}|${CLANG_TIDY}|${CLANG_TIDY_ARGS}|${_compile_flags}")
+string(SUBSTRING "${_key}" 0 2 _bucket)
+set(_entry "${CACHE_DIR}/${_bucket}/${_key}")
+
+if (EXISTS "${_entry}.pass" OR EXISTS "${_entry}.fail")
+    if (EXISTS "${_entry}.pass")
+        file(READ "${_entry}.pass" _output)
+        set(_result 0)
+    else ()
+        file(READ "${_entry}.fail" _output)
+        set(_result 1)
+    endif ()
+else ()
+    execute_process(
+            COMMAND "${CLANG_TIDY}" ${CLANG_TIDY_ARGS} "${SOURCE}" -- ${_compile_flags}
+            OUTPUT_VARIABLE _output
+            ERROR_VARIABLE _output
+            RESULT_VARIABLE _result
+    )
+    file(MAKE_DIRECTORY "${CACHE_DIR}/${_bucket}")
+    if (_result EQUAL 0)
+        file(WRITE "${_entry}.pass" "${_output}")
+    else ()
+        file(WRITE "${_entry}.fail" "${_output}")
+    endif ()
+endif ()
+
+# Warnings of passing units are shown again on cache hits, clang-tidy summary lines are dropped
+string(REGEX REPLACE "[0-9]+ warnings? generated\\.\n?" "" _output "${_output}")
+if (NOT _output STREQUAL "")
+    message("${_output}")
+endif ()
+if (NOT _result EQUAL 0)
+    message(FATAL_ERROR "clang-tidy found errors in ${SOURCE}")
+endif ()
+file(TOUCH "${STAMP}")
+]=])
 endfunction()
 
 #
@@ -193,8 +460,10 @@ endfunction()
 function(_find_clang_tidy OUT_CLANG_TIDY)
     find_program(CLANG_TIDY_EXE NAMES "clang-tidy")
 
-    # If not found in PATH, try to find it using vswhere (Windows/Visual Studio)
-    if (NOT CLANG_TIDY_EXE AND WIN32)
+    # The vswhere probe below spawns several processes, run it once per configure
+    get_property(_probed GLOBAL PROPERTY _CLANG_TIDY_VSWHERE_PROBED)
+    if (NOT CLANG_TIDY_EXE AND WIN32 AND NOT _probed)
+        set_property(GLOBAL PROPERTY _CLANG_TIDY_VSWHERE_PROBED TRUE)
         find_program(VSWHERE_EXE NAMES "vswhere"
                 PATHS "$ENV{ProgramFiles\(x86\)}/Microsoft Visual Studio/Installer"
                 "$ENV{ProgramFiles}/Microsoft Visual Studio/Installer")
@@ -252,48 +521,14 @@ function(_find_clang_tidy OUT_CLANG_TIDY)
             endif ()
         endif ()
     endif ()
+
+    set(${OUT_CLANG_TIDY} "${CLANG_TIDY_EXE}" PARENT_SCOPE)
 endfunction()
 
 function(_build_clang_tidy_command OUT_CLANG_TIDY_COMMAND CLANG_TIDY_EXE SOURCE_FILE ENABLE_EXCEPTIONS)
-    set(CLANG_TIDY_COMMAND "${CLANG_TIDY_EXE}")
-    list(APPEND CLANG_TIDY_COMMAND "--config-file=${PROJECT_SOURCE_DIR}/.clang-tidy")
+    _get_clang_tidy_arguments(CLANG_TIDY_ARGS ${ENABLE_EXCEPTIONS})
+    set(CLANG_TIDY_COMMAND "${CLANG_TIDY_EXE}" ${CLANG_TIDY_ARGS})
     list(APPEND CLANG_TIDY_COMMAND "--header-filter=(.*\/(out|build\/).*)")
-
-    if (WIN32)
-        list(APPEND CLANG_TIDY_COMMAND "--extra-arg=-Wno-dll-attribute-on-redeclaration")
-        list(APPEND CLANG_TIDY_COMMAND "--extra-arg=-Wno-inconsistent-dllimport")
-    endif ()
-
-    get_current_compiler(CURRENT_COMPILER)
-    list(APPEND CLANG_TIDY_COMMAND "--use-color")
-
-    if (CURRENT_COMPILER MATCHES "MSVC")
-        if (${ENABLE_EXCEPTIONS})
-            list(APPEND CLANG_TIDY_COMMAND "--extra-arg=/EHsc")
-        else ()
-            list(APPEND CLANG_TIDY_COMMAND "--extra-arg=/EHs-c-")
-        endif ()
-    elseif (CURRENT_COMPILER MATCHES "CLANG.*|GCC|EMSCRIPTEN")
-        if (${ENABLE_EXCEPTIONS})
-            list(APPEND CLANG_TIDY_COMMAND "--extra-arg=-fexceptions")
-        else ()
-            list(APPEND CLANG_TIDY_COMMAND "--extra-arg=-fno-exceptions")
-        endif ()
-
-        list(APPEND CLANG_TIDY_COMMAND "--extra-arg=-Wno-unused-command-line-argument")
-        list(APPEND CLANG_TIDY_COMMAND "--extra-arg=-Wno-unknown-argument")
-
-        # When using GCC compiler, ignore GCC-specific warning flags that clang-tidy doesn't understand
-        if (CURRENT_COMPILER MATCHES "GCC")
-            list(APPEND CLANG_TIDY_COMMAND "--extra-arg=-Wno-error=unknown-warning-option")
-            list(APPEND CLANG_TIDY_COMMAND "--extra-arg=-Wno-duplicated-branches")
-            list(APPEND CLANG_TIDY_COMMAND "--extra-arg=-Wno-duplicated-cond")
-            list(APPEND CLANG_TIDY_COMMAND "--extra-arg=-Wno-logical-op")
-            list(APPEND CLANG_TIDY_COMMAND "--extra-arg=-Wno-useless-cast")
-            # Tell clang-tidy to use GCC driver mode for compatibility
-            list(APPEND CLANG_TIDY_COMMAND "--extra-arg-before=--driver-mode=g++")
-        endif ()
-    endif ()
     list(APPEND CLANG_TIDY_COMMAND "${SOURCE_FILE}")
     set(${OUT_CLANG_TIDY_COMMAND} "${CLANG_TIDY_COMMAND}" PARENT_SCOPE)
 
@@ -0,0 +1,196 @@
+include_guard(DIRECTORY)
+include(LinkDependencies)
+
+#
+# usage:
+# target_use_allocator(
+#   TARGET_NAME
+#   [ALLOCATOR system|mimalloc|jemalloc|tcmalloc|snmalloc]  # Override the global ALLOCATOR for this target
+# )
+#
+# Replaces malloc/free (and with them operator new/delete) of the executable TARGET_NAME:
+#   system   - the C runtime allocator, nothing is linked
+#   mimalloc - fetched with CPM or xrepo. Linux: the mimalloc object file, linked ahead of every library.
+#              macOS: the shared library (interposition). Windows: mimalloc.dll as the first import, plus
+#              mimalloc-redirect.dll, which patches the CRT; needs the DLL runtime (/MD) and MSVC or clang-cl
+#   snmalloc - fetched with CPM, the snmallocshim shared library (not on Windows)
+#   jemalloc - xrepo, or an installed libjemalloc (no CMake build to fetch, not on Windows)
+#   tcmalloc - xrepo (gperftools), or an installed libtcmalloc_minimal / libtcmalloc (not on Windows)
+#
+# The allocator replaces the one of every library in the process, static or shared. Sanitizers bring
+# their own allocator, so ASan, LSan, TSan and MSan builds keep the system one. Emscripten picks its
+# allocator with register_emscripten(MALLOC ...) instead.
+#
+function(target_use_allocator TARGET_NAME)
+    set(oneValueArgs
+            ALLOCATOR
+    )
+    cmake_parse_arguments(ARG "" "${oneValueArgs}" "" ${ARGN})
+
+    #
+
+    if (NOT TARGET ${TARGET_NAME})
+        message(FATAL_ERROR "target_use_allocator: Target '${TARGET_NAME}' does not exist")
+    endif ()
+
+    # Configure once, so register_*() and explicit calls can both call this
+    get_target_property(_configured ${TARGET_NAME} _ALLOCATOR_CONFIGURED)
+    if (_configured)
+        return()
+    endif ()
+    set_target_properties(${TARGET_NAME} PROPERTIES _ALLOCATOR_CONFIGURED TRUE)
+
+    set(_allocator "${ALLOCATOR}")
+    if (DEFINED ARG_ALLOCATOR)
+        set(_allocator "${ARG_ALLOCATOR}")
+    endif ()
+    string(TOLOWER "${_allocator}" _allocator)
+    if (_allocator STREQUAL "")
+        set(_allocator "system")
+    endif ()
+    if (NOT _allocator MATCHES "^(system|mimalloc|jemalloc|tcmalloc|snmalloc)$")
+        message(FATAL_ERROR "Unknown ALLOCATOR '${_allocator}' for '${TARGET_NAME}' (expected system, mimalloc, jemalloc, tcmalloc or snmalloc)")
+    endif ()
+    if (_allocator STREQUAL "system" OR EMSCRIPTEN)
+        return()
+    endif ()
+
+    # Libraries must not force an allocator on the programs that link them
+    get_target_property(_type ${TARGET_NAME} TYPE)
+    if (NOT _type STREQUAL "EXECUTABLE")
+        message(FATAL_ERROR "target_use_allocator: '${TARGET_NAME}' is not an executable, only executables pick the process allocator")
+    endif ()
+
+    if (ENABLE_GLOBAL_SANITIZERS AND (ENABLE_ASAN OR ENABLE_LSAN OR ENABLE_TSAN OR ENABLE_MSAN))
+        get_property(_warned GLOBAL PROPERTY _ALLOCATOR_SANITIZER_WARNED)
+        if (NOT _warned)
+            set_property(GLOBAL PROPERTY _ALLOCATOR_SANITIZER_WARNED TRUE)
+            message(STATUS "** Sanitizers replace malloc, ALLOCATOR ${_allocator} is ignored in this build")
+        endif ()
+        return()
+    endif ()
+
+    if (WIN32 AND NOT _allocator STREQUAL "mimalloc")
+        message(FATAL_ERROR "ALLOCATOR ${_allocator} cannot replace the allocator on Windows, use mimalloc")
+    endif ()
+
+    cmake_language(CALL _target_use_${_allocator} ${TARGET_NAME})
+    message(STATUS "** ${_allocator} allocator enabled for target: ${TARGET_NAME}")
+endfunction()
+
+#
+
+# Helper function to link mimalloc, fetched once
+function(_target_use_mimalloc TARGET_NAME)
+    if (WIN32)
+        # The redirection DLL patches the DLL runtime only, and expects MSVC import libraries
+        if (NOT MSVC)
+            message(FATAL_ERROR "ALLOCATOR mimalloc on Windows needs MSVC or clang-cl")
+        endif ()
+        get_target_property(_runtime ${TARGET_NAME} MSVC_RUNTIME_LIBRARY)
+        if (NOT _runtime)
+            set(_runtime "${CMAKE_MSVC_RUNTIME_LIBRARY}")
+        endif ()
+        if (ENABLE_STATIC_RUNTIME OR (_runtime AND NOT _runtime MATCHES "DLL"))
+            message(FATAL_ERROR "ALLOCATOR mimalloc on Windows needs the DLL runtime (/MD), turn ENABLE_STATIC_RUNTIME off for '${TARGET_NAME}'")
+        endif ()
+    endif ()
+
+    if (COMMAND CPMAddPackage)
+        if (NOT TARGET mimalloc)
+            CPMAddPackage(
+                    NAME mimalloc
+                    GITHUB_REPOSITORY microsoft/mimalloc
+                    GIT_TAG v2.1.7
+                    SYSTEM ON
+                    OPTIONS
+                    "MI_BUILD_SHARED ON"
+                    "MI_BUILD_OBJECT ON"
+                    "MI_BUILD_STATIC OFF"
+                    "MI_BUILD_TESTS OFF"
+                    "MI_OVERRIDE ON"
+                    "MI_INSTALL_TOPLEVEL OFF"
+            )
+            set_property(GLOBAL PROPERTY _ALLOCATOR_MIMALLOC_SOURCE_DIR "${mimalloc_SOURCE_DIR}")
+        endif ()
+
+        if (WIN32)
+            target_link_dependencies(${TARGET_NAME} PRIVATE mimalloc)
+
+            get_property(_source_dir GLOBAL PROPERTY _ALLOCATOR_MIMALLOC_SOURCE_DIR)
+            string(TOLOWER "${CMAKE_CXX_COMPILER_ARCHITECTURE_ID}" _arch)
+            if (_arch STREQUAL "x86")
+                set(_redirect "mimalloc-redirect32.dll")
+            elseif (_arch MATCHES "^arm64")
+                set(_redirect "mimalloc-redirect-${_arch}.dll")
+            else ()
+                set(_redirect "mimalloc-redirect.dll")
+            endif ()
+            target_copy_runtime_dependencies(${TARGET_NAME} FILES "${_source_dir}/bin/${_redirect}")
+        elseif (APPLE)
+            target_link_dependencies(${TARGET_NAME} PRIVATE mimalloc)
+        else ()
+            # Object files go before every library on the link line, so its malloc wins over libc's
+            target_link_libraries(${TARGET_NAME} PRIVATE mimalloc-obj)
+        endif ()
+    elseif (COMMAND xrepo_package)
+        xrepo_package("mimalloc")
+        xrepo_target_packages(${TARGET_NAME} mimalloc)
+    else ()
+        message(FATAL_ERROR "ALLOCATOR mimalloc: no package manager available.")
+    endif ()
+
+    if (WIN32)
+        # Forces the import of mimalloc.dll, so it is loaded (and redirects the CRT) before any other DLL
+        if (CMAKE_SIZEOF_VOID_P EQUAL 4)
+            target_link_options(${TARGET_NAME} PRIVATE "/INCLUDE:_mi_version")
+        else ()
+            target_link_options(${TARGET_NAME} PRIVATE "/INCLUDE:mi_version")
+        endif ()
+    endif ()
+endfunction()
+
+# Helper function to link the snmalloc shim, fetched once
+function(_target_use_snmalloc TARGET_NAME)
+    if (NOT COMMAND CPMAddPackage)
+        message(FATAL_ERROR "ALLOCATOR snmalloc is fetched with CPM, add CPM to PACKAGE_MANAGERS")
+    endif ()
+    if (NOT TARGET snmallocshim)
+        CPMAddPackage(
+                NAME snmalloc
+                GITHUB_REPOSITORY microsoft/snmalloc
+                VERSION 0.7.0
+                SYSTEM ON
+                OPTIONS
+                "SNMALLOC_BUILD_TESTING OFF"
+        )
+    endif ()
+    target_link_dependencies(${TARGET_NAME} PRIVATE snmallocshim)
+endfunction()
+
+# Helper function to link an allocator without a CMake build: xrepo PACKAGE, or an installed library
+function(_target_use_installed_allocator TARGET_NAME ALLOCATOR PACKAGE)
+    if (COMMAND xrepo_package)
+        xrepo_package("${PACKAGE}")
+        xrepo_target_packages(${TARGET_NAME} ${PACKAGE})
+        return()
+    endif ()
+
+    string(TOUPPER "${ALLOCATOR}" _name)
+    find_library(${_name}_LIBRARY NAMES ${ARGN})
+    if (NOT ${_name}_LIBRARY)
+        message(FATAL_ERROR "ALLOCATOR ${ALLOCATOR}: library not found (${ARGN}), install it or add XMake to PACKAGE_MANAGERS")
+    endif ()
+    mark_as_advanced(${_name}_LIBRARY)
+    target_link_libraries(${TARGET_NAME} PRIVATE "${${_name}_LIBRARY}")
+endfunction()
+
+# Helper function to link jemalloc
+function(_target_use_jemalloc TARGET_NAME)
+    _target_use_installed_allocator(${TARGET_NAME} jemalloc jemalloc jemalloc)
+endfunction()
+
+# Helper function to link tcmalloc, the minimal flavour (no heap profiler) when both are installed
+function(_target_use_tcmalloc TARGET_NAME)
+    _target_use_installed_allocator(${TARGET_NAME} tcmalloc gperftools tcmalloc_minimal tcmalloc)
+endfunction()
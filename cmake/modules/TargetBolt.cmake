@@ -0,0 +1,328 @@
+include_guard(DIRECTORY)
+include(GetCurrentCompiler)
+include(ConfigureQuiet)
+
+#
+# usage:
+# target_enable_bolt(
+#   TARGET_NAME
+#   [ENABLE ON/OFF]             # Override ENABLE_BOLT for this target
+#   [PROFILE_DIR <dir>]         # Override BOLT_PROFILE_DIR for this target
+# )
+#
+# Prepares the executable TARGET_NAME for llvm-bolt: it is linked with --emit-relocs, so BOLT can move
+# every function and basic block. register_bolt_training() (or register_pgo_training(), which shares its
+# workload) then adds the CTest steps that profile it and write the optimized <binary>.bolt, and the
+# install rules of register_executable() ship <binary>.bolt in place of the binary.
+#
+# Linux ELF only (GCC or Clang). Skipped for PGO_MODE GENERATE builds, their binaries are instrumented.
+#
+function(target_enable_bolt TARGET_NAME)
+    set(oneValueArgs
+            ENABLE
+            PROFILE_DIR
+    )
+    cmake_parse_arguments(ARG "" "${oneValueArgs}" "" ${ARGN})
+
+    #
+
+    if (NOT TARGET ${TARGET_NAME})
+        message(FATAL_ERROR "target_enable_bolt: Target '${TARGET_NAME}' does not exist")
+    endif ()
+
+    set(ENABLE_VALUE ${ENABLE_BOLT})
+    if (DEFINED ARG_ENABLE)
+        set(ENABLE_VALUE ${ARG_ENABLE})
+    endif ()
+    if (NOT ENABLE_VALUE)
+        return()
+    endif ()
+
+    get_target_property(_type ${TARGET_NAME} TYPE)
+    if (NOT _type STREQUAL "EXECUTABLE")
+        message(FATAL_ERROR "target_enable_bolt: '${TARGET_NAME}' is not an executable")
+    endif ()
+
+    get_current_compiler(CURRENT_COMPILER)
+    if (NOT CMAKE_SYSTEM_NAME STREQUAL "Linux" OR NOT "${CURRENT_COMPILER}" MATCHES "^(GCC|CLANG)$")
+        status_once(BOLT_UNSUPPORTED "** BOLT needs Linux and GCC or Clang, '${CURRENT_COMPILER}' on ${CMAKE_SYSTEM_NAME} is skipped")
+        return()
+    endif ()
+
+    get_target_property(_pgo_mode ${TARGET_NAME} _PGO_MODE)
+    if (_pgo_mode STREQUAL "GENERATE")
+        status_once(BOLT_PGO_GENERATE "** BOLT is skipped while PGO_MODE is GENERATE, optimize the PGO USE build instead")
+        return()
+    endif ()
+
+    _find_bolt_tools()
+    if (NOT LLVM_BOLT_EXECUTABLE)
+        status_once(BOLT_NOT_FOUND "** llvm-bolt not found, ENABLE_BOLT is ignored")
+        return()
+    endif ()
+
+    set(PROFILE_DIR_VALUE ${BOLT_PROFILE_DIR})
+    if (DEFINED ARG_PROFILE_DIR)
+        set(PROFILE_DIR_VALUE ${ARG_PROFILE_DIR})
+    endif ()
+    if (NOT PROFILE_DIR_VALUE)
+        set(PROFILE_DIR_VALUE "${CMAKE_BINARY_DIR}/bolt")
+    endif ()
+    get_filename_component(PROFILE_DIR_VALUE "${PROFILE_DIR_VALUE}" ABSOLUTE BASE_DIR "${CMAKE_BINARY_DIR}")
+
+    # Relocations stay in the output, so BOLT can rewrite code and data references after reordering
+    target_link_options(${TARGET_NAME} PRIVATE LINKER:--emit-relocs)
+
+    # Remembered for register_bolt_training() and the install rules
+    set_target_properties(${TARGET_NAME} PROPERTIES
+            _BOLT_ENABLED TRUE
+            _BOLT_PROFILE_DIR "${PROFILE_DIR_VALUE}"
+    )
+    message(STATUS "** BOLT enabled for '${TARGET_NAME}' (profile: ${BOLT_PROFILE_MODE}, data: ${PROFILE_DIR_VALUE})")
+endfunction()
+
+#
+# usage:
+# register_bolt_training(
+#   TARGET_NAME
+#   [COMMAND <cmd> [<arg>...]]  # Training workload, defaults to running TARGET_NAME
+#   [WORKING_DIRECTORY <dir>]
+#   [TIMEOUT <seconds>]
+# )
+#
+# Only active for targets prepared by target_enable_bolt(). Adds the CTest tests 'bolt_prepare_<target>',
+# 'bolt_train_<target>' and 'bolt_optimize_<target>' (label 'bolt'), run them with:
+#   ctest -L bolt
+# BOLT_PROFILE_MODE perf records the workload with perf record (LBR when BOLT_PERF_LBR is on) and converts it
+# with perf2bolt. instrument runs an instrumented copy instead. TARGET_NAME (or $<TARGET_FILE:TARGET_NAME>)
+# in COMMAND runs the binary, or that copy. Either way llvm-bolt then writes <binary>.bolt with BOLT_OPTIONS.
+#
+function(register_bolt_training TARGET_NAME)
+    set(oneValueArgs
+            WORKING_DIRECTORY
+            TIMEOUT
+    )
+    set(multiValueArgs
+            COMMAND
+    )
+    cmake_parse_arguments(ARG "" "${oneValueArgs}" "${multiValueArgs}" ${ARGN})
+
+    #
+
+    if (NOT TARGET ${TARGET_NAME})
+        message(FATAL_ERROR "register_bolt_training: Target '${TARGET_NAME}' does not exist")
+    endif ()
+
+    get_target_property(_enabled ${TARGET_NAME} _BOLT_ENABLED)
+    if (NOT _enabled)
+        return()
+    endif ()
+    get_target_property(_profile_dir ${TARGET_NAME} _BOLT_PROFILE_DIR)
+
+    string(TOLOWER "${BOLT_PROFILE_MODE}" _mode)
+    if (NOT _mode MATCHES "^(perf|instrument)$")
+        message(FATAL_ERROR "register_bolt_training: Unknown BOLT_PROFILE_MODE '${BOLT_PROFILE_MODE}' (expected perf or instrument)")
+    endif ()
+    if (_mode STREQUAL "perf" AND (NOT PERF_EXECUTABLE OR NOT PERF2BOLT_EXECUTABLE))
+        message(FATAL_ERROR "register_bolt_training: BOLT_PROFILE_MODE perf needs perf and perf2bolt, or set BOLT_PROFILE_MODE to instrument")
+    endif ()
+
+    if (NOT ARG_COMMAND)
+        set(ARG_COMMAND ${TARGET_NAME})
+    endif ()
+    if (NOT ARG_WORKING_DIRECTORY)
+        set(ARG_WORKING_DIRECTORY "${CMAKE_CURRENT_BINARY_DIR}")
+    endif ()
+
+    _write_bolt_script()
+    get_property(_script GLOBAL PROPERTY _BOLT_SCRIPT)
+    string(JOIN "|" _options ${BOLT_OPTIONS})
+    set(_script_args
+            "-DNAME=${TARGET_NAME}"
+            "-DBINARY=$<TARGET_FILE:${TARGET_NAME}>"
+            "-DPROFILE_DIR=${_profile_dir}"
+            "-DMODE=${_mode}"
+            "-DLLVM_BOLT=${LLVM_BOLT_EXECUTABLE}"
+            "-DPERF2BOLT=${PERF2BOLT_EXECUTABLE}"
+            "-DMERGE_FDATA=${MERGE_FDATA_EXECUTABLE}"
+            "-DPERF_LBR=${BOLT_PERF_LBR}"
+            "-DBOLT_OPTIONS=${_options}"
+    )
+
+    # The workload isn't the first add_test() argument, so CMake doesn't resolve the target name itself
+    if (_mode STREQUAL "perf")
+        set(_binary "$<TARGET_FILE:${TARGET_NAME}>")
+    else ()
+        set(_binary "${_profile_dir}/${TARGET_NAME}.instrumented")
+    endif ()
+    set(_workload "")
+    foreach (_arg IN LISTS ARG_COMMAND)
+        if (_arg STREQUAL TARGET_NAME OR _arg STREQUAL "$<TARGET_FILE:${TARGET_NAME}>")
+            set(_arg "${_binary}")
+        endif ()
+        list(APPEND _workload "${_arg}")
+    endforeach ()
+
+    if (_mode STREQUAL "perf")
+        set(_record -e cycles:u)
+        if (BOLT_PERF_LBR)
+            list(APPEND _record -j any,u)
+        endif ()
+        set(_command "${PERF_EXECUTABLE}" record ${_record} -o "${_profile_dir}/${TARGET_NAME}.perf.data" -- ${_workload})
+    else ()
+        set(_command ${_workload})
+    endif ()
+
+    set(_fixture bolt_${TARGET_NAME})
+    add_test(NAME bolt_prepare_${TARGET_NAME}
+            COMMAND ${CMAKE_COMMAND} -DBOLT_ACTION=PREPARE ${_script_args} -P "${_script}"
+    )
+    set_tests_properties(bolt_prepare_${TARGET_NAME} PROPERTIES
+            LABELS bolt
+            FIXTURES_SETUP ${_fixture}_prepare
+    )
+
+    add_test(NAME bolt_train_${TARGET_NAME}
+            COMMAND ${_command}
+            WORKING_DIRECTORY "${ARG_WORKING_DIRECTORY}"
+    )
+    set_tests_properties(bolt_train_${TARGET_NAME} PROPERTIES
+            LABELS bolt
+            FIXTURES_REQUIRED ${_fixture}_prepare
+            FIXTURES_SETUP ${_fixture}_train
+            # perf samples are only meaningful without other load on the machine
+            RUN_SERIAL TRUE
+    )
+    if (DEFINED ARG_TIMEOUT)
+        set_tests_properties(bolt_train_${TARGET_NAME} PROPERTIES TIMEOUT ${ARG_TIMEOUT})
+    endif ()
+
+    add_test(NAME bolt_optimize_${TARGET_NAME}
+            COMMAND ${CMAKE_COMMAND} -DBOLT_ACTION=OPTIMIZE ${_script_args} -P "${_script}"
+    )
+    set_tests_properties(bolt_optimize_${TARGET_NAME} PROPERTIES
+            LABELS bolt
+            FIXTURES_REQUIRED ${_fixture}_train
+    )
+
+    message(STATUS "** BOLT training registered for '${TARGET_NAME}' (run: ctest -L bolt)")
+endfunction()
+
+#
+
+# Helper function to install <binary>.bolt over the installed binary of TARGET_NAME, for targets prepared by target_enable_bolt()
+function(_install_bolt_output TARGET_NAME DESTINATION)
+    get_target_property(_enabled ${TARGET_NAME} _BOLT_ENABLED)
+    if (NOT _enabled)
+        return()
+    endif ()
+
+    # Runs after install(TARGETS), so the installed binary already carries its install RPATH, which is kept
+    install(CODE "
+        set(_binary \"$<TARGET_FILE:${TARGET_NAME}>\")
+        set(_installed \"\$ENV{DESTDIR}\${CMAKE_INSTALL_PREFIX}/${DESTINATION}/$<TARGET_FILE_NAME:${TARGET_NAME}>\")
+        if (NOT EXISTS \"\${_binary}.bolt\" OR \"\${_binary}\" IS_NEWER_THAN \"\${_binary}.bolt\")
+            message(WARNING \"No up to date \${_binary}.bolt, installing the binary as linked (run: ctest -L bolt)\")
+        else ()
+            file(READ_ELF \"\${_installed}\" RUNPATH _runpath RPATH _rpath)
+            message(STATUS \"Installing BOLT optimized: \${_installed}\")
+            file(COPY_FILE \"\${_binary}.bolt\" \"\${_installed}\")
+            if (_runpath OR _rpath)
+                file(RPATH_SET FILE \"\${_installed}\" NEW_RPATH \"\${_runpath}\${_rpath}\")
+            else ()
+                file(RPATH_REMOVE FILE \"\${_installed}\")
+            endif ()
+        endif ()
+    ")
+endfunction()
+
+# Helper function to find llvm-bolt, perf2bolt, merge-fdata and perf, next to the compiler first
+function(_find_bolt_tools)
+    get_filename_component(_compiler_dir "${CMAKE_CXX_COMPILER}" DIRECTORY)
+    set(_suffixes "")
+    if (CMAKE_CXX_COMPILER_ID STREQUAL "Clang")
+        set(_suffixes -${CMAKE_CXX_COMPILER_VERSION_MAJOR})
+    endif ()
+    foreach (_tool llvm-bolt perf2bolt merge-fdata)
+        string(TOUPPER "${_tool}_EXECUTABLE" _var)
+        string(REPLACE "-" "_" _var "${_var}")
+        set(_names ${_tool})
+        foreach (_suffix ${_suffixes})
+            list(APPEND _names ${_tool}${_suffix})
+        endforeach ()
+        find_program(${_var} NAMES ${_names} HINTS "${_compiler_dir}" DOC "LLVM BOLT ${_tool}")
+        mark_as_advanced(${_var})
+    endforeach ()
+    find_program(PERF_EXECUTABLE perf DOC "Linux perf, records BOLT profiles")
+    mark_as_advanced(PERF_EXECUTABLE)
+endfunction()
+
+# Helper function to write the script preparing and optimizing BOLT targets, once
+function(_write_bolt_script)
+    get_property(_script GLOBAL PROPERTY _BOLT_SCRIPT)
+    if (_script)
+        return()
+    endif ()
+    set(_script "${CMAKE_BINARY_DIR}/CMakeFiles/BoltOptimize.cmake")
+    set_property(GLOBAL PROPERTY _BOLT_SCRIPT "${_script}")
+
+    file(CONFIGURE OUTPUT "${_script}" @ONLY CONTENT [=[
+# Prepares a BOLT training run and optimizes the binary with its profile, generated by TargetBolt.cmake:
+#   cmake -DBOLT_ACTION=PREPARE|OPTIMIZE -DNAME=<target> -DBINARY=<file> -DPROFILE_DIR=<dir> -DMODE=perf|instrument
+#         -DLLVM_BOLT=<path> [-DPERF2BOLT=<path>] [-DMERGE_FDATA=<path>] [-DPERF_LBR=ON|OFF] [-DBOLT_OPTIONS=<opt>[|...]]
+#         -P BoltOptimize.cmake
+cmake_policy(VERSION 3.21)
+string(REPLACE "|" ";" BOLT_OPTIONS "${BOLT_OPTIONS}")
+set(_fdata "${PROFILE_DIR}/${NAME}.fdata")
+set(_instrumented_dir "${PROFILE_DIR}/${NAME}.instrumented-profiles")
+
+macro(_bolt_run)
+    execute_process(COMMAND ${ARGN} RESULT_VARIABLE _result)
+    if (NOT _result EQUAL 0)
+        message(FATAL_ERROR "Failed (${_result}): ${ARGN}")
+    endif ()
+endmacro()
+
+if (BOLT_ACTION STREQUAL "PREPARE")
+    # Profiles of an older binary do not match its code any more
+    file(REMOVE "${_fdata}" "${PROFILE_DIR}/${NAME}.perf.data" "${PROFILE_DIR}/${NAME}.perf.data.old")
+    file(REMOVE_RECURSE "${_instrumented_dir}")
+    file(MAKE_DIRECTORY "${PROFILE_DIR}" "${_instrumented_dir}")
+    if (MODE STREQUAL "instrument")
+        # Every process of the workload writes its own profile, merged by the OPTIMIZE step
+        _bolt_run("${LLVM_BOLT}" "${BINARY}" -instrument
+                "-instrumentation-file=${_instrumented_dir}/${NAME}.fdata" -instrumentation-file-append-pid
+                -o "${PROFILE_DIR}/${NAME}.instrumented")
+    endif ()
+    return()
+endif ()
+
+if (MODE STREQUAL "perf")
+    set(_convert_args "")
+    if (NOT PERF_LBR)
+        list(APPEND _convert_args -nl)
+    endif ()
+    _bolt_run("${PERF2BOLT}" "${BINARY}" -p "${PROFILE_DIR}/${NAME}.perf.data" -o "${_fdata}" ${_convert_args})
+else ()
+    file(GLOB _profiles "${_instrumented_dir}/*.fdata")
+    list(LENGTH _profiles _count)
+    if (_count EQUAL 0)
+        message(FATAL_ERROR "No BOLT profiles in ${_instrumented_dir}, did the training run ${PROFILE_DIR}/${NAME}.instrumented?")
+    elseif (_count EQUAL 1)
+        file(COPY_FILE "${_profiles}" "${_fdata}")
+    elseif (MERGE_FDATA)
+        execute_process(COMMAND "${MERGE_FDATA}" ${_profiles} OUTPUT_FILE "${_fdata}" RESULT_VARIABLE _result)
+        if (NOT _result EQUAL 0)
+            message(FATAL_ERROR "merge-fdata failed (${_result})")
+        endif ()
+    else ()
+        message(FATAL_ERROR "${_count} BOLT profiles in ${_instrumented_dir} and merge-fdata was not found")
+    endif ()
+endif ()
+
+# Written next to the binary first, an interrupted run must not leave a truncated .bolt behind
+_bolt_run("${LLVM_BOLT}" "${BINARY}" -o "${BINARY}.bolt.tmp" "-data=${_fdata}" ${BOLT_OPTIONS})
+file(RENAME "${BINARY}.bolt.tmp" "${BINARY}.bolt")
+message(STATUS "BOLT optimized ${BINARY}.bolt")
+]=])
+endfunction()
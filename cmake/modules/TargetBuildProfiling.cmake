@@ -0,0 +1,211 @@
+include_guard(DIRECTORY)
+include(GetCurrentCompiler)
+
+#
+# usage:
+# target_enable_build_profiling(
+#   TARGET_NAME
+#   [ENABLE ON/OFF]             # Override ENABLE_BUILD_PROFILING for this target
+# )
+#
+# Records where the compiler spends its time for every translation unit of TARGET_NAME:
+#   Clang / clang-cl - -ftime-trace, a Chrome trace (<object>.json) next to each object file
+#   MSVC             - /Bt+ and /d1reportTime, front-end, back-end and include timings in the build log
+#   GCC              - not supported (no trace output), the target is skipped
+#
+# Configures the build-profile target once, which ranks the slowest translation units, headers
+# and template instantiations of every profiled target (Clang traces):
+#   cmake --build <dir> --target build-profile
+#
+function(target_enable_build_profiling TARGET_NAME)
+    set(oneValueArgs
+            ENABLE
+    )
+    cmake_parse_arguments(ARG "" "${oneValueArgs}" "" ${ARGN})
+
+    #
+
+    if (NOT TARGET ${TARGET_NAME})
+        message(FATAL_ERROR "target_enable_build_profiling: Target '${TARGET_NAME}' does not exist")
+    endif ()
+
+    # Interface and imported targets have nothing to compile
+    get_target_property(_type ${TARGET_NAME} TYPE)
+    get_target_property(_imported ${TARGET_NAME} IMPORTED)
+    if (_type STREQUAL "INTERFACE_LIBRARY" OR _imported)
+        return()
+    endif ()
+
+    # Configure once, so register_*() and target_setup_common_options() can both call this
+    get_target_property(_configured ${TARGET_NAME} _BUILD_PROFILING_CONFIGURED)
+    if (_configured)
+        return()
+    endif ()
+    set_target_properties(${TARGET_NAME} PROPERTIES _BUILD_PROFILING_CONFIGURED TRUE)
+
+    set(ENABLE_VALUE ${ENABLE_BUILD_PROFILING})
+    if (DEFINED ARG_ENABLE)
+        set(ENABLE_VALUE ${ARG_ENABLE})
+    endif ()
+    if (NOT ENABLE_VALUE)
+        return()
+    endif ()
+
+    get_current_compiler(CURRENT_COMPILER)
+    if ("${CURRENT_COMPILER}" STREQUAL "CLANG-MSVC")
+        set(_flags "/clang:-ftime-trace")
+    elseif ("${CURRENT_COMPILER}" MATCHES "^CLANG" OR "${CURRENT_COMPILER}" STREQUAL "EMSCRIPTEN")
+        set(_flags -ftime-trace)
+    elseif ("${CURRENT_COMPILER}" STREQUAL "MSVC")
+        set(_flags /Bt+ /d1reportTime)
+    else ()
+        get_property(_warned GLOBAL PROPERTY _BUILD_PROFILING_UNSUPPORTED_WARNED)
+        if (NOT _warned)
+            set_property(GLOBAL PROPERTY _BUILD_PROFILING_UNSUPPORTED_WARNED TRUE)
+            message(STATUS "** Build profiling needs Clang or MSVC, '${CURRENT_COMPILER}' writes no compile traces")
+        endif ()
+        return()
+    endif ()
+
+    target_compile_options(${TARGET_NAME} PRIVATE ${_flags})
+    _add_build_profile_target()
+endfunction()
+
+#
+
+# Helper function to create the build-profile target, once.
+# Traces are found by globbing the object directories, so targets of every directory share it.
+function(_add_build_profile_target)
+    if (TARGET build-profile)
+        return()
+    endif ()
+
+    set(_script "${CMAKE_BINARY_DIR}/CMakeFiles/BuildProfileReport.cmake")
+    file(CONFIGURE OUTPUT "${_script}" @ONLY CONTENT [=[
+# Ranks the -ftime-trace results below BUILD_DIR per target, generated by TargetBuildProfiling.cmake:
+#   cmake -DBUILD_DIR=<dir> -DREPORT=<file> [-DTOP=<n>] -P BuildProfileReport.cmake
+if (NOT TOP)
+    set(TOP 10)
+endif ()
+
+# Adds DURATION (microseconds) to the entry named by NAME_VAR in CATEGORY of the current target.
+# A macro sees its arguments as source text, so the name itself (paths, templates) is passed by variable.
+macro(_profile_add CATEGORY NAME_VAR DURATION)
+    string(MD5 _key "${CATEGORY}${${NAME_VAR}}")
+    if (NOT DEFINED _time_${_key})
+        set(_time_${_key} 0)
+        set(_count_${_key} 0)
+        set(_name_${_key} "${${NAME_VAR}}")
+        list(APPEND _keys_${CATEGORY} ${_key})
+    endif ()
+    math(EXPR _time_${_key} "${_time_${_key}} + ${DURATION}")
+    math(EXPR _count_${_key} "${_count_${_key}} + 1")
+endmacro()
+
+# Appends the TOP slowest entries of CATEGORY to _report
+macro(_profile_rank CATEGORY TITLE)
+    set(_ranked "")
+    foreach (_key ${_keys_${CATEGORY}})
+        list(APPEND _ranked "${_time_${_key}}|${_key}")
+    endforeach ()
+    list(SORT _ranked COMPARE NATURAL ORDER DESCENDING)
+    list(LENGTH _ranked _length)
+    if (_length GREATER TOP)
+        list(SUBLIST _ranked 0 ${TOP} _ranked)
+    endif ()
+
+    string(APPEND _report "  ${TITLE}:\n")
+    foreach (_entry ${_ranked})
+        string(REGEX MATCH "^([0-9]+)\\|(.*)$" _match "${_entry}")
+        set(_key "${CMAKE_MATCH_2}")
+        math(EXPR _ms "${CMAKE_MATCH_1} / 1000")
+        string(APPEND _report "    ${_ms} ms  ${_name_${_key}}")
+        if (_count_${_key} GREATER 1)
+            string(APPEND _report "  (${_count_${_key}}x)")
+        endif ()
+        string(APPEND _report "\n")
+    endforeach ()
+    foreach (_key ${_keys_${CATEGORY}})
+        unset(_time_${_key})
+        unset(_count_${_key})
+        unset(_name_${_key})
+    endforeach ()
+    set(_keys_${CATEGORY} "")
+endmacro()
+
+set(_detail [[,"name":"([A-Za-z]+)","args":{"detail":"(([^"\\]|\\.)*)"]])
+file(GLOB_RECURSE _traces LIST_DIRECTORIES false "${BUILD_DIR}/*.json")
+set(_targets "")
+foreach (_trace ${_traces})
+    if (NOT _trace MATCHES "/CMakeFiles/([^/]+)\\.dir/")
+        continue()
+    endif ()
+    set(_target "${CMAKE_MATCH_1}")
+    file(READ "${_trace}" _head LIMIT 16)
+    if (NOT _head MATCHES "^{\"traceEvents\"")
+        continue()
+    endif ()
+    list(FIND _targets ${_target} _index)
+    if (_index EQUAL -1)
+        list(APPEND _targets ${_target})
+    endif ()
+    list(APPEND _traces_${_target} "${_trace}")
+endforeach ()
+
+if (NOT _targets)
+    message(FATAL_ERROR "No -ftime-trace results below ${BUILD_DIR}, build with ENABLE_BUILD_PROFILING=ON and Clang first")
+endif ()
+
+set(_report "")
+list(SORT _targets)
+foreach (_target ${_targets})
+    set(_total 0)
+    foreach (_trace ${_traces_${_target}})
+        file(READ "${_trace}" _json)
+        string(REGEX REPLACE "^.*/CMakeFiles/[^/]+\\.dir/(.*)\\.json$" "\\1" _unit "${_trace}")
+
+        if (_json MATCHES "\"dur\":([0-9]+),\"name\":\"ExecuteCompiler\"")
+            _profile_add(units _unit ${CMAKE_MATCH_1})
+            math(EXPR _total "${_total} + ${CMAKE_MATCH_1}")
+        endif ()
+
+        # Complete events carrying a file or template in args.detail
+        string(REGEX MATCHALL "\"dur\":[0-9]+${_detail}" _events "${_json}")
+        foreach (_event ${_events})
+            if (NOT _event MATCHES "^\"dur\":([0-9]+)${_detail}")
+                continue()
+            endif ()
+            set(_duration ${CMAKE_MATCH_1})
+            set(_kind "${CMAKE_MATCH_2}")
+            string(REPLACE "\\\\" "\\" _name "${CMAKE_MATCH_3}")
+            string(REPLACE "\\\"" "\"" _name "${_name}")
+            if (_kind STREQUAL "Source")
+                _profile_add(headers _name ${_duration})
+            elseif (_kind MATCHES "^Instantiate(Class|Function)$")
+                _profile_add(templates _name ${_duration})
+            endif ()
+        endforeach ()
+    endforeach ()
+
+    list(LENGTH _traces_${_target} _unit_count)
+    math(EXPR _total_ms "${_total} / 1000")
+    string(APPEND _report "${_target}: ${_unit_count} translation unit(s), ${_total_ms} ms\n")
+    _profile_rank(units "Slowest translation units")
+    _profile_rank(headers "Most expensive headers (parse time, all includes)")
+    _profile_rank(templates "Most expensive template instantiations")
+    string(APPEND _report "\n")
+endforeach ()
+
+file(WRITE "${REPORT}" "${_report}")
+message("${_report}Report written to ${REPORT}")
+]=])
+
+    add_custom_target(build-profile
+            COMMAND ${CMAKE_COMMAND}
+            "-DBUILD_DIR=${CMAKE_BINARY_DIR}"
+            "-DREPORT=${CMAKE_BINARY_DIR}/build-profile.txt"
+            -P "${_script}"
+            COMMENT "Ranking compile times of the profiled targets"
+            VERBATIM
+    )
+endfunction()
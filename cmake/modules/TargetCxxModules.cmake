@@ -0,0 +1,254 @@
+include_guard(DIRECTORY)
+include(GetCurrentCompiler)
+include(ToolchainProfile)
+include(ConfigureQuiet)
+
+#
+# usage:
+# target_enable_cxx_modules(
+#   TARGET_NAME
+#   [IMPORT_STD ON/OFF]         # Override ENABLE_IMPORT_STD for this target
+# )
+#
+# C++20 module handling of TARGET_NAME (register_*() call it for every target):
+#   import std - builds the target as C++23 with CXX_MODULE_STD, so `import std;` can replace the standard headers.
+#                The std module is compiled once per set of module flags and shared by every target using it.
+#                Needs CMake 3.30+ and a standard library that ships the module (libc++ 17+ with clang 18+, MSVC 17.10+).
+#                Defines CXX_IMPORT_STD=1 where it is available, sources keep their #include fallback otherwise
+#   scanning   - CMake 3.28+ scans every C++20 source for imports. Targets without module sources, import std or a
+#                linked library exporting modules skip the scan (CXX_SCAN_FOR_MODULES OFF). Decided once every target
+#                and link is known, a CXX_SCAN_FOR_MODULES set on the target (or CMAKE_CXX_SCAN_FOR_MODULES) is kept
+#   generator  - targets with modules are checked against the generator once: Ninja 1.11+, Visual Studio 17.4+ or
+#                Makefiles, see cxx_modules_supported()
+#
+function(target_enable_cxx_modules TARGET_NAME)
+    set(oneValueArgs
+            IMPORT_STD
+    )
+    cmake_parse_arguments(ARG "" "${oneValueArgs}" "" ${ARGN})
+
+    #
+
+    if (NOT TARGET ${TARGET_NAME})
+        message(FATAL_ERROR "target_enable_cxx_modules: Target '${TARGET_NAME}' does not exist")
+    endif ()
+
+    # Interface and imported targets compile nothing
+    get_target_property(_type ${TARGET_NAME} TYPE)
+    get_target_property(_imported ${TARGET_NAME} IMPORTED)
+    if (_type STREQUAL "INTERFACE_LIBRARY" OR _imported)
+        return()
+    endif ()
+
+    # Configure once, so register_*() and explicit calls can both call this
+    get_target_property(_configured ${TARGET_NAME} _CXX_MODULES_CONFIGURED)
+    if (_configured)
+        return()
+    endif ()
+    set_target_properties(${TARGET_NAME} PROPERTIES _CXX_MODULES_CONFIGURED TRUE)
+
+    set(IMPORT_STD_VALUE ${ENABLE_IMPORT_STD})
+    if (DEFINED ARG_IMPORT_STD)
+        set(IMPORT_STD_VALUE ${ARG_IMPORT_STD})
+    endif ()
+
+    get_target_property(_module_sets ${TARGET_NAME} CXX_MODULE_SETS)
+    if (_module_sets)
+        _check_cxx_modules_generator()
+    endif ()
+
+    if (IMPORT_STD_VALUE)
+        _target_use_import_std(${TARGET_NAME})
+    endif ()
+
+    # Sources and links are still added after this call, scanning is decided once everything is known
+    if (CMAKE_VERSION VERSION_GREATER_EQUAL 3.28)
+        get_property(_tracked GLOBAL PROPERTY _CXX_MODULES_TARGETS)
+        set_property(GLOBAL APPEND PROPERTY _CXX_MODULES_TARGETS ${TARGET_NAME})
+        if (NOT _tracked)
+            cmake_language(DEFER DIRECTORY "${CMAKE_SOURCE_DIR}" CALL _resolve_cxx_module_scanning)
+        endif ()
+    endif ()
+endfunction()
+
+#
+# usage:
+# cxx_modules_supported(
+#   RESULT_VAR
+#   [REASON <var>]              # Why not, empty when supported
+# )
+#
+# Whether this CMake, generator and compiler can build C++20 named modules:
+#   CMake 3.28+; Ninja 1.11+, Visual Studio 17.4+ or Makefiles; GCC 14+, Clang 16+ or MSVC 19.34+ (not Emscripten)
+#
+function(cxx_modules_supported RESULT_VAR)
+    cmake_parse_arguments(ARG "" "REASON" "" ${ARGN})
+
+    set(_reason "")
+    get_current_compiler(CURRENT_COMPILER)
+    if (CMAKE_VERSION VERSION_LESS 3.28)
+        set(_reason "CMake ${CMAKE_VERSION} cannot build C++20 modules, 3.28 or newer is needed")
+    elseif (CMAKE_GENERATOR MATCHES "Ninja")
+        _get_ninja_version(_ninja_version)
+        if (_ninja_version AND _ninja_version VERSION_LESS 1.11)
+            set(_reason "Ninja ${_ninja_version} (${CMAKE_MAKE_PROGRAM}) has no dyndep support for modules, 1.11 or newer is needed")
+        endif ()
+    elseif (CMAKE_GENERATOR MATCHES "Visual Studio")
+        if (MSVC_VERSION LESS 1934)
+            set(_reason "Visual Studio ${MSVC_VERSION} cannot build C++20 modules, 17.4 or newer is needed")
+        endif ()
+    elseif (NOT CMAKE_GENERATOR MATCHES "Makefiles")
+        set(_reason "The ${CMAKE_GENERATOR} generator cannot build C++20 modules, use a Ninja preset (Ninja 1.11+)")
+    endif ()
+
+    if (NOT _reason)
+        if ("${CURRENT_COMPILER}" STREQUAL "EMSCRIPTEN")
+            set(_reason "Emscripten ships no module dependency scanner (clang-scan-deps)")
+        elseif ("${CURRENT_COMPILER}" STREQUAL "GCC" AND CMAKE_CXX_COMPILER_VERSION VERSION_LESS 14)
+            set(_reason "GCC ${CMAKE_CXX_COMPILER_VERSION} has no module dependency scanning, 14 or newer is needed")
+        elseif ("${CURRENT_COMPILER}" MATCHES "^CLANG" AND CMAKE_CXX_COMPILER_VERSION VERSION_LESS 16)
+            set(_reason "Clang ${CMAKE_CXX_COMPILER_VERSION} has no module dependency scanning, 16 or newer is needed")
+        elseif ("${CURRENT_COMPILER}" STREQUAL "MSVC" AND CMAKE_CXX_COMPILER_VERSION VERSION_LESS 19.34)
+            set(_reason "MSVC ${CMAKE_CXX_COMPILER_VERSION} has no module dependency scanning, 19.34 (17.4) or newer is needed")
+        endif ()
+    endif ()
+
+    if (_reason)
+        set(${RESULT_VAR} FALSE PARENT_SCOPE)
+    else ()
+        set(${RESULT_VAR} TRUE PARENT_SCOPE)
+    endif ()
+    if (ARG_REASON)
+        set(${ARG_REASON} "${_reason}" PARENT_SCOPE)
+    endif ()
+endfunction()
+
+#
+
+# Helper function to stop the configure run when modules cannot be built here, checked once
+function(_check_cxx_modules_generator)
+    get_property(_checked GLOBAL PROPERTY _CXX_MODULES_GENERATOR_CHECKED)
+    if (_checked)
+        return()
+    endif ()
+    set_property(GLOBAL PROPERTY _CXX_MODULES_GENERATOR_CHECKED TRUE)
+
+    cxx_modules_supported(_supported REASON _reason)
+    if (NOT _supported)
+        message(FATAL_ERROR "C++20 modules: ${_reason}")
+    endif ()
+endfunction()
+
+# Helper function to get the version of the Ninja used by the generator, kept in the toolchain profile
+function(_get_ninja_version RESULT_VAR)
+    string(MD5 _key "${CMAKE_MAKE_PROGRAM}")
+    string(SUBSTRING "${_key}" 0 12 _key)
+
+    toolchain_profile_get(NINJA_VERSION_${_key} _version)
+    if (NOT _version_FOUND)
+        execute_process(
+                COMMAND "${CMAKE_MAKE_PROGRAM}" --version
+                OUTPUT_VARIABLE _version
+                OUTPUT_STRIP_TRAILING_WHITESPACE
+                ERROR_QUIET
+                RESULT_VARIABLE _result
+        )
+        if (NOT _result EQUAL 0)
+            set(_version "")
+        endif ()
+        toolchain_profile_set(NINJA_VERSION_${_key} "${_version}")
+    endif ()
+    set(${RESULT_VAR} "${_version}" PARENT_SCOPE)
+endfunction()
+
+# Helper function to build TARGET_NAME against the std module, or keep its #include fallback where it is missing
+function(_target_use_import_std TARGET_NAME)
+    if (CMAKE_VERSION VERSION_LESS 3.30)
+        status_once(CXX_MODULES_IMPORT_STD_CMAKE "** import std needs CMake 3.30 or newer, ENABLE_IMPORT_STD is ignored")
+        return()
+    endif ()
+    if (NOT "23" IN_LIST CMAKE_CXX_COMPILER_IMPORT_STD)
+        status_once(CXX_MODULES_IMPORT_STD_COMPILER
+                "** ${CMAKE_CXX_COMPILER_ID} ${CMAKE_CXX_COMPILER_VERSION} provides no std module here (clang needs -stdlib=libc++, newer CMake versions need their CMAKE_EXPERIMENTAL_CXX_IMPORT_STD value), ENABLE_IMPORT_STD is ignored")
+        return()
+    endif ()
+    _check_cxx_modules_generator()
+
+    # The same standard and extensions on every import std target, so they share one std module build
+    target_compile_features(${TARGET_NAME} PRIVATE cxx_std_23)
+    set_target_properties(${TARGET_NAME} PROPERTIES
+            CXX_MODULE_STD ON
+            CXX_EXTENSIONS OFF
+    )
+    target_compile_definitions(${TARGET_NAME} PRIVATE CXX_IMPORT_STD=1)
+    message(STATUS "** import std enabled for target: ${TARGET_NAME}")
+endfunction()
+
+# Helper function to tell whether TARGET_NAME, or a library it links, provides modules. VISITED_VAR lists checked targets.
+function(_target_uses_cxx_modules TARGET_NAME RESULT_VAR VISITED_VAR)
+    set(${RESULT_VAR} FALSE PARENT_SCOPE)
+    set(_visited ${${VISITED_VAR}} ${TARGET_NAME})
+    set(${VISITED_VAR} ${_visited} PARENT_SCOPE)
+
+    get_target_property(_type ${TARGET_NAME} TYPE)
+    set(_properties INTERFACE_CXX_MODULE_SETS INTERFACE_LINK_LIBRARIES)
+    if (NOT _type STREQUAL "INTERFACE_LIBRARY")
+        list(APPEND _properties CXX_MODULE_SETS CXX_MODULE_STD LINK_LIBRARIES)
+    endif ()
+    foreach (_property ${_properties})
+        get_target_property(_value ${TARGET_NAME} ${_property})
+        if (NOT _value)
+            continue()
+        endif ()
+        if (NOT _property MATCHES "LINK_LIBRARIES$")
+            set(${RESULT_VAR} TRUE PARENT_SCOPE)
+            return()
+        endif ()
+
+        foreach (_library ${_value})
+            # $<LINK_ONLY:lib> and other plain wrappers, conditions are followed as if they were true
+            string(REGEX REPLACE "^\\$<[A-Z_]+:(.*)>$" "\\1" _library "${_library}")
+            if (NOT TARGET "${_library}")
+                continue()
+            endif ()
+            get_target_property(_aliased "${_library}" ALIASED_TARGET)
+            if (_aliased)
+                set(_library ${_aliased})
+            endif ()
+            if (_library IN_LIST _visited)
+                continue()
+            endif ()
+            _target_uses_cxx_modules(${_library} _uses _visited)
+            if (_uses)
+                set(${RESULT_VAR} TRUE PARENT_SCOPE)
+                set(${VISITED_VAR} ${_visited} PARENT_SCOPE)
+                return()
+            endif ()
+        endforeach ()
+    endforeach ()
+    set(${VISITED_VAR} ${_visited} PARENT_SCOPE)
+endfunction()
+
+# Helper function to turn module scanning off for tracked targets that have no use for it (deferred)
+function(_resolve_cxx_module_scanning)
+    get_property(_targets GLOBAL PROPERTY _CXX_MODULES_TARGETS)
+    set(_skipped "")
+    foreach (_target ${_targets})
+        get_target_property(_scan ${_target} CXX_SCAN_FOR_MODULES)
+        if (NOT _scan STREQUAL "_scan-NOTFOUND")
+            continue()
+        endif ()
+
+        set(_visited "")
+        _target_uses_cxx_modules(${_target} _uses _visited)
+        if (NOT _uses)
+            set_target_properties(${_target} PROPERTIES CXX_SCAN_FOR_MODULES OFF)
+            list(APPEND _skipped ${_target})
+        endif ()
+    endforeach ()
+
+    if (_skipped)
+        list(LENGTH _skipped _count)
+        message(VERBOSE "** Module scanning skipped for ${_count} targets without modules: ${_skipped}")
+    endif ()
+endfunction()
@@ -1,5 +1,6 @@
 include_guard(DIRECTORY)
 include(CheckCXXCompilerFlag)
+include(CheckLinkerFlag)
 include(GetCurrentCompiler)
 
 #
@@ -9,6 +10,7 @@ include(GetCurrentCompiler)
 #   [ENABLE_EDIT_AND_CONTINUE]
 #   [ENABLE_DEBUG_INFO]
 #   [DEBUG_INFO_LEVEL level]  # 0-3 for GCC/Clang, ignored for MSVC
+#   [DEBUG_INFO_FORMAT format] # default|split|compressed|both, see DEBUG_INFO_FORMAT
 # )
 #
 function(target_enable_debug_options TARGET_NAME)
@@ -16,6 +18,7 @@ function(target_enable_debug_options TARGET_NAME)
             ENABLE_EDIT_AND_CONTINUE
             ENABLE_DEBUG_INFO
             DEBUG_INFO_LEVEL
+            DEBUG_INFO_FORMAT
     )
     
     cmake_parse_arguments(ARG
@@ -36,6 +39,10 @@ function(target_enable_debug_options TARGET_NAME)
     endif ()
     message(STATUS "Configuring debug options for target '${TARGET_NAME}' (${CURRENT_COMPILER})")
 
+    if (NOT DEFINED ARG_DEBUG_INFO_FORMAT)
+        set(ARG_DEBUG_INFO_FORMAT ${DEBUG_INFO_FORMAT})
+    endif ()
+
     get_current_compiler(CURRENT_COMPILER)
     if ("${CURRENT_COMPILER}" MATCHES "MSVC|CLANG-MSVC")
         _configure_msvc_debug_options(${TARGET_NAME} PRIVATE
@@ -46,6 +53,16 @@ function(target_enable_debug_options TARGET_NAME)
     else ()
         message(STATUS "Debug options not configured for compiler: ${CURRENT_COMPILER}")
     endif ()
+
+    if (ARG_ENABLE_DEBUG_INFO AND NOT ARG_ENABLE_EDIT_AND_CONTINUE)
+        _get_debug_info_format_options("${ARG_DEBUG_INFO_FORMAT}" FORMAT_COMPILE_OPTIONS FORMAT_LINK_OPTIONS)
+        if (FORMAT_COMPILE_OPTIONS)
+            target_compile_options(${TARGET_NAME} PRIVATE ${FORMAT_COMPILE_OPTIONS})
+        endif ()
+        if (FORMAT_LINK_OPTIONS)
+            target_link_options(${TARGET_NAME} PRIVATE ${FORMAT_LINK_OPTIONS})
+        endif ()
+    endif ()
 endfunction()
 
 #
@@ -78,6 +95,17 @@ function(enable_global_debug_options)
         message(STATUS "Global debug options not configured for compiler: ${CURRENT_COMPILER}")
     endif ()
 
+    # Directory-level options instead of cached flags, so reconfiguring does not stack them
+    if (ENABLE_DEBUG_INFO AND NOT ENABLE_EDIT_AND_CONTINUE)
+        _get_debug_info_format_options("${DEBUG_INFO_FORMAT}" FORMAT_COMPILE_OPTIONS FORMAT_LINK_OPTIONS)
+        if (FORMAT_COMPILE_OPTIONS)
+            add_compile_options(${FORMAT_COMPILE_OPTIONS})
+        endif ()
+        if (FORMAT_LINK_OPTIONS)
+            add_link_options(${FORMAT_LINK_OPTIONS})
+        endif ()
+    endif ()
+
     set_property(GLOBAL PROPERTY PROJECT_GLOBAL_DEBUG_OPTIONS_ENABLED TRUE)
 endfunction()
 
@@ -161,6 +189,10 @@ function(_configure_global_msvc_debug_options)
         message(STATUS "  - Global Edit and Continue: enabled (/ZI)")
         message(STATUS "  - Global incremental linking: enabled (Debug builds)")
 
+    elseif (${ENABLE_DEBUG_INFO} AND DEBUG_INFO_FORMAT MATCHES "^(split|both)$")
+        # /Z7 is added by _get_debug_info_format_options(), /Zi would only trigger D9025 overrides
+        message(STATUS "  - Global debug information: enabled (/Z7, see DEBUG_INFO_FORMAT)")
+
     elseif (${ENABLE_DEBUG_INFO})
         # Apply basic debug info globally
         set(CMAKE_CXX_FLAGS_DEBUG "${CMAKE_CXX_FLAGS_DEBUG} /Zi" CACHE STRING "Global CXX Debug flags with debug info" FORCE)
@@ -197,3 +229,91 @@ function(_configure_global_gcc_clang_debug_options)
         endif ()
     endif ()
 endfunction()
+
+# Helper function to get the flags of a DEBUG_INFO_FORMAT (default|split|compressed|both)
+#   split      - GCC/Clang: -gsplit-dwarf (+ --gdb-index when the linker supports it), MSVC: /Z7 + /DEBUG:FASTLINK
+#   compressed - GCC/Clang: -gz=zstd (zlib fallback) for objects and the linked image
+#   both       - split + compressed
+function(_get_debug_info_format_options FORMAT COMPILE_OPTIONS_VAR LINK_OPTIONS_VAR)
+    set(_compile_options "")
+    set(_link_options "")
+    string(TOLOWER "${FORMAT}" FORMAT)
+
+    if (FORMAT STREQUAL "" OR FORMAT STREQUAL "default")
+        set(${COMPILE_OPTIONS_VAR} "" PARENT_SCOPE)
+        set(${LINK_OPTIONS_VAR} "" PARENT_SCOPE)
+        return()
+    endif ()
+    if (NOT FORMAT MATCHES "^(split|compressed|both)$")
+        message(FATAL_ERROR "Unknown DEBUG_INFO_FORMAT '${FORMAT}' (expected default, split, compressed or both)")
+    endif ()
+
+    set(_split OFF)
+    set(_compressed OFF)
+    if (FORMAT MATCHES "^(split|both)$")
+        set(_split ON)
+    endif ()
+    if (FORMAT MATCHES "^(compressed|both)$")
+        set(_compressed ON)
+    endif ()
+
+    get_current_compiler(CURRENT_COMPILER)
+    if ("${CURRENT_COMPILER}" MATCHES "MSVC|CLANG-MSVC")
+        # Debug info stays in the objects, the linker references it instead of merging a full PDB
+        if (_split)
+            list(APPEND _compile_options /Z7)
+            list(APPEND _link_options /DEBUG:FASTLINK)
+            message(STATUS "  - Debug information format: /Z7 + /DEBUG:FASTLINK")
+        endif ()
+        if (_compressed)
+            message(STATUS "  - Debug information compression: not available for MSVC, skipped")
+        endif ()
+
+    elseif ("${CURRENT_COMPILER}" MATCHES "CLANG|GCC")
+        if (_split AND APPLE)
+            message(STATUS "  - Split DWARF: not supported with Mach-O, skipped")
+        elseif (_split AND "${CURRENT_COMPILER}" STREQUAL "GCC")
+            # GCC drops -gsplit-dwarf with a note per translation unit when LTO is on, so LTO targets keep plain DWARF
+            list(APPEND _compile_options "$<$<NOT:$<BOOL:$<TARGET_PROPERTY:INTERPROCEDURAL_OPTIMIZATION>>>:-gsplit-dwarf>")
+            if (ENABLE_GLOBAL_IPO OR CMAKE_INTERPROCEDURAL_OPTIMIZATION)
+                message(STATUS "  - Split DWARF: skipped for IPO targets, GCC doesn't support -gsplit-dwarf with LTO")
+            else ()
+                message(STATUS "  - Split DWARF: enabled (-gsplit-dwarf, targets with IPO excepted)")
+            endif ()
+        elseif (_split)
+            list(APPEND _compile_options -gsplit-dwarf)
+            message(STATUS "  - Split DWARF: enabled (-gsplit-dwarf)")
+        endif ()
+
+        if (_split AND NOT APPLE)
+            # bfd has no --gdb-index, gold/lld/mold build the index from the pubnames sections
+            check_linker_flag(CXX "${LINKER_SELECTED_FLAG};LINKER:--gdb-index" LINKER_SUPPORTS_GDB_INDEX_${LINKER_SELECTED})
+            if (LINKER_SUPPORTS_GDB_INDEX_${LINKER_SELECTED})
+                list(APPEND _compile_options -ggnu-pubnames)
+                list(APPEND _link_options LINKER:--gdb-index)
+                message(STATUS "  - GDB index: enabled (--gdb-index)")
+            endif ()
+        endif ()
+
+        if (_compressed)
+            check_cxx_compiler_flag(-gz=zstd COMPILER_SUPPORTS_GZ_ZSTD)
+            check_cxx_compiler_flag(-gz COMPILER_SUPPORTS_GZ)
+            if (COMPILER_SUPPORTS_GZ_ZSTD)
+                set(_gz -gz=zstd)
+            elseif (COMPILER_SUPPORTS_GZ)
+                set(_gz -gz)
+            else ()
+                set(_gz "")
+                message(STATUS "  - Debug information compression: not supported, skipped")
+            endif ()
+            if (_gz)
+                list(APPEND _compile_options ${_gz})
+                list(APPEND _link_options ${_gz})
+                message(STATUS "  - Debug information compression: enabled (${_gz})")
+            endif ()
+        endif ()
+    endif ()
+
+    set(${COMPILE_OPTIONS_VAR} ${_compile_options} PARENT_SCOPE)
+    set(${LINK_OPTIONS_VAR} ${_link_options} PARENT_SCOPE)
+endfunction()
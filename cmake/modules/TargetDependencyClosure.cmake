@@ -0,0 +1,124 @@
+include_guard(DIRECTORY)
+
+#
+# usage:
+#   get_target_dependency_closure(TARGET_NAME RESULT_VAR)
+#
+# Sets RESULT_VAR to every target reachable from TARGET_NAME through LINK_LIBRARIES and
+# INTERFACE_LINK_LIBRARIES, in discovery order, aliases resolved and TARGET_NAME excluded.
+#
+# Each closure is memoized in GLOBAL properties and reused until the link libraries of the
+# target, or of any target in its closure, change.
+#
+function(get_target_dependency_closure TARGET_NAME RESULT_VAR)
+    if (NOT TARGET ${TARGET_NAME})
+        message(FATAL_ERROR "get_target_dependency_closure: Target '${TARGET_NAME}' does not exist")
+    endif ()
+
+    _resolve_dependency_target(${TARGET_NAME} _target)
+    _get_target_dependency_closure(${_target} _closure _cycle)
+
+    # Targets in a link cycle reach themselves
+    list(REMOVE_ITEM _closure ${_target})
+    set(${RESULT_VAR} ${_closure} PARENT_SCOPE)
+endfunction()
+
+#
+# usage:
+#   get_target_shared_dependencies(TARGET_NAME RESULT_VAR)
+#
+# Same as get_target_dependency_closure(), keeping only SHARED_LIBRARY targets
+#
+function(get_target_shared_dependencies TARGET_NAME RESULT_VAR)
+    get_target_dependency_closure(${TARGET_NAME} _closure)
+
+    set(_shared "")
+    foreach (_dep ${_closure})
+        get_target_property(_type ${_dep} TYPE)
+        if (_type STREQUAL "SHARED_LIBRARY")
+            list(APPEND _shared ${_dep})
+        endif ()
+    endforeach ()
+
+    set(${RESULT_VAR} ${_shared} PARENT_SCOPE)
+endfunction()
+
+#
+
+# Helper function to map an alias to the target it names
+function(_resolve_dependency_target TARGET_NAME RESULT_VAR)
+    get_target_property(_aliased ${TARGET_NAME} ALIASED_TARGET)
+    if (_aliased)
+        set(${RESULT_VAR} ${_aliased} PARENT_SCOPE)
+    else ()
+        set(${RESULT_VAR} ${TARGET_NAME} PARENT_SCOPE)
+    endif ()
+endfunction()
+
+# Helper function to hash the link libraries of a list of targets, a memoized closure is valid while this is unchanged
+function(_get_dependency_fingerprint TARGETS RESULT_VAR)
+    set(_links "")
+    foreach (_target ${TARGETS})
+        get_property(_direct TARGET ${_target} PROPERTY LINK_LIBRARIES)
+        get_property(_interface TARGET ${_target} PROPERTY INTERFACE_LINK_LIBRARIES)
+        string(APPEND _links "${_target}:${_direct}|${_interface}\n")
+    endforeach ()
+
+    string(MD5 _fingerprint "${_links}")
+    set(${RESULT_VAR} ${_fingerprint} PARENT_SCOPE)
+endfunction()
+
+# Helper function to compute (or reuse) the closure of a resolved target.
+# CYCLE_VAR is set when the walk ran into a target still being walked, such partial closures are not memoized.
+function(_get_target_dependency_closure TARGET_NAME CLOSURE_VAR CYCLE_VAR)
+    set(${CYCLE_VAR} FALSE PARENT_SCOPE)
+
+    get_property(_memoized GLOBAL PROPERTY _DEPENDENCY_CLOSURE_${TARGET_NAME} SET)
+    if (_memoized)
+        get_property(_closure GLOBAL PROPERTY _DEPENDENCY_CLOSURE_${TARGET_NAME})
+        get_property(_fingerprint GLOBAL PROPERTY _DEPENDENCY_CLOSURE_FINGERPRINT_${TARGET_NAME})
+        _get_dependency_fingerprint("${TARGET_NAME};${_closure}" _current)
+        if (_current STREQUAL _fingerprint)
+            set(${CLOSURE_VAR} ${_closure} PARENT_SCOPE)
+            return()
+        endif ()
+    endif ()
+
+    get_property(_active GLOBAL PROPERTY _DEPENDENCY_CLOSURE_ACTIVE_${TARGET_NAME})
+    if (_active)
+        set(${CLOSURE_VAR} "" PARENT_SCOPE)
+        set(${CYCLE_VAR} TRUE PARENT_SCOPE)
+        return()
+    endif ()
+    set_property(GLOBAL PROPERTY _DEPENDENCY_CLOSURE_ACTIVE_${TARGET_NAME} TRUE)
+
+    get_property(_direct TARGET ${TARGET_NAME} PROPERTY LINK_LIBRARIES)
+    get_property(_interface TARGET ${TARGET_NAME} PROPERTY INTERFACE_LINK_LIBRARIES)
+
+    set(_closure "")
+    set(_partial FALSE)
+    foreach (_dep ${_direct} ${_interface})
+        if (NOT TARGET ${_dep})
+            continue()
+        endif ()
+        _resolve_dependency_target(${_dep} _dep)
+        _get_target_dependency_closure(${_dep} _dep_closure _dep_cycle)
+        list(APPEND _closure ${_dep} ${_dep_closure})
+        if (_dep_cycle)
+            set(_partial TRUE)
+        endif ()
+    endforeach ()
+
+    # REMOVE_DUPLICATES keeps the first occurrence and runs in linear time, unlike IN_LIST checks per target
+    list(REMOVE_DUPLICATES _closure)
+    set_property(GLOBAL PROPERTY _DEPENDENCY_CLOSURE_ACTIVE_${TARGET_NAME} FALSE)
+
+    if (NOT _partial)
+        _get_dependency_fingerprint("${TARGET_NAME};${_closure}" _fingerprint)
+        set_property(GLOBAL PROPERTY _DEPENDENCY_CLOSURE_${TARGET_NAME} "${_closure}")
+        set_property(GLOBAL PROPERTY _DEPENDENCY_CLOSURE_FINGERPRINT_${TARGET_NAME} "${_fingerprint}")
+    endif ()
+
+    set(${CLOSURE_VAR} ${_closure} PARENT_SCOPE)
+    set(${CYCLE_VAR} ${_partial} PARENT_SCOPE)
+endfunction()
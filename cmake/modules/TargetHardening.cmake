@@ -1,16 +1,29 @@
 include_guard(DIRECTORY)
 include(GetCurrentCompiler)
+include(ToolchainProfile)
+include(ConfigureQuiet)
 
 set_property(GLOBAL PROPERTY PROJECT_GLOBAL_HARDENING_ENABLED FALSE)
 
+# Hardening tiers, from cheapest to most thorough
+set(HARDENING_LEVELS none lightweight full)
+
 #
 # usage:
 # target_enable_hardening(
 #   TARGET_NAME
 # 	[PRIVATE|PUBLIC|INTERFACE]
+#   [LEVEL none|lightweight|full]   # Defaults to HARDENING_LEVEL
 # )
 #
+# Levels:
+#   none        - no hardening flags
+#   lightweight - production-cheap checks: _GLIBCXX_ASSERTIONS, _FORTIFY_SOURCE, stack/CF protection, MSVC /guard:cf
+#   full        - lightweight + libstdc++ debug containers (_GLIBCXX_DEBUG, ABI changing) and UBSan minimal runtime
+#
 function(target_enable_hardening TARGET_NAME SCOPE_NAME)
+    cmake_parse_arguments(ARG "" "LEVEL" "" ${ARGN})
+
     # Call once
     get_property(already_registered GLOBAL PROPERTY PROJECT_GLOBAL_HARDENING_ENABLED)
     if (already_registered)
@@ -26,9 +39,19 @@ function(target_enable_hardening TARGET_NAME SCOPE_NAME)
         message(FATAL_ERROR "Invalid SCOPE_NAME '${SCOPE_NAME}' for target_enable_hardening()")
     endif ()
 
+    set(LEVEL_VALUE ${HARDENING_LEVEL})
+    if (DEFINED ARG_LEVEL)
+        set(LEVEL_VALUE ${ARG_LEVEL})
+    endif ()
+    _resolve_hardening_level(LEVEL_VALUE)
+    if (LEVEL_VALUE STREQUAL "none")
+        return()
+    endif ()
+
     _should_enable_ubsan_minimal_runtime(ENABLE_UBSAN_MINIMAL_RUNTIME)
-    _get_hardening_options(NEW_COMPILE_OPTIONS NEW_LINK_OPTIONS NEW_CXX_DEFINITIONS)
+    _get_hardening_options(${LEVEL_VALUE} NEW_COMPILE_OPTIONS NEW_LINK_OPTIONS NEW_CXX_DEFINITIONS)
 
+    message(STATUS "** Hardening level for ${TARGET_NAME}: ${LEVEL_VALUE}")
     message(STATUS "** Hardening Compiler Flags: ${NEW_COMPILE_OPTIONS}")
     message(STATUS "** Hardening Linker Flags: ${NEW_LINK_OPTIONS}")
     message(STATUS "** Hardening Compiler Defines: ${NEW_CXX_DEFINITIONS}")
@@ -60,10 +83,17 @@ function(enable_global_hardening)
         return()
     endif ()
 
-    message(STATUS "** Enable global hardening to all targets and all dependencies")
+    set(LEVEL_VALUE ${HARDENING_LEVEL})
+    _resolve_hardening_level(LEVEL_VALUE)
+    if (LEVEL_VALUE STREQUAL "none")
+        message(STATUS "** Global hardening requested but HARDENING_LEVEL is 'none'")
+        return()
+    endif ()
+
+    message(STATUS "** Enable global hardening (${LEVEL_VALUE}) to all targets and all dependencies")
 
     _should_enable_ubsan_minimal_runtime(ENABLE_UBSAN_MINIMAL_RUNTIME)
-    _get_hardening_options(NEW_COMPILE_OPTIONS NEW_LINK_OPTIONS NEW_CXX_DEFINITIONS)
+    _get_hardening_options(${LEVEL_VALUE} NEW_COMPILE_OPTIONS NEW_LINK_OPTIONS NEW_CXX_DEFINITIONS)
 
     message(STATUS "** Hardening Compiler Flags: ${NEW_COMPILE_OPTIONS}")
     message(STATUS "** Hardening Linker Flags: ${NEW_LINK_OPTIONS}")
@@ -96,6 +126,41 @@ function(enable_global_hardening)
 endfunction()
 
 #
+# usage:
+# get_hardening_level_overhead(
+#   LEVEL
+#   RESULT_VAR
+# )
+#
+# Rough runtime cost of a hardening level, for the configuration summary. LEVEL is resolved like
+# target_enable_hardening() does, so 'Full' or an empty value report the level that is actually applied
+#
+function(get_hardening_level_overhead LEVEL RESULT_VAR)
+    _resolve_hardening_level(LEVEL)
+    if (LEVEL STREQUAL "full")
+        set(${RESULT_VAR} "high, 2-10x+ (checked debug containers, ABI change)" PARENT_SCOPE)
+    elseif (LEVEL STREQUAL "lightweight")
+        set(${RESULT_VAR} "low, ~1-3% (assertions, fortify, stack/CF protection)" PARENT_SCOPE)
+    else ()
+        set(${RESULT_VAR} "none" PARENT_SCOPE)
+    endif ()
+endfunction()
+
+#
+
+# Helper function to validate a hardening level, falling back to lightweight on unknown values
+function(_resolve_hardening_level LEVEL_VAR)
+    set(_level "${${LEVEL_VAR}}")
+    if (_level STREQUAL "")
+        set(_level lightweight)
+    endif ()
+    string(TOLOWER "${_level}" _level)
+    if (NOT _level IN_LIST HARDENING_LEVELS)
+        message(WARNING "Unknown HARDENING_LEVEL '${${LEVEL_VAR}}' (expected one of: ${HARDENING_LEVELS}), using 'lightweight'")
+        set(_level lightweight)
+    endif ()
+    set(${LEVEL_VAR} ${_level} PARENT_SCOPE)
+endfunction()
 
 # Helper function to determine if UBSan minimal runtime should be enabled
 function(_should_enable_ubsan_minimal_runtime RESULT_VAR)
@@ -131,9 +196,15 @@ function(_configure_msvc_hardening COMPILE_OPTIONS_VAR LINK_OPTIONS_VAR DEFINITI
 endfunction()
 
 # Helper function to configure GCC/Clang hardening flags
-function(_configure_gcc_clang_hardening COMPILE_OPTIONS_VAR LINK_OPTIONS_VAR DEFINITIONS_VAR CURRENT_COMPILER)
+function(_configure_gcc_clang_hardening LEVEL COMPILE_OPTIONS_VAR LINK_OPTIONS_VAR DEFINITIONS_VAR CURRENT_COMPILER)
     message(STATUS "*** GLIBC++ Assertions (vector[], string[], ...) enabled")
-    list(APPEND ${DEFINITIONS_VAR} _GLIBCXX_DEBUG _GLIBCXX_DEBUG_PEDANTIC _GLIBCXX_ASSERTIONS)
+    list(APPEND ${DEFINITIONS_VAR} _GLIBCXX_ASSERTIONS)
+
+    # Debug containers change the std:: ABI and complexity guarantees, keep them out of the cheap tier
+    if (LEVEL STREQUAL "full")
+        message(STATUS "*** GLIBC++ debug mode (checked iterators, O(n) checks) enabled")
+        list(APPEND ${DEFINITIONS_VAR} _GLIBCXX_DEBUG _GLIBCXX_DEBUG_PEDANTIC)
+    endif ()
 
     if(NOT CMAKE_BUILD_TYPE MATCHES "Debug")
         message(STATUS "*** g++/clang _FORTIFY_SOURCE=3 enabled")
@@ -173,7 +244,9 @@ function(_configure_gcc_clang_hardening COMPILE_OPTIONS_VAR LINK_OPTIONS_VAR DEF
 
     # UBSan minimal runtime - only enable if compatible with other sanitizers
     _should_enable_ubsan_minimal_runtime(SHOULD_ENABLE_MINIMAL_RUNTIME)
-    if (SHOULD_ENABLE_MINIMAL_RUNTIME)
+    if (NOT LEVEL STREQUAL "full")
+        message(STATUS "*** ubsan minimal runtime NOT enabled (requires HARDENING_LEVEL full)")
+    elseif (SHOULD_ENABLE_MINIMAL_RUNTIME)
         check_cxx_compiler_flag("-fsanitize=undefined -fno-sanitize-recover=undefined -fsanitize-minimal-runtime"
                 MINIMAL_RUNTIME)
 
@@ -193,23 +266,38 @@ function(_configure_gcc_clang_hardening COMPILE_OPTIONS_VAR LINK_OPTIONS_VAR DEF
     set(${DEFINITIONS_VAR} ${${DEFINITIONS_VAR}} PARENT_SCOPE)
 endfunction()
 
-# Helper function to get hardening options for current compiler
-function(_get_hardening_options COMPILE_OPTIONS_VAR LINK_OPTIONS_VAR DEFINITIONS_VAR)
-    get_current_compiler(CURRENT_COMPILER)
-
-    set(NEW_LINK_OPTIONS "")
-    set(NEW_COMPILE_OPTIONS "")
-    set(NEW_CXX_DEFINITIONS "")
+# Helper function to get hardening options for current compiler, probed once per level and kept in the toolchain profile
+function(_get_hardening_options LEVEL COMPILE_OPTIONS_VAR LINK_OPTIONS_VAR DEFINITIONS_VAR)
+    # Everything the probes below depend on besides the compiler, which the toolchain profile is keyed on
+    _should_enable_ubsan_minimal_runtime(_ubsan_minimal_runtime)
+    string(MD5 _key "${LEVEL};${CMAKE_BUILD_TYPE};${ENABLE_EDIT_AND_CONTINUE};${_ubsan_minimal_runtime};${LINUX};${LINKER_SELECTED}")
+    string(SUBSTRING "${_key}" 0 12 _key)
+
+    toolchain_profile_get(HARDENING_${_key}_COMPILE_OPTIONS NEW_COMPILE_OPTIONS)
+    toolchain_profile_get(HARDENING_${_key}_LINK_OPTIONS NEW_LINK_OPTIONS)
+    toolchain_profile_get(HARDENING_${_key}_DEFINITIONS NEW_CXX_DEFINITIONS)
+    if (NOT NEW_COMPILE_OPTIONS_FOUND)
+        configure_quiet_scope()
+        get_current_compiler(CURRENT_COMPILER)
+
+        set(NEW_LINK_OPTIONS "")
+        set(NEW_COMPILE_OPTIONS "")
+        set(NEW_CXX_DEFINITIONS "")
+
+        if ("${CURRENT_COMPILER}" MATCHES "MSVC")
+            _configure_msvc_hardening(NEW_COMPILE_OPTIONS NEW_LINK_OPTIONS NEW_CXX_DEFINITIONS)
+        elseif ("${CURRENT_COMPILER}" MATCHES "CLANG|GCC|EMSCRIPTEN")
+            _configure_gcc_clang_hardening(${LEVEL} NEW_COMPILE_OPTIONS NEW_LINK_OPTIONS NEW_CXX_DEFINITIONS "${CURRENT_COMPILER}")
+        else ()
+            message(STATUS "*** ubsan minimal runtime NOT enabled (not requested)")
+        endif ()
 
-    if ("${CURRENT_COMPILER}" MATCHES "MSVC")
-        _configure_msvc_hardening(NEW_COMPILE_OPTIONS NEW_LINK_OPTIONS NEW_CXX_DEFINITIONS)
-    elseif ("${CURRENT_COMPILER}" MATCHES "CLANG|GCC|EMSCRIPTEN")
-        _configure_gcc_clang_hardening(NEW_COMPILE_OPTIONS NEW_LINK_OPTIONS NEW_CXX_DEFINITIONS "${CURRENT_COMPILER}")
-    else ()
-        message(STATUS "*** ubsan minimal runtime NOT enabled (not requested)")
+        toolchain_profile_set(HARDENING_${_key}_COMPILE_OPTIONS ${NEW_COMPILE_OPTIONS})
+        toolchain_profile_set(HARDENING_${_key}_LINK_OPTIONS ${NEW_LINK_OPTIONS})
+        toolchain_profile_set(HARDENING_${_key}_DEFINITIONS ${NEW_CXX_DEFINITIONS})
     endif ()
 
     set(${COMPILE_OPTIONS_VAR} ${NEW_COMPILE_OPTIONS} PARENT_SCOPE)
     set(${LINK_OPTIONS_VAR} ${NEW_LINK_OPTIONS} PARENT_SCOPE)
     set(${DEFINITIONS_VAR} ${NEW_CXX_DEFINITIONS} PARENT_SCOPE)
-endfunction()
\ No newline at end of file
+endfunction()
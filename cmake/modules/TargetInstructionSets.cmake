@@ -0,0 +1,416 @@
+include_guard(DIRECTORY)
+include(CheckCXXCompilerFlag)
+include(GetCurrentCompiler)
+
+# Instruction sets understood by target_enable_instruction_sets(), in ascending order of preference
+set(TARGET_ISAS_KNOWN sse4.2 avx2 avx512 neon)
+
+#
+# usage:
+# target_enable_instruction_sets(
+#   TARGET_NAME
+#   ISAS <sse4.2|avx2|avx512|neon> ...   # Instruction sets to build variants for
+#   SOURCES <file> ...                   # Sources compiled once per instruction set (and once as baseline)
+# )
+#
+# Each source is compiled into the target once per instruction set the compiler and architecture support,
+# with the ISA flags and <TARGET>_ISA_SUFFIX set to _sse4_2, _avx2, ...; ISAs of other architectures are skipped.
+# The generated <target>_isa_dispatch.hpp (private include) provides:
+#   <TARGET>_ISA_NAME(name)               - name with the suffix of the current compilation, for definitions
+#   <TARGET>_ISA_DECLARE(ret, name, args) - declares the baseline and every variant
+#   <TARGET>_ISA_DISPATCH(name)           - pointer to the best variant the host supports (cpuid / getauxval)
+#
+# Example:
+#   float MYLIB_ISA_NAME(Sum)(const float* data, std::size_t size) { ... }   // kernels.cpp
+#   MYLIB_ISA_DECLARE(float, Sum, (const float*, std::size_t))
+#   static const auto sum = MYLIB_ISA_DISPATCH(Sum);
+#
+function(target_enable_instruction_sets TARGET_NAME)
+    set(multiValueArgs
+            ISAS
+            SOURCES
+    )
+    cmake_parse_arguments(ARG "" "" "${multiValueArgs}" ${ARGN})
+
+    #
+
+    if (NOT TARGET ${TARGET_NAME})
+        message(FATAL_ERROR "target_enable_instruction_sets: Target '${TARGET_NAME}' does not exist")
+    endif ()
+    if (NOT ARG_SOURCES)
+        message(FATAL_ERROR "target_enable_instruction_sets: '${TARGET_NAME}' needs SOURCES to compile per instruction set")
+    endif ()
+
+    # Keep the preference order whatever order the ISAs were listed in
+    set(_isas "")
+    foreach (_isa ${TARGET_ISAS_KNOWN})
+        if (_isa IN_LIST ARG_ISAS)
+            list(APPEND _isas ${_isa})
+        endif ()
+    endforeach ()
+    foreach (_isa ${ARG_ISAS})
+        if (NOT _isa IN_LIST TARGET_ISAS_KNOWN)
+            message(FATAL_ERROR "target_enable_instruction_sets: Unknown ISA '${_isa}' (expected one of: ${TARGET_ISAS_KNOWN})")
+        endif ()
+    endforeach ()
+
+    string(MAKE_C_IDENTIFIER "${TARGET_NAME}" _prefix)
+    string(TOUPPER "${_prefix}" _prefix)
+
+    target_sources(${TARGET_NAME} PRIVATE ${ARG_SOURCES})
+
+    set(_compiled "")
+    foreach (_isa ${_isas})
+        _get_instruction_set_flags(${_isa} _flags _supported)
+        if (NOT _supported)
+            message(STATUS "** ${TARGET_NAME}: ${_isa} variant skipped (not available for ${CMAKE_SYSTEM_PROCESSOR} with ${CMAKE_CXX_COMPILER_ID})")
+            continue()
+        endif ()
+
+        string(MAKE_C_IDENTIFIER "${_isa}" _id)
+        set(_variant ${TARGET_NAME}_isa_${_id})
+        add_library(${_variant} OBJECT ${ARG_SOURCES})
+
+        # Same usage requirements and language settings as the target, plus the ISA flags
+        target_link_libraries(${_variant} PRIVATE "$<TARGET_PROPERTY:${TARGET_NAME},LINK_LIBRARIES>")
+        target_include_directories(${_variant} PRIVATE "$<TARGET_PROPERTY:${TARGET_NAME},INCLUDE_DIRECTORIES>")
+        target_compile_definitions(${_variant} PRIVATE
+                "$<TARGET_PROPERTY:${TARGET_NAME},COMPILE_DEFINITIONS>"
+                ${_prefix}_ISA_SUFFIX=_${_id}
+        )
+        target_compile_options(${_variant} PRIVATE "$<TARGET_PROPERTY:${TARGET_NAME},COMPILE_OPTIONS>" ${_flags})
+        foreach (_property CXX_STANDARD CXX_STANDARD_REQUIRED CXX_EXTENSIONS POSITION_INDEPENDENT_CODE)
+            get_target_property(_value ${TARGET_NAME} ${_property})
+            if (NOT _value STREQUAL "_value-NOTFOUND")
+                set_target_properties(${_variant} PROPERTIES ${_property} "${_value}")
+            endif ()
+        endforeach ()
+        get_target_property(_type ${TARGET_NAME} TYPE)
+        if (_type MATCHES "^(SHARED|MODULE)_LIBRARY$")
+            set_target_properties(${_variant} PROPERTIES POSITION_INDEPENDENT_CODE ON)
+        endif ()
+        # Every variant defines the same names apart from the suffix, merging them would clash
+        set_target_properties(${_variant} PROPERTIES UNITY_BUILD OFF)
+
+        target_sources(${TARGET_NAME} PRIVATE $<TARGET_OBJECTS:${_variant}>)
+        list(APPEND _compiled ${_isa})
+    endforeach ()
+
+    set(_header_dir "${CMAKE_CURRENT_BINARY_DIR}/${TARGET_NAME}_isa")
+    string(TOLOWER "${_prefix}_isa_dispatch.hpp" _header_name)
+    _write_instruction_set_dispatch_header("${_header_dir}/${_header_name}" ${_prefix} "${_compiled}")
+    target_include_directories(${TARGET_NAME} PRIVATE "$<BUILD_INTERFACE:${_header_dir}>")
+
+    string(JOIN ", " _compiled_list baseline ${_compiled})
+    message(STATUS "** ${TARGET_NAME}: instruction set variants: ${_compiled_list} (header: ${_header_name})")
+endfunction()
+
+#
+# usage:
+# target_set_march(
+#   TARGET_NAME
+#   <native|x86-64-v2|x86-64-v3|x86-64-v4|armv8.2-a|...>
+# )
+#
+# Compiles TARGET_NAME for one fixed CPU level, for binaries that only run on known hosts.
+# MSVC maps x86-64-v3 to /arch:AVX2 and x86-64-v4 to /arch:AVX512 and has no 'native'.
+#
+function(target_set_march TARGET_NAME MARCH_VALUE)
+    if (NOT TARGET ${TARGET_NAME})
+        message(FATAL_ERROR "target_set_march: Target '${TARGET_NAME}' does not exist")
+    endif ()
+
+    _get_march_flags("${MARCH_VALUE}" _flags)
+    if (_flags)
+        target_compile_options(${TARGET_NAME} PRIVATE ${_flags})
+    endif ()
+endfunction()
+
+#
+# usage:
+# enable_global_march()
+#
+# Applies MARCH to every target and dependency
+#
+function(enable_global_march)
+    # Call once
+    get_property(already_registered GLOBAL PROPERTY PROJECT_GLOBAL_MARCH_ENABLED)
+    if (already_registered OR NOT MARCH)
+        return()
+    endif ()
+
+    _get_march_flags("${MARCH}" _flags)
+    if (NOT _flags)
+        return()
+    endif ()
+
+    message(STATUS "** Enable global CPU level: ${_flags}")
+    if (MARCH STREQUAL "native" AND COMPILER_CACHE_REMOTE)
+        # The command line is the same on every host, the generated code is not
+        message(WARNING "MARCH=native with a remote compiler cache shares objects between hosts with different CPUs")
+    endif ()
+
+    add_compile_options(${_flags})
+    set_property(GLOBAL PROPERTY PROJECT_GLOBAL_MARCH_ENABLED TRUE)
+endfunction()
+
+#
+
+# Helper function to get the compiler flags of an instruction set, SUPPORTED_VAR is false when the
+# architecture or compiler cannot build it
+function(_get_instruction_set_flags ISA FLAGS_VAR SUPPORTED_VAR)
+    set(${FLAGS_VAR} "" PARENT_SCOPE)
+    set(${SUPPORTED_VAR} FALSE PARENT_SCOPE)
+
+    get_current_compiler(_compiler)
+    if (_compiler STREQUAL "EMSCRIPTEN")
+        return()
+    endif ()
+
+    string(TOLOWER "${CMAKE_SYSTEM_PROCESSOR}" _processor)
+    if (_processor MATCHES "^(x86_64|amd64|x64|i[3-6]86|x86)$")
+        set(_arch x86)
+    elseif (_processor MATCHES "^(aarch64|arm64)")
+        set(_arch arm64)
+    elseif (_processor MATCHES "^arm")
+        set(_arch arm)
+    else ()
+        return()
+    endif ()
+
+    set(_flags "")
+    if (ISA STREQUAL "neon")
+        if (_arch STREQUAL "arm64")
+            # Part of the baseline
+            set(${SUPPORTED_VAR} TRUE PARENT_SCOPE)
+            return()
+        elseif (NOT _arch STREQUAL "arm")
+            return()
+        endif ()
+        if (NOT _compiler STREQUAL "MSVC")
+            set(_flags -mfpu=neon)
+        endif ()
+    elseif (NOT _arch STREQUAL "x86")
+        return()
+    elseif (_compiler STREQUAL "MSVC")
+        # Intrinsics need no flags, /arch only lets the optimizer use the instructions
+        if (ISA STREQUAL "avx2")
+            set(_flags /arch:AVX2)
+        elseif (ISA STREQUAL "avx512")
+            set(_flags /arch:AVX512)
+        endif ()
+    elseif (ISA STREQUAL "sse4.2")
+        set(_flags -msse4.2 -mpopcnt)
+    elseif (ISA STREQUAL "avx2")
+        # x86-64-v3 without the -march, so -mtune and the other defaults stay
+        set(_flags -mavx2 -mfma -mbmi -mbmi2 -mlzcnt -mf16c -mmovbe)
+    elseif (ISA STREQUAL "avx512")
+        # x86-64-v4
+        set(_flags -mavx512f -mavx512bw -mavx512cd -mavx512dq -mavx512vl -mavx2 -mfma -mbmi -mbmi2 -mlzcnt -mf16c -mmovbe)
+    endif ()
+
+    if (_flags)
+        string(MAKE_C_IDENTIFIER "COMPILER_SUPPORTS_ISA_${ISA}" _check)
+        string(TOUPPER "${_check}" _check)
+        string(JOIN " " _flags_string ${_flags})
+        check_cxx_compiler_flag("${_flags_string}" ${_check})
+        if (NOT ${_check})
+            return()
+        endif ()
+    endif ()
+
+    set(${FLAGS_VAR} ${_flags} PARENT_SCOPE)
+    set(${SUPPORTED_VAR} TRUE PARENT_SCOPE)
+endfunction()
+
+# Helper function to map a MARCH value to compiler flags, fails when an explicit request cannot be honoured
+function(_get_march_flags MARCH_VALUE RESULT_VAR)
+    set(${RESULT_VAR} "" PARENT_SCOPE)
+    if (NOT MARCH_VALUE)
+        return()
+    endif ()
+
+    get_current_compiler(_compiler)
+    if (_compiler STREQUAL "EMSCRIPTEN")
+        message(STATUS "** MARCH=${MARCH_VALUE} ignored for Emscripten, use register_emscripten(... SIMD)")
+        return()
+    elseif (_compiler STREQUAL "MSVC")
+        if (MARCH_VALUE STREQUAL "x86-64-v3")
+            set(_flags /arch:AVX2)
+        elseif (MARCH_VALUE STREQUAL "x86-64-v4")
+            set(_flags /arch:AVX512)
+        elseif (MARCH_VALUE MATCHES "^(x86-64|x86-64-v2)$")
+            # The x64 baseline, vectorization above SSE2 needs /arch:AVX or newer
+            return()
+        elseif (MARCH_VALUE MATCHES "^(AVX|AVX2|AVX512|AVX10\\.[0-9]+|armv[0-9.]+)$")
+            set(_flags /arch:${MARCH_VALUE})
+        else ()
+            message(FATAL_ERROR "MARCH '${MARCH_VALUE}' is not supported by MSVC (expected x86-64-v2, x86-64-v3, x86-64-v4 or an /arch value)")
+        endif ()
+    else ()
+        set(_flags -march=${MARCH_VALUE})
+    endif ()
+
+    string(MAKE_C_IDENTIFIER "COMPILER_SUPPORTS_MARCH_${MARCH_VALUE}" _check)
+    string(TOUPPER "${_check}" _check)
+    check_cxx_compiler_flag("${_flags}" ${_check})
+    if (NOT ${_check})
+        message(FATAL_ERROR "MARCH '${MARCH_VALUE}' (${_flags}) is not supported by ${CMAKE_CXX_COMPILER_ID} ${CMAKE_CXX_COMPILER_VERSION}")
+    endif ()
+
+    set(${RESULT_VAR} ${_flags} PARENT_SCOPE)
+endfunction()
+
+# Helper function to write the dispatch header for the compiled instruction sets
+function(_write_instruction_set_dispatch_header FILE PREFIX COMPILED)
+    string(TOLOWER "${PREFIX}_isa" _namespace)
+
+    set(_enumerators "Baseline")
+    set(_defines "")
+    set(_declarations "ret name args;")
+    set(_pointers "&name")
+    set(_order "")
+    set(_checks "")
+    foreach (_isa ${COMPILED})
+        string(MAKE_C_IDENTIFIER "${_isa}" _id)
+        string(TOUPPER "${_id}" _upper)
+        string(SUBSTRING "${_upper}" 0 1 _first)
+        string(SUBSTRING "${_id}" 1 -1 _rest)
+        set(_enumerator "${_first}${_rest}")
+
+        string(APPEND _enumerators ", ${_enumerator}")
+        string(APPEND _defines "#define ${PREFIX}_HAS_ISA_${_upper} 1\n")
+        string(APPEND _declarations " ret name##_${_id} args;")
+        string(APPEND _pointers ", &name##_${_id}")
+        list(APPEND _order "Isa::${_enumerator}")
+        string(APPEND _checks "            case Isa::${_enumerator}:\n                return detail::Has${_enumerator}();\n")
+    endforeach ()
+    string(JOIN ", " _order ${_order})
+
+    set(_select "")
+    if (COMPILED)
+        set(_select "        constexpr Isa order[] = { ${_order} };
+        std::size_t index = 0;
+        ((chosen = IsSupported(order[index++]) ? variants : chosen), ...);
+")
+    endif ()
+
+    file(CONFIGURE OUTPUT "${FILE}" @ONLY CONTENT [=[
+#pragma once
+// Generated by TargetInstructionSets.cmake, do not edit
+
+#include <cstddef>
+
+#if defined(_MSC_VER) && !defined(__clang__) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define @PREFIX@_ISA_CPUID_MSVC 1
+#elif defined(__linux__) && defined(__arm__)
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
+
+@_defines@
+#ifndef @PREFIX@_ISA_SUFFIX
+#define @PREFIX@_ISA_SUFFIX
+#endif
+#define @PREFIX@_ISA_CAT_(a, b) a##b
+#define @PREFIX@_ISA_CAT(a, b) @PREFIX@_ISA_CAT_(a, b)
+
+// Name of the variant being compiled, for definitions in the ISA sources
+#define @PREFIX@_ISA_NAME(name) @PREFIX@_ISA_CAT(name, @PREFIX@_ISA_SUFFIX)
+// Declares the baseline and every compiled variant of a function: (ret, name, (params))
+#define @PREFIX@_ISA_DECLARE(ret, name, args) @_declarations@
+// Pointer to the best variant for the host, cache it instead of dispatching per call
+#define @PREFIX@_ISA_DISPATCH(name) ::@_namespace@::Select(@_pointers@)
+
+namespace @_namespace@
+{
+    enum class Isa { @_enumerators@ };
+
+    namespace detail
+    {
+#if defined(@PREFIX@_ISA_CPUID_MSVC)
+        inline bool Cpuid(int leaf, int reg, int bit) noexcept
+        {
+            int info[4] = {};
+            __cpuidex(info, leaf, 0);
+            return (info[reg] >> bit) & 1;
+        }
+
+        // The OS must save the wider registers too
+        inline bool OsSaves(unsigned long long mask) noexcept
+        {
+            return Cpuid(1, 2, 27) && (_xgetbv(0) & mask) == mask;
+        }
+#endif
+
+        inline bool HasSse4_2() noexcept
+        {
+#if defined(@PREFIX@_ISA_CPUID_MSVC)
+            return Cpuid(1, 2, 20) && Cpuid(1, 2, 23);
+#elif defined(__x86_64__) || defined(__i386__)
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("sse4.2") && __builtin_cpu_supports("popcnt");
+#else
+            return false;
+#endif
+        }
+
+        inline bool HasAvx2() noexcept
+        {
+#if defined(@PREFIX@_ISA_CPUID_MSVC)
+            return OsSaves(0x6) && Cpuid(7, 1, 5) && Cpuid(7, 1, 3) && Cpuid(7, 1, 8) && Cpuid(1, 2, 12);
+#elif defined(__x86_64__) || defined(__i386__)
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma") &&
+                   __builtin_cpu_supports("bmi") && __builtin_cpu_supports("bmi2");
+#else
+            return false;
+#endif
+        }
+
+        inline bool HasAvx512() noexcept
+        {
+#if defined(@PREFIX@_ISA_CPUID_MSVC)
+            return OsSaves(0xE6) && HasAvx2() && Cpuid(7, 1, 16) && Cpuid(7, 1, 17) && Cpuid(7, 1, 28) &&
+                   Cpuid(7, 1, 30) && Cpuid(7, 1, 31);
+#elif defined(__x86_64__) || defined(__i386__)
+            return HasAvx2() && __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") &&
+                   __builtin_cpu_supports("avx512cd") && __builtin_cpu_supports("avx512dq") &&
+                   __builtin_cpu_supports("avx512vl");
+#else
+            return false;
+#endif
+        }
+
+        inline bool HasNeon() noexcept
+        {
+#if defined(__aarch64__) || defined(_M_ARM64)
+            return true;
+#elif defined(__linux__) && defined(__arm__)
+            return (getauxval(AT_HWCAP) & HWCAP_NEON) != 0;
+#else
+            return false;
+#endif
+        }
+    }
+
+    inline bool IsSupported(Isa isa) noexcept
+    {
+        switch (isa)
+        {
+@_checks@            default:
+                return true;
+        }
+    }
+
+    // First argument is the baseline, the others follow the Isa order
+    template <typename Function, typename... Variants>
+    Function Select(Function baseline, Variants... variants) noexcept
+    {
+        Function chosen = baseline;
+@_select@        return chosen;
+    }
+}
+]=])
+endfunction()
@@ -0,0 +1,251 @@
+include_guard(DIRECTORY)
+include(CheckLinkerFlag)
+include(GetCurrentCompiler)
+include(ConfigureQuiet)
+
+#
+# usage:
+# target_enable_lean_binaries(
+#   TARGET_NAME
+#   [ENABLE ON/OFF]             # Override LEAN_BINARIES for this target
+# )
+#
+# Drops unreferenced and duplicate code and data from TARGET_NAME, and what the dynamic loader reads at startup:
+#   GCC / Clang - -ffunction-sections -fdata-sections; links with --gc-sections, --icf=<LEAN_ICF> (lld, gold, mold),
+#                 -O1 --hash-style=gnu --as-needed (ELF) or -dead_strip -dead_strip_dylibs (Apple)
+#   MSVC        - /Gy /Gw; links with /OPT:REF /OPT:ICF (not with Edit and Continue, it needs incremental links)
+# Static and object libraries get the compile flags only, the sections are dropped where they are linked.
+# Shared libraries with a generated export header (register_library(EXPORT_HEADER)) default to hidden
+# visibility, inline functions included, so only the symbols marked for export stay in the dynamic table.
+#
+function(target_enable_lean_binaries TARGET_NAME)
+    set(oneValueArgs
+            ENABLE
+    )
+    cmake_parse_arguments(ARG "" "${oneValueArgs}" "" ${ARGN})
+
+    #
+
+    if (NOT TARGET ${TARGET_NAME})
+        message(FATAL_ERROR "target_enable_lean_binaries: Target '${TARGET_NAME}' does not exist")
+    endif ()
+
+    # Interface and imported targets have nothing to compile
+    get_target_property(_type ${TARGET_NAME} TYPE)
+    get_target_property(_imported ${TARGET_NAME} IMPORTED)
+    if (_type STREQUAL "INTERFACE_LIBRARY" OR _imported)
+        return()
+    endif ()
+
+    # Configure once, so register_*() and explicit calls can both call this
+    get_target_property(_configured ${TARGET_NAME} _LEAN_BINARIES_CONFIGURED)
+    if (_configured)
+        return()
+    endif ()
+    set_target_properties(${TARGET_NAME} PROPERTIES _LEAN_BINARIES_CONFIGURED TRUE)
+
+    set(ENABLE_VALUE ${LEAN_BINARIES})
+    if (DEFINED ARG_ENABLE)
+        set(ENABLE_VALUE ${ARG_ENABLE})
+    endif ()
+    if (NOT ENABLE_VALUE)
+        return()
+    endif ()
+
+    get_current_compiler(CURRENT_COMPILER)
+    if ("${CURRENT_COMPILER}" MATCHES "MSVC")
+        set(_compile_flags /Gy /Gw)
+        if (ENABLE_EDIT_AND_CONTINUE)
+            status_once(LEAN_EDIT_AND_CONTINUE "** Edit and Continue needs incremental links, LEAN_BINARIES keeps /OPT:NOREF")
+            set(_link_flags "")
+        else ()
+            set(_link_flags /OPT:REF /OPT:ICF /INCREMENTAL:NO)
+        endif ()
+    elseif ("${CURRENT_COMPILER}" STREQUAL "EMSCRIPTEN")
+        # wasm-ld collects unused sections by default
+        set(_compile_flags -ffunction-sections -fdata-sections)
+        set(_link_flags "")
+    elseif (APPLE)
+        set(_compile_flags -ffunction-sections -fdata-sections)
+        set(_link_flags LINKER:-dead_strip LINKER:-dead_strip_dylibs)
+    else ()
+        set(_compile_flags -ffunction-sections -fdata-sections)
+        set(_link_flags LINKER:--gc-sections LINKER:-O1 LINKER:--hash-style=gnu LINKER:--as-needed)
+        _get_lean_icf_flag(_icf_flag)
+        list(APPEND _link_flags ${_icf_flag})
+    endif ()
+
+    target_compile_options(${TARGET_NAME} PRIVATE ${_compile_flags})
+    if (_type MATCHES "^(EXECUTABLE|SHARED_LIBRARY|MODULE_LIBRARY)$")
+        target_link_options(${TARGET_NAME} PRIVATE ${_link_flags})
+    endif ()
+
+    # Hidden by default only where export macros exist, otherwise the library would export nothing
+    if (_type MATCHES "^(SHARED_LIBRARY|MODULE_LIBRARY)$")
+        get_target_property(_export_header ${TARGET_NAME} _EXPORT_HEADER)
+        get_target_property(_preset ${TARGET_NAME} CXX_VISIBILITY_PRESET)
+        if (_export_header AND NOT _preset)
+            set_target_properties(${TARGET_NAME} PROPERTIES
+                    C_VISIBILITY_PRESET hidden
+                    CXX_VISIBILITY_PRESET hidden
+                    VISIBILITY_INLINES_HIDDEN ON
+            )
+        elseif (NOT _export_header)
+            message(STATUS "** ${TARGET_NAME}: no EXPORT_HEADER, every symbol stays exported")
+        endif ()
+    endif ()
+
+    message(STATUS "** Lean binaries enabled for target: ${TARGET_NAME}")
+endfunction()
+
+#
+# usage:
+#   target_track_binary_size(TARGET_NAME)
+#
+# Lists the executable or shared library TARGET_NAME in the binary-size report (register_executable() and
+# register_library() call it), whether or not LEAN_BINARIES is on:
+#   cmake --build <dir> --target binary-size
+# writes binary-size.txt with the file size and the exported dynamic symbols of every tracked binary, and the
+# change against the previous report. Run it once before turning LEAN_BINARIES on and once after to compare.
+#
+function(target_track_binary_size TARGET_NAME)
+    if (NOT TARGET ${TARGET_NAME})
+        message(FATAL_ERROR "target_track_binary_size: Target '${TARGET_NAME}' does not exist")
+    endif ()
+
+    get_target_property(_type ${TARGET_NAME} TYPE)
+    if (NOT _type MATCHES "^(EXECUTABLE|SHARED_LIBRARY|MODULE_LIBRARY)$")
+        return()
+    endif ()
+
+    # One file per binary, the report globs them, so targets of every directory share it
+    file(GENERATE
+            OUTPUT "${CMAKE_BINARY_DIR}/binary-size/$<CONFIG>/${TARGET_NAME}.txt"
+            CONTENT "$<TARGET_FILE:${TARGET_NAME}>"
+    )
+    _add_binary_size_target()
+endfunction()
+
+#
+
+# Helper function to get the identical code folding flag of the selected linker, empty when it has none (GNU ld)
+function(_get_lean_icf_flag OUT_VAR)
+    set(${OUT_VAR} "" PARENT_SCOPE)
+    string(TOLOWER "${LEAN_ICF}" _icf)
+    if (_icf STREQUAL "" OR _icf STREQUAL "none")
+        return()
+    endif ()
+    if (NOT _icf MATCHES "^(all|safe)$")
+        message(FATAL_ERROR "Unknown LEAN_ICF '${LEAN_ICF}' (expected all, safe or none)")
+    endif ()
+
+    string(MAKE_C_IDENTIFIER "LEAN_LINKER_SUPPORTS_ICF_${_icf}_${LINKER_SELECTED}" _result_var)
+    check_linker_flag(CXX "${LINKER_SELECTED_FLAG};LINKER:--icf=${_icf}" ${_result_var})
+    if (${_result_var})
+        set(${OUT_VAR} "LINKER:--icf=${_icf}" PARENT_SCOPE)
+    else ()
+        status_once(LEAN_NO_ICF "** The ${LINKER_SELECTED} linker has no --icf, identical code is not folded (use LINKER=lld, mold or gold)")
+    endif ()
+endfunction()
+
+# Helper function to create the binary-size target, once
+function(_add_binary_size_target)
+    if (TARGET binary-size)
+        return()
+    endif ()
+
+    set(_script "${CMAKE_BINARY_DIR}/CMakeFiles/BinarySizeReport.cmake")
+    file(CONFIGURE OUTPUT "${_script}" @ONLY CONTENT [=[
+# Reports the size of the tracked binaries, generated by TargetLeanBinaries.cmake:
+#   cmake -DLIST_DIR=<dir> -DREPORT=<file> [-DNM=<nm>] -P BinarySizeReport.cmake
+# The previous REPORT is kept as <REPORT>.previous and compared against.
+cmake_policy(VERSION 3.21)
+
+# Sets <prefix>_size and <prefix>_symbols of every binary in REPORT_FILE, and <prefix>_names
+macro(_size_read_report REPORT_FILE PREFIX)
+    set(${PREFIX}_names "")
+    if (EXISTS "${REPORT_FILE}")
+        file(STRINGS "${REPORT_FILE}" _lines REGEX "^[^ #]+ [0-9]+ [0-9-]+$")
+        foreach (_line ${_lines})
+            string(REGEX MATCH "^([^ ]+) ([0-9]+) ([0-9-]+)$" _match "${_line}")
+            list(APPEND ${PREFIX}_names ${CMAKE_MATCH_1})
+            set(${PREFIX}_size_${CMAKE_MATCH_1} ${CMAKE_MATCH_2})
+            set(${PREFIX}_symbols_${CMAKE_MATCH_1} ${CMAKE_MATCH_3})
+        endforeach ()
+    endif ()
+endmacro()
+
+set(_previous "${REPORT}.previous")
+if (EXISTS "${REPORT}")
+    file(COPY_FILE "${REPORT}" "${_previous}")
+endif ()
+_size_read_report("${_previous}" _before)
+
+file(GLOB _entries "${LIST_DIR}/*.txt")
+if (NOT _entries)
+    message(FATAL_ERROR "No binaries tracked in ${LIST_DIR}")
+endif ()
+
+set(_report "# <binary> <bytes> <exported dynamic symbols, - when unknown>\n")
+set(_summary "")
+foreach (_entry ${_entries})
+    get_filename_component(_name "${_entry}" NAME_WE)
+    file(READ "${_entry}" _file)
+    if (NOT EXISTS "${_file}")
+        string(APPEND _summary "  ${_name}: not built\n")
+        continue()
+    endif ()
+    file(SIZE "${_file}" _size)
+
+    set(_symbols "-")
+    if (NM)
+        execute_process(
+                COMMAND "${NM}" -D --defined-only "${_file}"
+                OUTPUT_VARIABLE _output
+                ERROR_QUIET
+                RESULT_VARIABLE _result
+        )
+        if (_result EQUAL 0)
+            string(REGEX MATCHALL "\n" _newlines "\n${_output}")
+            list(LENGTH _newlines _symbols)
+            math(EXPR _symbols "${_symbols} - 1")
+        endif ()
+    endif ()
+    string(APPEND _report "${_name} ${_size} ${_symbols}\n")
+
+    math(EXPR _kib "${_size} / 1024")
+    set(_line "  ${_name}: ${_kib} KiB")
+    if (NOT _symbols STREQUAL "-")
+        string(APPEND _line ", ${_symbols} exported symbols")
+    endif ()
+    if (DEFINED _before_size_${_name} AND _before_size_${_name} GREATER 0)
+        math(EXPR _delta "${_size} - ${_before_size_${_name}}")
+        math(EXPR _percent "${_delta} * 100 / ${_before_size_${_name}}")
+        string(APPEND _line "  (${_delta} bytes, ${_percent}%")
+        if (NOT _symbols STREQUAL "-" AND NOT _before_symbols_${_name} STREQUAL "-")
+            math(EXPR _symbol_delta "${_symbols} - ${_before_symbols_${_name}}")
+            string(APPEND _line ", ${_symbol_delta} symbols")
+        endif ()
+        string(APPEND _line " vs previous report)")
+    endif ()
+    string(APPEND _summary "${_line}\n")
+endforeach ()
+
+file(WRITE "${REPORT}" "${_report}")
+message("Binary sizes:\n${_summary}Report written to ${REPORT}")
+]=])
+
+    set(_nm "")
+    if (CMAKE_NM AND NOT WIN32 AND NOT APPLE)
+        set(_nm "${CMAKE_NM}")
+    endif ()
+    add_custom_target(binary-size
+            COMMAND ${CMAKE_COMMAND}
+            "-DLIST_DIR=${CMAKE_BINARY_DIR}/binary-size/$<CONFIG>"
+            "-DREPORT=${CMAKE_BINARY_DIR}/binary-size.txt"
+            "-DNM=${_nm}"
+            -P "${_script}"
+            COMMENT "Reporting the size of registered binaries"
+            VERBATIM
+    )
+endfunction()
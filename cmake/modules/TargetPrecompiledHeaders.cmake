@@ -0,0 +1,120 @@
+include_guard(DIRECTORY)
+
+#
+# usage:
+# target_enable_precompiled_headers(
+#   TARGET_NAME
+#   [ENABLE ON/OFF]             # Override ENABLE_GLOBAL_PCH for this target
+#   [HEADERS <header> ...]      # Headers to precompile, e.g. <vector> or "pch.hpp"
+#   [REUSE_FROM <target>]       # Reuse the PCH of another target instead of building one
+# )
+#
+# Resolution order:
+#   - ENABLE OFF disables precompiled headers for the target
+#   - HEADERS or REUSE_FROM enable them unless ENABLE is OFF
+#   - otherwise GLOBAL_PCH_HEADERS is used when ENABLE_GLOBAL_PCH (or ENABLE) is ON
+#
+function(target_enable_precompiled_headers TARGET_NAME)
+    set(oneValueArgs
+            ENABLE
+            REUSE_FROM
+    )
+    set(multiValueArgs
+            HEADERS
+    )
+    cmake_parse_arguments(ARG "" "${oneValueArgs}" "${multiValueArgs}" ${ARGN})
+
+    #
+
+    if (NOT TARGET ${TARGET_NAME})
+        message(FATAL_ERROR "target_enable_precompiled_headers: Target '${TARGET_NAME}' does not exist")
+    endif ()
+
+    if (ARG_HEADERS AND DEFINED ARG_REUSE_FROM)
+        message(FATAL_ERROR "target_enable_precompiled_headers: HEADERS and REUSE_FROM are mutually exclusive for '${TARGET_NAME}'")
+    endif ()
+
+    # Interface and imported targets have nothing to compile
+    get_target_property(_type ${TARGET_NAME} TYPE)
+    get_target_property(_imported ${TARGET_NAME} IMPORTED)
+    if (_type STREQUAL "INTERFACE_LIBRARY" OR _imported)
+        return()
+    endif ()
+
+    # Configure once, so register_*() and target_setup_common_options() can both call this
+    get_target_property(_configured ${TARGET_NAME} _PCH_CONFIGURED)
+    if (_configured)
+        return()
+    endif ()
+    set_target_properties(${TARGET_NAME} PROPERTIES _PCH_CONFIGURED TRUE)
+
+    if (ARG_HEADERS OR DEFINED ARG_REUSE_FROM)
+        set(ENABLE_PCH_VALUE ON)
+    else ()
+        set(ENABLE_PCH_VALUE ${ENABLE_GLOBAL_PCH})
+    endif ()
+    if (DEFINED ARG_ENABLE)
+        set(ENABLE_PCH_VALUE ${ARG_ENABLE})
+    endif ()
+
+    if (NOT ENABLE_PCH_VALUE)
+        return()
+    endif ()
+
+    if (DEFINED ARG_REUSE_FROM)
+        _reuse_precompiled_headers(${TARGET_NAME} ${ARG_REUSE_FROM})
+        return()
+    endif ()
+
+    set(PCH_HEADERS ${ARG_HEADERS})
+    if (NOT PCH_HEADERS)
+        set(PCH_HEADERS ${GLOBAL_PCH_HEADERS})
+    endif ()
+    if (NOT PCH_HEADERS)
+        message(STATUS "** Precompiled headers requested for '${TARGET_NAME}' but no headers given (set GLOBAL_PCH_HEADERS)")
+        return()
+    endif ()
+
+    # Only C++ translation units may consume a C++ PCH
+    set(PCH_ENTRIES "")
+    foreach (header ${PCH_HEADERS})
+        list(APPEND PCH_ENTRIES "$<$<COMPILE_LANGUAGE:CXX>:${header}>")
+    endforeach ()
+
+    target_precompile_headers(${TARGET_NAME} PRIVATE ${PCH_ENTRIES})
+
+    # Clang embeds a timestamp in the PCH that ccache would otherwise hash into every consumer
+    if (CMAKE_CXX_COMPILER_ID MATCHES "Clang" AND COMPILER_CACHE_SELECTED STREQUAL "ccache")
+        target_compile_options(${TARGET_NAME} PRIVATE "$<$<COMPILE_LANGUAGE:CXX>:SHELL:-Xclang -fno-pch-timestamp>")
+    endif ()
+    message(STATUS "** Precompiled headers enabled for '${TARGET_NAME}': ${PCH_HEADERS}")
+endfunction()
+
+#
+
+# Helper function to reuse the PCH of another target
+function(_reuse_precompiled_headers TARGET_NAME SOURCE_TARGET)
+    if (NOT TARGET ${SOURCE_TARGET})
+        message(FATAL_ERROR "target_enable_precompiled_headers: REUSE_FROM target '${SOURCE_TARGET}' does not exist")
+    endif ()
+
+    # REUSE_FROM across aliases is not supported by CMake, resolve to the real target
+    get_target_property(_aliased ${SOURCE_TARGET} ALIASED_TARGET)
+    if (_aliased)
+        set(SOURCE_TARGET ${_aliased})
+    endif ()
+
+    # The source target must own a PCH (or itself reuse one), otherwise there is nothing to share
+    get_target_property(_source_headers ${SOURCE_TARGET} PRECOMPILE_HEADERS)
+    get_target_property(_source_reuse ${SOURCE_TARGET} PRECOMPILE_HEADERS_REUSE_FROM)
+    if (NOT _source_headers AND NOT _source_reuse)
+        message(WARNING "target_enable_precompiled_headers: '${SOURCE_TARGET}' has no precompiled headers, '${TARGET_NAME}' will not reuse them. "
+                "Register '${SOURCE_TARGET}' with PRECOMPILE_HEADERS (or enable ENABLE_GLOBAL_PCH) before '${TARGET_NAME}'.")
+        return()
+    endif ()
+
+    # Both targets must be compiled with compatible flags (standard, PIC, runtime)
+    # for the compiler to accept the shared PCH
+    target_precompile_headers(${TARGET_NAME} REUSE_FROM ${SOURCE_TARGET})
+    message(STATUS "** Precompiled headers for '${TARGET_NAME}' reused from '${SOURCE_TARGET}'")
+endfunction()
@@ -0,0 +1,303 @@
+include_guard(DIRECTORY)
+include(GetCurrentCompiler)
+include(TargetBolt)
+
+#
+# usage:
+# target_enable_profile_guided_optimization(
+#   TARGET_NAME
+#   [ENABLE ON/OFF]             # Opt a target out of PGO_MODE
+#   [MODE GENERATE|USE]         # Override PGO_MODE for this target
+#   [PROFILE_DIR <dir>]         # Override PGO_PROFILE_DIR for this target
+# )
+#
+# Modes:
+#   GENERATE - instrument the target, running it writes raw profiles to the profile directory
+#   USE      - optimize the target with the (merged) profiles found in the profile directory
+#
+function(target_enable_profile_guided_optimization TARGET_NAME)
+    set(oneValueArgs
+            ENABLE
+            MODE
+            PROFILE_DIR
+    )
+    cmake_parse_arguments(ARG "" "${oneValueArgs}" "" ${ARGN})
+
+    #
+
+    if (NOT TARGET ${TARGET_NAME})
+        message(FATAL_ERROR "target_enable_profile_guided_optimization: Target '${TARGET_NAME}' does not exist")
+    endif ()
+
+    # Interface and imported targets have nothing to compile
+    get_target_property(_type ${TARGET_NAME} TYPE)
+    get_target_property(_imported ${TARGET_NAME} IMPORTED)
+    if (_type STREQUAL "INTERFACE_LIBRARY" OR _imported)
+        return()
+    endif ()
+
+    if (DEFINED ARG_ENABLE AND NOT ARG_ENABLE)
+        return()
+    endif ()
+
+    set(MODE_VALUE ${PGO_MODE})
+    if (DEFINED ARG_MODE)
+        set(MODE_VALUE ${ARG_MODE})
+    endif ()
+    string(TOUPPER "${MODE_VALUE}" MODE_VALUE)
+    if (NOT MODE_VALUE OR MODE_VALUE STREQUAL "OFF")
+        return()
+    endif ()
+    if (NOT MODE_VALUE MATCHES "^(GENERATE|USE)$")
+        message(FATAL_ERROR "target_enable_profile_guided_optimization: Unknown MODE '${MODE_VALUE}' for '${TARGET_NAME}' (expected GENERATE or USE)")
+    endif ()
+
+    set(PROFILE_DIR_VALUE ${PGO_PROFILE_DIR})
+    if (DEFINED ARG_PROFILE_DIR)
+        set(PROFILE_DIR_VALUE ${ARG_PROFILE_DIR})
+    endif ()
+    if (NOT PROFILE_DIR_VALUE)
+        set(PROFILE_DIR_VALUE "${CMAKE_BINARY_DIR}/pgo")
+    endif ()
+    get_filename_component(PROFILE_DIR_VALUE "${PROFILE_DIR_VALUE}" ABSOLUTE BASE_DIR "${CMAKE_BINARY_DIR}")
+
+    # Remembered for register_pgo_training()
+    set_target_properties(${TARGET_NAME} PROPERTIES
+            _PGO_MODE ${MODE_VALUE}
+            _PGO_PROFILE_DIR "${PROFILE_DIR_VALUE}"
+    )
+
+    get_current_compiler(CURRENT_COMPILER)
+    set(PGO_COMPILE_OPTIONS "")
+    set(PGO_LINK_OPTIONS "")
+
+    if ("${CURRENT_COMPILER}" STREQUAL "MSVC")
+        _get_msvc_pgo_options(${TARGET_NAME} ${MODE_VALUE} "${PROFILE_DIR_VALUE}" PGO_COMPILE_OPTIONS PGO_LINK_OPTIONS)
+    elseif ("${CURRENT_COMPILER}" MATCHES "^CLANG")
+        _get_clang_pgo_options(${TARGET_NAME} ${MODE_VALUE} "${PROFILE_DIR_VALUE}" PGO_COMPILE_OPTIONS PGO_LINK_OPTIONS)
+    elseif ("${CURRENT_COMPILER}" STREQUAL "GCC")
+        _get_gcc_pgo_options(${MODE_VALUE} "${PROFILE_DIR_VALUE}" PGO_COMPILE_OPTIONS PGO_LINK_OPTIONS)
+    else ()
+        message(STATUS "** PGO is not supported for compiler '${CURRENT_COMPILER}', skipping '${TARGET_NAME}'")
+        return()
+    endif ()
+
+    if (NOT PGO_COMPILE_OPTIONS AND NOT PGO_LINK_OPTIONS)
+        return()
+    endif ()
+
+    target_compile_options(${TARGET_NAME} PRIVATE ${PGO_COMPILE_OPTIONS})
+    target_link_options(${TARGET_NAME} PRIVATE ${PGO_LINK_OPTIONS})
+    message(STATUS "** PGO ${MODE_VALUE} enabled for '${TARGET_NAME}' (profiles: ${PROFILE_DIR_VALUE})")
+endfunction()
+
+#
+# usage:
+# register_pgo_training(
+#   TARGET_NAME
+#   [COMMAND <cmd> [<arg>...]]  # Training workload, defaults to running TARGET_NAME
+#   [WORKING_DIRECTORY <dir>]
+#   [TIMEOUT <seconds>]
+# )
+#
+# Targets prepared by target_enable_bolt() train BOLT on the same workload, see register_bolt_training().
+# Otherwise only active with PGO_MODE GENERATE. Adds the CTest tests 'pgo_train_<target>' and 'pgo_merge_<target>'
+# plus one 'pgo_clean_<hash>' per profile directory (label 'pgo'), run them with:
+#   ctest -L pgo
+# Then reconfigure with -DPGO_MODE=USE and rebuild.
+#
+function(register_pgo_training TARGET_NAME)
+    set(oneValueArgs
+            WORKING_DIRECTORY
+            TIMEOUT
+    )
+    set(multiValueArgs
+            COMMAND
+    )
+    cmake_parse_arguments(ARG "" "${oneValueArgs}" "${multiValueArgs}" ${ARGN})
+
+    #
+
+    if (NOT TARGET ${TARGET_NAME})
+        message(FATAL_ERROR "register_pgo_training: Target '${TARGET_NAME}' does not exist")
+    endif ()
+
+    register_bolt_training(${TARGET_NAME} ${ARGN})
+
+    get_target_property(_mode ${TARGET_NAME} _PGO_MODE)
+    if (NOT _mode STREQUAL "GENERATE")
+        return()
+    endif ()
+    get_target_property(_profile_dir ${TARGET_NAME} _PGO_PROFILE_DIR)
+
+    if (NOT ARG_COMMAND)
+        set(ARG_COMMAND ${TARGET_NAME})
+    endif ()
+    if (NOT ARG_WORKING_DIRECTORY)
+        set(ARG_WORKING_DIRECTORY "${CMAKE_CURRENT_BINARY_DIR}")
+    endif ()
+
+    get_current_compiler(CURRENT_COMPILER)
+    set(_fixture pgo_${TARGET_NAME})
+    set(_script "${CMAKE_CURRENT_BINARY_DIR}/pgo_${TARGET_NAME}.cmake")
+    _write_pgo_profile_script("${_script}" "${CURRENT_COMPILER}" "${_profile_dir}")
+
+    # Stale profiles from an older binary would poison the merge, clean each profile directory once per run
+    string(MD5 _dir_hash "${_profile_dir}")
+    string(SUBSTRING "${_dir_hash}" 0 8 _dir_hash)
+    set(_clean_fixture pgo_clean_${_dir_hash})
+    get_property(_cleaned_dirs GLOBAL PROPERTY _PGO_CLEANED_PROFILE_DIRS)
+    if (NOT _dir_hash IN_LIST _cleaned_dirs)
+        set_property(GLOBAL APPEND PROPERTY _PGO_CLEANED_PROFILE_DIRS ${_dir_hash})
+        add_test(NAME ${_clean_fixture}
+                COMMAND ${CMAKE_COMMAND} -DPGO_ACTION=CLEAN -P "${_script}"
+        )
+        set_tests_properties(${_clean_fixture} PROPERTIES
+                LABELS pgo
+                FIXTURES_SETUP ${_clean_fixture}
+        )
+    endif ()
+
+    add_test(NAME pgo_train_${TARGET_NAME}
+            COMMAND ${ARG_COMMAND}
+            WORKING_DIRECTORY "${ARG_WORKING_DIRECTORY}"
+    )
+    set_tests_properties(pgo_train_${TARGET_NAME} PROPERTIES
+            LABELS pgo
+            FIXTURES_REQUIRED ${_clean_fixture}
+            FIXTURES_SETUP ${_fixture}_train
+            ENVIRONMENT "LLVM_PROFILE_FILE=${_profile_dir}/${TARGET_NAME}-%p-%m.profraw"
+    )
+    if (DEFINED ARG_TIMEOUT)
+        set_tests_properties(pgo_train_${TARGET_NAME} PROPERTIES TIMEOUT ${ARG_TIMEOUT})
+    endif ()
+
+    add_test(NAME pgo_merge_${TARGET_NAME}
+            COMMAND ${CMAKE_COMMAND} -DPGO_ACTION=MERGE -P "${_script}"
+    )
+    set_tests_properties(pgo_merge_${TARGET_NAME} PROPERTIES
+            LABELS pgo
+            FIXTURES_REQUIRED ${_fixture}_train
+    )
+
+    message(STATUS "** PGO training registered for '${TARGET_NAME}' (run: ctest -L pgo)")
+endfunction()
+
+#
+
+# Helper function to get PGO flags for MSVC (profiles are tied to the LTCG image)
+function(_get_msvc_pgo_options TARGET_NAME MODE PROFILE_DIR COMPILE_OPTIONS_VAR LINK_OPTIONS_VAR)
+    set(_pgd "${PROFILE_DIR}/${TARGET_NAME}.pgd")
+    file(TO_NATIVE_PATH "${_pgd}" _pgd_native)
+
+    set(${COMPILE_OPTIONS_VAR} /GL PARENT_SCOPE)
+
+    # Static and object libraries only need /GL, the profile belongs to the image they are linked into
+    get_target_property(_type ${TARGET_NAME} TYPE)
+    if (_type STREQUAL "STATIC_LIBRARY" OR _type STREQUAL "OBJECT_LIBRARY")
+        return()
+    endif ()
+
+    if (MODE STREQUAL "GENERATE")
+        file(MAKE_DIRECTORY "${PROFILE_DIR}")
+        set(${LINK_OPTIONS_VAR} /LTCG /GENPROFILE:PGD=${_pgd_native} PARENT_SCOPE)
+    elseif (EXISTS "${_pgd}")
+        # .pgc files from the training runs are merged into the .pgd by the linker
+        set(${LINK_OPTIONS_VAR} /LTCG /USEPROFILE:PGD=${_pgd_native} PARENT_SCOPE)
+    else ()
+        message(WARNING "PGO USE: '${_pgd}' not found, building '${TARGET_NAME}' without profile data")
+        set(${COMPILE_OPTIONS_VAR} "" PARENT_SCOPE)
+        set(${LINK_OPTIONS_VAR} "" PARENT_SCOPE)
+    endif ()
+endfunction()
+
+# Helper function to get PGO flags for Clang and clang-cl (instrumentation-based profiles, merged by llvm-profdata)
+function(_get_clang_pgo_options TARGET_NAME MODE PROFILE_DIR COMPILE_OPTIONS_VAR LINK_OPTIONS_VAR)
+    if (MODE STREQUAL "GENERATE")
+        file(MAKE_DIRECTORY "${PROFILE_DIR}")
+        set(_flags "-fprofile-instr-generate=${PROFILE_DIR}/%p-%m.profraw")
+        set(${COMPILE_OPTIONS_VAR} ${_flags} PARENT_SCOPE)
+        set(${LINK_OPTIONS_VAR} ${_flags} PARENT_SCOPE)
+        return()
+    endif ()
+
+    set(_profdata "${PROFILE_DIR}/default.profdata")
+    if (NOT EXISTS "${_profdata}")
+        message(WARNING "PGO USE: '${_profdata}' not found, building '${TARGET_NAME}' without profile data")
+        return()
+    endif ()
+
+    set(${COMPILE_OPTIONS_VAR}
+            "-fprofile-instr-use=${_profdata}"
+            -Wno-profile-instr-unprofiled
+            -Wno-profile-instr-out-of-date
+            PARENT_SCOPE
+    )
+endfunction()
+
+# Helper function to get PGO flags for GCC (.gcda files, keyed on object paths so GENERATE and USE must share a build dir)
+function(_get_gcc_pgo_options MODE PROFILE_DIR COMPILE_OPTIONS_VAR LINK_OPTIONS_VAR)
+    if (MODE STREQUAL "GENERATE")
+        file(MAKE_DIRECTORY "${PROFILE_DIR}")
+        # Atomic updates keep counters of multithreaded workloads consistent
+        set(_flags "-fprofile-generate=${PROFILE_DIR}" -fprofile-update=atomic)
+        set(${COMPILE_OPTIONS_VAR} ${_flags} PARENT_SCOPE)
+        set(${LINK_OPTIONS_VAR} ${_flags} PARENT_SCOPE)
+    else ()
+        set(_flags "-fprofile-use=${PROFILE_DIR}" -fprofile-correction -Wno-missing-profile)
+        # Keep code the training did not reach optimized for speed instead of size
+        if (CMAKE_CXX_COMPILER_VERSION VERSION_GREATER_EQUAL 10)
+            list(APPEND _flags -fprofile-partial-training)
+        endif ()
+        set(${COMPILE_OPTIONS_VAR} ${_flags} PARENT_SCOPE)
+    endif ()
+endfunction()
+
+# Helper function to write the script that cleans and merges the training profiles of a target
+function(_write_pgo_profile_script SCRIPT_FILE CURRENT_COMPILER PROFILE_DIR)
+    set(_profdata_tool "")
+    if ("${CURRENT_COMPILER}" MATCHES "^CLANG")
+        get_filename_component(_compiler_dir "${CMAKE_CXX_COMPILER}" DIRECTORY)
+        find_program(LLVM_PROFDATA_EXECUTABLE
+                NAMES llvm-profdata llvm-profdata-${CMAKE_CXX_COMPILER_VERSION_MAJOR}
+                HINTS "${_compiler_dir}"
+                DOC "LLVM profile data merge tool"
+        )
+        if (NOT LLVM_PROFDATA_EXECUTABLE)
+            message(WARNING "register_pgo_training: llvm-profdata not found, profiles will not be merged")
+        else ()
+            set(_profdata_tool "${LLVM_PROFDATA_EXECUTABLE}")
+        endif ()
+    endif ()
+
+    file(WRITE "${SCRIPT_FILE}" "
+# Auto-generated PGO profile script, run with -DPGO_ACTION=CLEAN|MERGE
+set(PROFILE_DIR \"${PROFILE_DIR}\")
+set(PROFDATA_TOOL \"${_profdata_tool}\")
+
+if (PGO_ACTION STREQUAL \"CLEAN\")
+    file(GLOB _stale \"\${PROFILE_DIR}/*.profraw\" \"\${PROFILE_DIR}/*.gcda\" \"\${PROFILE_DIR}/*.pgc\")
+    if (_stale)
+        file(REMOVE \${_stale})
+    endif ()
+    file(MAKE_DIRECTORY \"\${PROFILE_DIR}\")
+elseif (PGO_ACTION STREQUAL \"MERGE\")
+    if (NOT PROFDATA_TOOL)
+        message(STATUS \"Profiles in \${PROFILE_DIR} are consumed directly, nothing to merge\")
+        return()
+    endif ()
+    file(GLOB _raw \"\${PROFILE_DIR}/*.profraw\")
+    if (NOT _raw)
+        message(FATAL_ERROR \"No .profraw files in \${PROFILE_DIR}, did the training run an instrumented binary?\")
+    endif ()
+    execute_process(
+            COMMAND \"\${PROFDATA_TOOL}\" merge -output=\${PROFILE_DIR}/default.profdata \${_raw}
+            RESULT_VARIABLE _result
+    )
+    if (NOT _result EQUAL 0)
+        message(FATAL_ERROR \"llvm-profdata merge failed (\${_result})\")
+    endif ()
+    message(STATUS \"Merged profiles into \${PROFILE_DIR}/default.profdata\")
+endif ()
+")
+endfunction()
@@ -0,0 +1,289 @@
+include_guard(DIRECTORY)
+include(CheckCXXCompilerFlag)
+include(GetCurrentCompiler)
+include(LinkDependencies)
+
+#
+# usage:
+# target_enable_profiler(
+#   TARGET_NAME
+#   [PROFILER none|tracy|perfetto|itt]  # Override the global ENABLE_PROFILER for this target
+# )
+#
+# Instruments TARGET_NAME with a runtime profiler client:
+#   none     - nothing is linked, the zone macros expand to nothing
+#   tracy    - Tracy client (CPM or xrepo), on demand: zones are only recorded while the Tracy server is connected
+#   perfetto - Perfetto SDK (CPM or xrepo), track events to the system backend (traced / tracebox)
+#   itt      - Intel ITT API (CPM or xrepo), tasks and frames for VTune and other ITT collectors
+#
+# Every target gets the generated <profiler.hpp> (private include), whatever the profiler:
+#   PROFILE_ZONE()           - times the enclosing scope, named after the function
+#   PROFILE_ZONE_NAMED(name) - same, named by a string literal
+#   PROFILE_FRAME()          - marks the end of a frame (main loop iteration, request, ...)
+#   PROFILE_ENABLED          - 1 when a profiler is compiled in, 0 otherwise
+#
+# Profiled targets keep their frame pointers (-fno-omit-frame-pointer -mno-omit-leaf-frame-pointer,
+# /Oy- on 32-bit MSVC), so perf, eBPF and the sampling profilers of Tracy and VTune can walk the stack.
+# Emscripten targets get the header only.
+#
+function(target_enable_profiler TARGET_NAME)
+    set(oneValueArgs
+            PROFILER
+    )
+    cmake_parse_arguments(ARG "" "${oneValueArgs}" "" ${ARGN})
+
+    #
+
+    if (NOT TARGET ${TARGET_NAME})
+        message(FATAL_ERROR "target_enable_profiler: Target '${TARGET_NAME}' does not exist")
+    endif ()
+
+    # Interface and imported targets have nothing to compile
+    get_target_property(_type ${TARGET_NAME} TYPE)
+    get_target_property(_imported ${TARGET_NAME} IMPORTED)
+    if (_type STREQUAL "INTERFACE_LIBRARY" OR _imported)
+        return()
+    endif ()
+
+    # Configure once, so register_*() and target_setup_common_options() can both call this
+    get_target_property(_configured ${TARGET_NAME} _PROFILER_CONFIGURED)
+    if (_configured)
+        return()
+    endif ()
+    set_target_properties(${TARGET_NAME} PROPERTIES _PROFILER_CONFIGURED TRUE)
+
+    set(_profiler "${ENABLE_PROFILER}")
+    if (DEFINED ARG_PROFILER)
+        set(_profiler "${ARG_PROFILER}")
+    endif ()
+    string(TOLOWER "${_profiler}" _profiler)
+    if (_profiler STREQUAL "" OR _profiler STREQUAL "off")
+        set(_profiler "none")
+    endif ()
+    if (NOT _profiler MATCHES "^(none|tracy|perfetto|itt)$")
+        message(FATAL_ERROR "Unknown ENABLE_PROFILER '${_profiler}' for '${TARGET_NAME}' (expected none, tracy, perfetto or itt)")
+    endif ()
+
+    # The macros must compile whether or not a profiler is linked
+    _write_profiler_header()
+    get_property(_header_dir GLOBAL PROPERTY _PROFILER_HEADER_DIR)
+    target_include_directories(${TARGET_NAME} PRIVATE "$<BUILD_INTERFACE:${_header_dir}>")
+
+    if (_profiler STREQUAL "none" OR EMSCRIPTEN)
+        return()
+    endif ()
+
+    cmake_language(CALL _target_use_profiler_${_profiler} ${TARGET_NAME})
+    string(TOUPPER "${_profiler}" _upper)
+    target_compile_definitions(${TARGET_NAME} PRIVATE PROFILER_${_upper}=1)
+    _target_keep_frame_pointers(${TARGET_NAME})
+    message(STATUS "** ${_profiler} profiler enabled for target: ${TARGET_NAME}")
+endfunction()
+
+#
+
+# Helper function to write <profiler.hpp>, once.
+# The backend is picked by the PROFILER_<NAME> define of each target, so targets can mix profilers.
+function(_write_profiler_header)
+    get_property(_header_dir GLOBAL PROPERTY _PROFILER_HEADER_DIR)
+    if (_header_dir)
+        return()
+    endif ()
+    set(_header_dir "${CMAKE_BINARY_DIR}/profiler")
+    set_property(GLOBAL PROPERTY _PROFILER_HEADER_DIR "${_header_dir}")
+
+    file(CONFIGURE OUTPUT "${_header_dir}/profiler.hpp" @ONLY CONTENT [=[
+#pragma once
+// Generated by TargetProfiler.cmake, do not edit
+
+#define PROFILE_CAT_(a, b) a##b
+#define PROFILE_CAT(a, b) PROFILE_CAT_(a, b)
+
+#if defined(PROFILER_TRACY)
+#include <tracy/Tracy.hpp>
+
+#define PROFILE_ENABLED 1
+#define PROFILE_ZONE() ZoneScoped
+#define PROFILE_ZONE_NAMED(name) ZoneScopedN(name)
+#define PROFILE_FRAME() FrameMark
+
+#elif defined(PROFILER_PERFETTO)
+#include <perfetto.h>
+
+// The track event storage of this category lives in the profiler_perfetto library
+PERFETTO_DEFINE_CATEGORIES(perfetto::Category("app").SetDescription("PROFILE_ZONE scopes"));
+
+#define PROFILE_ENABLED 1
+#define PROFILE_ZONE() TRACE_EVENT("app", ::perfetto::StaticString{__func__})
+#define PROFILE_ZONE_NAMED(name) TRACE_EVENT("app", name)
+#define PROFILE_FRAME() TRACE_EVENT_INSTANT("app", "frame")
+
+#elif defined(PROFILER_ITT)
+#include <ittnotify.h>
+
+namespace profiler_itt
+{
+    inline __itt_domain* Domain() noexcept
+    {
+        static __itt_domain* const domain = __itt_domain_create("app");
+        return domain;
+    }
+
+    class Zone
+    {
+    public:
+        explicit Zone(__itt_string_handle* name) noexcept
+        {
+            __itt_task_begin(Domain(), __itt_null, __itt_null, name);
+        }
+        ~Zone()
+        {
+            __itt_task_end(Domain());
+        }
+        Zone(const Zone&) = delete;
+        Zone& operator=(const Zone&) = delete;
+    };
+} // namespace profiler_itt
+
+#define PROFILE_ENABLED 1
+// String handles are created once per call site, a task begin is then a few stores
+#define PROFILE_ITT_ZONE_(name, id)                                                                     \
+    static __itt_string_handle* const PROFILE_CAT(profile_name_, id) = __itt_string_handle_create(name); \
+    const ::profiler_itt::Zone PROFILE_CAT(profile_zone_, id)                                            \
+    {                                                                                                    \
+        PROFILE_CAT(profile_name_, id)                                                                   \
+    }
+#define PROFILE_ZONE_NAMED(name) PROFILE_ITT_ZONE_(name, __COUNTER__)
+#define PROFILE_ZONE() PROFILE_ZONE_NAMED(__func__)
+#define PROFILE_FRAME() (__itt_frame_end_v3(::profiler_itt::Domain(), nullptr), __itt_frame_begin_v3(::profiler_itt::Domain(), nullptr))
+
+#else
+#define PROFILE_ENABLED 0
+#define PROFILE_ZONE() static_cast<void>(0)
+#define PROFILE_ZONE_NAMED(name) static_cast<void>(0)
+#define PROFILE_FRAME() static_cast<void>(0)
+#endif
+]=])
+endfunction()
+
+# Helper function to keep frame pointers in the code of TARGET_NAME, leaf functions included where supported
+function(_target_keep_frame_pointers TARGET_NAME)
+    get_current_compiler(CURRENT_COMPILER)
+    if ("${CURRENT_COMPILER}" STREQUAL "CLANG-MSVC")
+        target_compile_options(${TARGET_NAME} PRIVATE /clang:-fno-omit-frame-pointer)
+    elseif ("${CURRENT_COMPILER}" STREQUAL "MSVC")
+        # x64 and ARM64 always keep a walkable stack (unwind tables), /Oy only exists on x86
+        if (CMAKE_SIZEOF_VOID_P EQUAL 4)
+            target_compile_options(${TARGET_NAME} PRIVATE /Oy-)
+        endif ()
+    else ()
+        target_compile_options(${TARGET_NAME} PRIVATE -fno-omit-frame-pointer)
+        check_cxx_compiler_flag(-mno-omit-leaf-frame-pointer PROFILER_HAS_NO_OMIT_LEAF_FRAME_POINTER)
+        if (PROFILER_HAS_NO_OMIT_LEAF_FRAME_POINTER)
+            target_compile_options(${TARGET_NAME} PRIVATE -mno-omit-leaf-frame-pointer)
+        endif ()
+    endif ()
+endfunction()
+
+# Helper function to link the Tracy client, fetched once
+function(_target_use_profiler_tracy TARGET_NAME)
+    if (COMMAND CPMAddPackage)
+        if (NOT TARGET TracyClient)
+            CPMAddPackage(
+                    NAME tracy
+                    GITHUB_REPOSITORY wolfpld/tracy
+                    GIT_TAG v0.11.1
+                    SYSTEM ON
+                    OPTIONS
+                    "TRACY_ENABLE ON"
+                    "TRACY_ON_DEMAND ON"
+            )
+        endif ()
+        # TracyClient defines TRACY_ENABLE and TRACY_ON_DEMAND for its users
+        target_link_dependencies(${TARGET_NAME} PRIVATE TracyClient)
+    elseif (COMMAND xrepo_package)
+        xrepo_package("tracy")
+        xrepo_target_packages(${TARGET_NAME} tracy)
+        target_compile_definitions(${TARGET_NAME} PRIVATE TRACY_ENABLE TRACY_ON_DEMAND)
+    else ()
+        message(FATAL_ERROR "ENABLE_PROFILER tracy: no package manager available.")
+    endif ()
+endfunction()
+
+# Helper function to link the Perfetto SDK, built once as profiler_perfetto with the track event storage
+function(_target_use_profiler_perfetto TARGET_NAME)
+    if (NOT TARGET profiler_perfetto)
+        if (COMMAND CPMAddPackage)
+            # The SDK is an amalgamated perfetto.h / perfetto.cc pair without a CMake build
+            CPMAddPackage(
+                    NAME perfetto
+                    GITHUB_REPOSITORY google/perfetto
+                    GIT_TAG v47.0
+                    DOWNLOAD_ONLY YES
+            )
+            add_library(profiler_perfetto STATIC "${perfetto_SOURCE_DIR}/sdk/perfetto.cc")
+            target_include_directories(profiler_perfetto SYSTEM PUBLIC "${perfetto_SOURCE_DIR}/sdk")
+        elseif (COMMAND xrepo_package)
+            xrepo_package("perfetto")
+            add_library(profiler_perfetto STATIC)
+            xrepo_target_packages(profiler_perfetto PUBLIC perfetto)
+        else ()
+            message(FATAL_ERROR "ENABLE_PROFILER perfetto: no package manager available.")
+        endif ()
+
+        get_property(_header_dir GLOBAL PROPERTY _PROFILER_HEADER_DIR)
+        file(CONFIGURE OUTPUT "${_header_dir}/profiler_perfetto.cpp" @ONLY CONTENT [=[
+// Generated by TargetProfiler.cmake, do not edit
+#include <profiler.hpp>
+
+PERFETTO_TRACK_EVENT_STATIC_STORAGE();
+
+namespace
+{
+    // Linked in with the storage above, so it runs in every process using PROFILE_ZONE
+    const bool registered = []
+    {
+        perfetto::TracingInitArgs args;
+        args.backends = perfetto::kSystemBackend;
+        perfetto::Tracing::Initialize(args);
+        return perfetto::TrackEvent::Register();
+    }();
+} // namespace
+]=])
+
+        find_package(Threads REQUIRED)
+        target_sources(profiler_perfetto PRIVATE "${_header_dir}/profiler_perfetto.cpp")
+        target_include_directories(profiler_perfetto PRIVATE "${_header_dir}")
+        target_compile_definitions(profiler_perfetto PRIVATE PROFILER_PERFETTO=1)
+        target_compile_features(profiler_perfetto PUBLIC cxx_std_17)
+        target_link_libraries(profiler_perfetto PUBLIC Threads::Threads)
+        set_target_properties(profiler_perfetto PROPERTIES POSITION_INDEPENDENT_CODE ON)
+        if (MSVC)
+            # perfetto.cc is a single very large translation unit
+            target_compile_options(profiler_perfetto PRIVATE /bigobj)
+            target_compile_definitions(profiler_perfetto PUBLIC NOMINMAX WIN32_LEAN_AND_MEAN)
+        endif ()
+    endif ()
+
+    target_link_libraries(${TARGET_NAME} PRIVATE profiler_perfetto)
+endfunction()
+
+# Helper function to link the ITT API, fetched once
+function(_target_use_profiler_itt TARGET_NAME)
+    if (COMMAND CPMAddPackage)
+        if (NOT TARGET ittnotify)
+            CPMAddPackage(
+                    NAME ittapi
+                    GITHUB_REPOSITORY intel/ittapi
+                    GIT_TAG v3.24.4
+                    SYSTEM ON
+            )
+        endif ()
+        target_link_libraries(${TARGET_NAME} PRIVATE ittnotify)
+    elseif (COMMAND xrepo_package)
+        xrepo_package("ittapi")
+        xrepo_target_packages(${TARGET_NAME} ittapi)
+    else ()
+        message(FATAL_ERROR "ENABLE_PROFILER itt: no package manager available.")
+    endif ()
+endfunction()
@@ -0,0 +1,138 @@
+include_guard(DIRECTORY)
+
+#
+# usage:
+# target_copy_runtime_dependencies(
+#   TARGET_NAME
+#   [TARGETS <shared library target> ...]   # Copied as $<TARGET_FILE:...>
+#   [FILES <path> ...]                      # External DLLs / shared objects
+# )
+#
+# Places the given files next to TARGET_NAME in the build tree, according to RUNTIME_DEPENDENCY_COPY:
+#   copy       - one step per target copies every changed file, skipped while a stamp is newer than all of them
+#   link       - same step, hard links with a copy fallback (other volume, no link support)
+#   post_build - one POST_BUILD copy_if_different per file, after every link of TARGET_NAME
+#
+# Repeated calls append to the same step, duplicates are ignored.
+#
+function(target_copy_runtime_dependencies TARGET_NAME)
+    set(multiValueArgs
+            TARGETS
+            FILES
+    )
+    cmake_parse_arguments(ARG "" "" "${multiValueArgs}" ${ARGN})
+
+    #
+
+    if (NOT TARGET ${TARGET_NAME})
+        message(FATAL_ERROR "target_copy_runtime_dependencies: Target '${TARGET_NAME}' does not exist")
+    endif ()
+
+    # Only binaries that run (or load plugins) need their dependencies next to them
+    get_target_property(_type ${TARGET_NAME} TYPE)
+    if (NOT _type MATCHES "^(EXECUTABLE|SHARED_LIBRARY|MODULE_LIBRARY)$")
+        return()
+    endif ()
+
+    string(TOLOWER "${RUNTIME_DEPENDENCY_COPY}" _mode)
+    if (_mode STREQUAL "")
+        set(_mode "copy")
+    endif ()
+    if (NOT _mode MATCHES "^(copy|link|post_build)$")
+        message(FATAL_ERROR "Unknown RUNTIME_DEPENDENCY_COPY '${RUNTIME_DEPENDENCY_COPY}' (expected copy, link or post_build)")
+    endif ()
+
+    set(_files "")
+    foreach (_lib ${ARG_TARGETS})
+        list(APPEND _files "$<TARGET_FILE:${_lib}>")
+    endforeach ()
+    foreach (_file ${ARG_FILES})
+        file(TO_CMAKE_PATH "${_file}" _file)
+        list(APPEND _files "${_file}")
+    endforeach ()
+
+    get_property(_registered TARGET ${TARGET_NAME} PROPERTY _RUNTIME_DEPENDENCY_FILES)
+    list(REMOVE_ITEM _files ${_registered})
+    if (NOT _files)
+        return()
+    endif ()
+    set_property(TARGET ${TARGET_NAME} APPEND PROPERTY _RUNTIME_DEPENDENCY_FILES ${_files})
+
+    if (_mode STREQUAL "post_build")
+        foreach (_file ${_files})
+            add_custom_command(TARGET ${TARGET_NAME} POST_BUILD
+                    COMMAND ${CMAKE_COMMAND} -E copy_if_different
+                    "${_file}"
+                    "$<TARGET_FILE_DIR:${TARGET_NAME}>/"
+                    COMMENT "Copying runtime dependency for ${TARGET_NAME}"
+                    VERBATIM
+            )
+        endforeach ()
+        return()
+    endif ()
+
+    _add_runtime_dependency_step(${TARGET_NAME} ${_mode})
+    if (ARG_TARGETS)
+        add_dependencies(${TARGET_NAME}_runtime_deps ${ARG_TARGETS})
+    endif ()
+endfunction()
+
+#
+
+# Helper function to create the stamped copy step of a target, once.
+# The file list is read from the target property at generate time, so later calls only append to it.
+function(_add_runtime_dependency_step TARGET_NAME MODE)
+    if (TARGET ${TARGET_NAME}_runtime_deps)
+        return()
+    endif ()
+
+    set(_script "${CMAKE_BINARY_DIR}/CMakeFiles/CopyRuntimeDependencies.cmake")
+    if (NOT EXISTS "${_script}")
+        file(WRITE "${_script}" [=[
+# Copies or links the files listed in MANIFEST into DESTINATION (MODE copy|link), generated by TargetRuntimeDependencies.cmake
+file(READ "${MANIFEST}" _files)
+file(MAKE_DIRECTORY "${DESTINATION}")
+get_filename_component(_destination "${DESTINATION}" REALPATH)
+
+foreach (_file ${_files})
+    get_filename_component(_file "${_file}" REALPATH)
+    get_filename_component(_name "${_file}" NAME)
+    set(_output "${_destination}/${_name}")
+    if (_file STREQUAL _output)
+        continue()
+    endif ()
+
+    if (MODE STREQUAL "link")
+        # A relinked library is a new file, the old hard link would keep the previous contents
+        file(REMOVE "${_output}")
+        file(CREATE_LINK "${_file}" "${_output}" COPY_ON_ERROR)
+    else ()
+        file(COPY_FILE "${_file}" "${_output}" ONLY_IF_DIFFERENT)
+    endif ()
+endforeach ()
+]=])
+    endif ()
+
+    set(_dir "${CMAKE_CURRENT_BINARY_DIR}/CMakeFiles/${TARGET_NAME}_runtime_deps.dir")
+    set(_files "$<GENEX_EVAL:$<TARGET_PROPERTY:${TARGET_NAME},_RUNTIME_DEPENDENCY_FILES>>")
+    set(_manifest "${_dir}/manifest-$<CONFIG>.txt")
+    set(_stamp "${_dir}/copy-$<CONFIG>.stamp")
+
+    # Only rewritten when the list changes, which then reruns the step
+    file(GENERATE OUTPUT "${_manifest}" CONTENT "${_files}" TARGET ${TARGET_NAME})
+
+    add_custom_command(
+            OUTPUT "${_stamp}"
+            COMMAND ${CMAKE_COMMAND}
+            "-DMANIFEST=${_manifest}"
+            "-DDESTINATION=$<TARGET_FILE_DIR:${TARGET_NAME}>"
+            "-DMODE=${MODE}"
+            -P "${_script}"
+            COMMAND ${CMAKE_COMMAND} -E touch "${_stamp}"
+            DEPENDS "${_files}" "${_manifest}"
+            COMMENT "Copying runtime dependencies for ${TARGET_NAME}"
+            VERBATIM
+    )
+    add_custom_target(${TARGET_NAME}_runtime_deps DEPENDS "${_stamp}")
+    add_dependencies(${TARGET_NAME} ${TARGET_NAME}_runtime_deps)
+endfunction()
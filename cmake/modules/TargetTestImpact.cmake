@@ -0,0 +1,301 @@
+include_guard(DIRECTORY)
+include(TargetDependencyClosure)
+
+#
+# usage:
+#   target_track_test_impact(TARGET_NAME)
+#
+# Records TARGET_NAME as a test executable whose CTest entries are named TARGET_NAME or TARGET_NAME.<case>
+# (register_test() calls it, discovered cases and shards included). At the end of the configure step the
+# dependency closure of every tracked test is written to ${CMAKE_BINARY_DIR}/test-impact.json:
+#   sources      - source files of the test and of every target it links, relative to the source tree
+#   include_dirs - include directories of those targets, headers changed below them count
+#   source_dirs  - directories holding those sources, headers changed there count (quoted includes)
+#   cmake_files  - CMakeLists.txt of those targets
+#
+# The ctest-affected target runs only the tests whose closure holds a file changed in TEST_IMPACT_RANGE
+# (a git diff range, the TEST_IMPACT_RANGE environment variable wins), building the tests is up to the caller:
+#   TEST_IMPACT_RANGE=origin/main...HEAD cmake --build <dir> --target ctest-affected
+# Other build files changed (*.cmake, a CMakeLists.txt no test depends on, CMakePresets.json) run every test.
+#
+function(target_track_test_impact TARGET_NAME)
+    if (NOT TARGET ${TARGET_NAME})
+        message(FATAL_ERROR "target_track_test_impact: Target '${TARGET_NAME}' does not exist")
+    endif ()
+
+    get_property(_tracked GLOBAL PROPERTY _TEST_IMPACT_TARGETS)
+    list(FIND _tracked ${TARGET_NAME} _index)
+    if (_index GREATER -1)
+        return()
+    endif ()
+    set_property(GLOBAL APPEND PROPERTY _TEST_IMPACT_TARGETS ${TARGET_NAME})
+
+    # Sources and links are still added after this call, the map is written once everything is known
+    if (NOT _tracked)
+        cmake_language(DEFER DIRECTORY "${CMAKE_SOURCE_DIR}" CALL _write_test_impact_map)
+        _add_test_impact_target()
+    endif ()
+endfunction()
+
+#
+
+# Helper function to append PATH, relative to the source tree, to the list in LIST_VAR.
+# Paths outside the source tree or in the build tree are skipped, the source tree itself is ".".
+function(_test_impact_append_path LIST_VAR PATH BASE_DIR)
+    if (PATH MATCHES "^\\$<BUILD_INTERFACE:([^>]*)>$")
+        set(PATH "${CMAKE_MATCH_1}")
+    elseif (PATH MATCHES "\\$<")
+        return()
+    endif ()
+    get_filename_component(PATH "${PATH}" ABSOLUTE BASE_DIR "${BASE_DIR}")
+    string(FIND "${PATH}/" "${CMAKE_BINARY_DIR}/" _in_binary_dir)
+    file(RELATIVE_PATH _relative "${CMAKE_SOURCE_DIR}" "${PATH}")
+    if (_in_binary_dir EQUAL 0 OR _relative MATCHES "^\\.\\./" OR IS_ABSOLUTE "${_relative}")
+        return()
+    endif ()
+    if (_relative STREQUAL "")
+        set(_relative ".")
+    endif ()
+    list(APPEND ${LIST_VAR} "${_relative}")
+    set(${LIST_VAR} "${${LIST_VAR}}" PARENT_SCOPE)
+endfunction()
+
+# Helper function to convert a list of paths to a JSON array
+function(_test_impact_json_array LIST RESULT_VAR)
+    set(_json "[]")
+    set(_index 0)
+    foreach (_path ${LIST})
+        string(REPLACE "\\" "\\\\" _path "${_path}")
+        string(REPLACE "\"" "\\\"" _path "${_path}")
+        string(JSON _json SET "${_json}" ${_index} "\"${_path}\"")
+        math(EXPR _index "${_index} + 1")
+    endforeach ()
+    set(${RESULT_VAR} "${_json}" PARENT_SCOPE)
+endfunction()
+
+# Helper function to write test-impact.json, deferred to the end of the top level directory
+function(_write_test_impact_map)
+    get_property(_tracked GLOBAL PROPERTY _TEST_IMPACT_TARGETS)
+
+    set(_tests "{}")
+    foreach (_test ${_tracked})
+        get_target_dependency_closure(${_test} _closure)
+
+        set(_sources "")
+        set(_include_dirs "")
+        set(_source_dirs "")
+        set(_cmake_files "")
+        foreach (_target ${_test} ${_closure})
+            get_target_property(_imported ${_target} IMPORTED)
+            if (_imported)
+                continue()
+            endif ()
+            get_target_property(_dir ${_target} SOURCE_DIR)
+            _test_impact_append_path(_cmake_files "CMakeLists.txt" "${_dir}")
+
+            set(_files "")
+            foreach (_property SOURCES HEADER_SET CXX_MODULE_SET)
+                get_target_property(_property_files ${_target} ${_property})
+                if (_property_files)
+                    list(APPEND _files ${_property_files})
+                endif ()
+            endforeach ()
+            foreach (_file ${_files})
+                _test_impact_append_path(_sources "${_file}" "${_dir}")
+                if (NOT _file MATCHES "\\$<")
+                    get_filename_component(_file "${_file}" ABSOLUTE BASE_DIR "${_dir}")
+                    get_filename_component(_file_dir "${_file}" DIRECTORY)
+                    _test_impact_append_path(_source_dirs "${_file_dir}" "${_dir}")
+                endif ()
+            endforeach ()
+
+            foreach (_property INCLUDE_DIRECTORIES INTERFACE_INCLUDE_DIRECTORIES)
+                get_target_property(_include_list ${_target} ${_property})
+                if (NOT _include_list)
+                    continue()
+                endif ()
+                foreach (_include ${_include_list})
+                    _test_impact_append_path(_include_dirs "${_include}" "${_dir}")
+                endforeach ()
+            endforeach ()
+        endforeach ()
+
+        set(_entry "{}")
+        foreach (_category sources include_dirs source_dirs cmake_files)
+            if (_${_category})
+                list(REMOVE_DUPLICATES _${_category})
+            endif ()
+            _test_impact_json_array("${_${_category}}" _array)
+            string(JSON _entry SET "${_entry}" ${_category} "${_array}")
+        endforeach ()
+        string(JSON _tests SET "${_tests}" "${_test}" "${_entry}")
+    endforeach ()
+
+    set(_map "{}")
+    string(JSON _map SET "${_map}" tests "${_tests}")
+    # Rewritten only when it changed, file(GENERATE) leaves text outside $<...> alone
+    file(GENERATE OUTPUT "${CMAKE_BINARY_DIR}/test-impact.json" CONTENT "${_map}\n")
+endfunction()
+
+# Helper function to create the ctest-affected target, once
+function(_add_test_impact_target)
+    find_package(Git QUIET)
+    if (NOT GIT_FOUND)
+        message(STATUS "** Git not found, ctest-affected is not available")
+        return()
+    endif ()
+
+    set(_script "${CMAKE_BINARY_DIR}/CMakeFiles/TestImpactRun.cmake")
+    file(CONFIGURE OUTPUT "${_script}" @ONLY CONTENT [=[
+# Runs the tests whose dependency closure changed in RANGE, generated by TargetTestImpact.cmake:
+#   cmake -DBUILD_DIR=<dir> -DSOURCE_DIR=<dir> -DGIT=<git> -DCTEST=<ctest> [-DCONFIG=<config>] [-DRANGE=<range>] -P TestImpactRun.cmake
+cmake_policy(VERSION 3.21)
+if (DEFINED ENV{TEST_IMPACT_RANGE} AND NOT "$ENV{TEST_IMPACT_RANGE}" STREQUAL "")
+    set(RANGE "$ENV{TEST_IMPACT_RANGE}")
+endif ()
+if (NOT RANGE)
+    set(RANGE HEAD)
+endif ()
+
+file(READ "${BUILD_DIR}/test-impact.json" _map)
+string(JSON _tests GET "${_map}" tests)
+string(JSON _test_count LENGTH "${_tests}")
+if (_test_count EQUAL 0)
+    message(STATUS "No tracked tests")
+    return()
+endif ()
+
+separate_arguments(_range UNIX_COMMAND "${RANGE}")
+execute_process(
+        COMMAND "${GIT}" diff --name-only ${_range} --
+        WORKING_DIRECTORY "${SOURCE_DIR}"
+        OUTPUT_VARIABLE _changed
+        ERROR_VARIABLE _error
+        RESULT_VARIABLE _result
+        OUTPUT_STRIP_TRAILING_WHITESPACE
+)
+if (NOT _result EQUAL 0)
+    message(FATAL_ERROR "git diff --name-only ${RANGE} failed:\n${_error}")
+endif ()
+
+# git prints paths relative to the top of the work tree, the map is relative to SOURCE_DIR
+execute_process(
+        COMMAND "${GIT}" rev-parse --show-prefix
+        WORKING_DIRECTORY "${SOURCE_DIR}"
+        OUTPUT_VARIABLE _prefix
+        OUTPUT_STRIP_TRAILING_WHITESPACE
+)
+string(REPLACE "\n" ";" _changed "${_changed}")
+string(LENGTH "${_prefix}" _prefix_length)
+set(_files "")
+foreach (_file ${_changed})
+    string(SUBSTRING "${_file}" 0 ${_prefix_length} _head)
+    if (_head STREQUAL _prefix)
+        string(SUBSTRING "${_file}" ${_prefix_length} -1 _file)
+        list(APPEND _files "${_file}")
+    endif ()
+endforeach ()
+
+# Returns TRUE in RESULT_VAR when FILE equals an entry of ARRAY, or lies below one when PREFIX is set
+function(_impact_matches ENTRY ARRAY FILE PREFIX RESULT_VAR)
+    set(${RESULT_VAR} FALSE PARENT_SCOPE)
+    string(JSON _length LENGTH "${ENTRY}" ${ARRAY})
+    if (_length EQUAL 0)
+        return()
+    endif ()
+    math(EXPR _last "${_length} - 1")
+    foreach (_index RANGE ${_last})
+        string(JSON _path GET "${ENTRY}" ${ARRAY} ${_index})
+        if (FILE STREQUAL _path OR (PREFIX AND _path STREQUAL "."))
+            set(${RESULT_VAR} TRUE PARENT_SCOPE)
+            return()
+        endif ()
+        if (PREFIX)
+            string(FIND "${FILE}" "${_path}/" _position)
+            if (_position EQUAL 0)
+                set(${RESULT_VAR} TRUE PARENT_SCOPE)
+                return()
+            endif ()
+        endif ()
+    endforeach ()
+endfunction()
+
+set(_names "")
+math(EXPR _last "${_test_count} - 1")
+foreach (_index RANGE ${_last})
+    string(JSON _name MEMBER "${_tests}" ${_index})
+    list(APPEND _names "${_name}")
+endforeach ()
+
+set(_affected "")
+set(_run_all FALSE)
+foreach (_file ${_files})
+    set(_matched FALSE)
+    foreach (_name ${_names})
+        string(JSON _entry GET "${_tests}" "${_name}")
+        _impact_matches("${_entry}" sources "${_file}" FALSE _hit)
+        if (NOT _hit)
+            _impact_matches("${_entry}" cmake_files "${_file}" FALSE _hit)
+        endif ()
+        # Directories only select headers, sources and CMake files are matched by name above
+        if (NOT _hit AND _file MATCHES "\\.(h|hh|hpp|hxx|h\\+\\+|inl|ipp|tpp)$")
+            _impact_matches("${_entry}" include_dirs "${_file}" TRUE _hit)
+            if (NOT _hit)
+                _impact_matches("${_entry}" source_dirs "${_file}" TRUE _hit)
+            endif ()
+        endif ()
+        if (_hit)
+            set(_matched TRUE)
+            list(APPEND _affected "${_name}")
+        endif ()
+    endforeach ()
+    if (NOT _matched AND _file MATCHES "(^|/)(CMakeLists\\.txt|CMakePresets\\.json|[^/]+\\.cmake)$")
+        message(STATUS "${_file} changed, running every test")
+        set(_run_all TRUE)
+    endif ()
+endforeach ()
+
+set(_ctest "${CTEST}" --test-dir "${BUILD_DIR}" --output-on-failure)
+if (CONFIG)
+    list(APPEND _ctest -C "${CONFIG}")
+endif ()
+if (NOT _run_all)
+    if (NOT _affected)
+        message(STATUS "No test is affected by ${RANGE}")
+        return()
+    endif ()
+    list(REMOVE_DUPLICATES _affected)
+    list(LENGTH _affected _affected_count)
+    string(JOIN ", " _list ${_affected})
+    message(STATUS "${_affected_count} of ${_test_count} test executable(s) affected by ${RANGE}: ${_list}")
+
+    # Test names match the executable, discovered cases and shards are <name>.<suffix>
+    set(_patterns "")
+    foreach (_name ${_affected})
+        string(REGEX REPLACE "([][.+*?^$(){}|\\\\])" "\\\\\\1" _name "${_name}")
+        list(APPEND _patterns "${_name}")
+    endforeach ()
+    string(JOIN "|" _regex ${_patterns})
+    list(APPEND _ctest -R "^(${_regex})($|\\.)")
+endif ()
+
+execute_process(COMMAND ${_ctest} RESULT_VARIABLE _result)
+if (NOT _result EQUAL 0)
+    message(FATAL_ERROR "Affected tests failed")
+endif ()
+]=])
+
+    add_custom_target(ctest-affected
+            COMMAND ${CMAKE_COMMAND}
+            "-DBUILD_DIR=${CMAKE_BINARY_DIR}"
+            "-DSOURCE_DIR=${CMAKE_SOURCE_DIR}"
+            "-DGIT=${GIT_EXECUTABLE}"
+            "-DCTEST=${CMAKE_CTEST_COMMAND}"
+            "-DCONFIG=$<CONFIG>"
+            "-DRANGE=${TEST_IMPACT_RANGE}"
+            -P "${_script}"
+            COMMENT "Running the tests affected by the changes"
+            USES_TERMINAL
+            VERBATIM
+    )
+endfunction()
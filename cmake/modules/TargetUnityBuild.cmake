@@ -0,0 +1,83 @@
+include_guard(DIRECTORY)
+
+#
+# usage:
+# target_enable_unity_build(
+#   TARGET_NAME
+#   [ENABLE ON/OFF]             # Override ENABLE_GLOBAL_UNITY_BUILD for this target
+#   [BATCH_SIZE <n>]            # Sources per unity file, 0 = all sources in one file
+#   [EXCLUDE <source> ...]      # Sources that must be compiled on their own
+# )
+#
+# Resolution order:
+#   - ENABLE overrides ENABLE_GLOBAL_UNITY_BUILD
+#   - BATCH_SIZE overrides GLOBAL_UNITY_BUILD_BATCH_SIZE
+#
+function(target_enable_unity_build TARGET_NAME)
+    set(oneValueArgs
+            ENABLE
+            BATCH_SIZE
+    )
+    set(multiValueArgs
+            EXCLUDE
+    )
+    cmake_parse_arguments(ARG "" "${oneValueArgs}" "${multiValueArgs}" ${ARGN})
+
+    #
+
+    if (NOT TARGET ${TARGET_NAME})
+        message(FATAL_ERROR "target_enable_unity_build: Target '${TARGET_NAME}' does not exist")
+    endif ()
+
+    # Interface and imported targets have nothing to compile
+    get_target_property(_type ${TARGET_NAME} TYPE)
+    get_target_property(_imported ${TARGET_NAME} IMPORTED)
+    if (_type STREQUAL "INTERFACE_LIBRARY" OR _imported)
+        return()
+    endif ()
+
+    # Configure once, so register_*() and target_setup_common_options() can both call this
+    get_target_property(_configured ${TARGET_NAME} _UNITY_BUILD_CONFIGURED)
+    if (_configured)
+        return()
+    endif ()
+    set_target_properties(${TARGET_NAME} PROPERTIES _UNITY_BUILD_CONFIGURED TRUE)
+
+    set(UNITY_BUILD_VALUE ${ENABLE_GLOBAL_UNITY_BUILD})
+    if (DEFINED ARG_ENABLE)
+        set(UNITY_BUILD_VALUE ${ARG_ENABLE})
+    endif ()
+
+    if (NOT UNITY_BUILD_VALUE)
+        # Explicitly off, so a CMAKE_UNITY_BUILD given on the command line does not override the target
+        if (DEFINED ARG_ENABLE)
+            set_target_properties(${TARGET_NAME} PROPERTIES UNITY_BUILD OFF)
+        endif ()
+        return()
+    endif ()
+
+    set(BATCH_SIZE_VALUE ${GLOBAL_UNITY_BUILD_BATCH_SIZE})
+    if (DEFINED ARG_BATCH_SIZE)
+        set(BATCH_SIZE_VALUE ${ARG_BATCH_SIZE})
+    endif ()
+    if (NOT BATCH_SIZE_VALUE MATCHES "^[0-9]+$")
+        message(FATAL_ERROR "target_enable_unity_build: BATCH_SIZE for '${TARGET_NAME}' must be a non-negative integer, got '${BATCH_SIZE_VALUE}'")
+    endif ()
+
+    set_target_properties(${TARGET_NAME} PROPERTIES
+            UNITY_BUILD ON
+            UNITY_BUILD_MODE BATCH
+            UNITY_BUILD_BATCH_SIZE ${BATCH_SIZE_VALUE}
+    )
+
+    if (ARG_EXCLUDE)
+        # Sources are resolved relative to the directory that calls register_*()
+        set_source_files_properties(${ARG_EXCLUDE}
+                TARGET_DIRECTORY ${TARGET_NAME}
+                PROPERTIES SKIP_UNITY_BUILD_INCLUSION ON
+        )
+    endif ()
+
+    list(LENGTH ARG_EXCLUDE _excluded_count)
+    message(STATUS "** Unity build enabled for '${TARGET_NAME}' (batch size: ${BATCH_SIZE_VALUE}, excluded: ${_excluded_count})")
+endfunction()
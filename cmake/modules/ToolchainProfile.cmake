@@ -0,0 +1,84 @@
+include_guard(DIRECTORY)
+include(GetCurrentCompiler)
+include(CheckSanitizerSupport)
+
+# Bump when the stored entries change meaning, so old build trees probe again
+set(_TOOLCHAIN_PROFILE_FORMAT 1)
+
+#
+# usage:
+#   load_toolchain_profile()
+#
+# Detects the compiler once per build tree and keeps the results in the cache (CACHE INTERNAL), so
+# get_current_compiler(), the sanitizer support checks, the IPO check and the hardening flag probes
+# of every target read it instead of probing again. Options.cmake calls it before anything else.
+# The stored entries are dropped when the compiler, its version or the toolchain file change.
+#
+# Stored keys (read with toolchain_profile_get()):
+#   COMPILER          - MSVC, CLANG-MSVC, CLANG, GCC or EMSCRIPTEN, empty when unsupported
+#   COMPILER_VERSION  - MSVC_VERSION for MSVC, CMAKE_CXX_COMPILER_VERSION otherwise
+#   SUPPORTS_UBSAN    - result of check_sanitizers_support()
+#   SUPPORTS_ASAN     - result of check_sanitizers_support()
+# Modules add their own entries (IPO_*, HARDENING_*) the first time they probe.
+#
+function(load_toolchain_profile)
+    get_property(_loaded GLOBAL PROPERTY _TOOLCHAIN_PROFILE_LOADED)
+    if (_loaded)
+        return()
+    endif ()
+
+    string(MD5 _fingerprint "${_TOOLCHAIN_PROFILE_FORMAT};${CMAKE_CXX_COMPILER_ID};${CMAKE_CXX_COMPILER_VERSION};${CMAKE_CXX_COMPILER};${CMAKE_SYSTEM_NAME};${CMAKE_SYSTEM_PROCESSOR};${CMAKE_TOOLCHAIN_FILE}")
+    if ("${_TOOLCHAIN_PROFILE_FINGERPRINT}" STREQUAL "${_fingerprint}")
+        set_property(GLOBAL PROPERTY _TOOLCHAIN_PROFILE_LOADED TRUE)
+        message(STATUS "** Toolchain profile: ${_TOOLCHAIN_PROFILE_COMPILER} ${_TOOLCHAIN_PROFILE_COMPILER_VERSION} (cached)")
+        return()
+    endif ()
+
+    # New build tree or another compiler, forget what was probed with the previous one
+    foreach (_key ${_TOOLCHAIN_PROFILE_KEYS})
+        unset(_TOOLCHAIN_PROFILE_${_key} CACHE)
+    endforeach ()
+    set(_TOOLCHAIN_PROFILE_KEYS "" CACHE INTERNAL "Keys stored in the toolchain profile")
+
+    _detect_current_compiler(_compiler _version)
+    check_sanitizers_support(_supports_ubsan _supports_asan)
+
+    toolchain_profile_set(COMPILER "${_compiler}")
+    toolchain_profile_set(COMPILER_VERSION "${_version}")
+    toolchain_profile_set(SUPPORTS_UBSAN ${_supports_ubsan})
+    toolchain_profile_set(SUPPORTS_ASAN ${_supports_asan})
+
+    set(_TOOLCHAIN_PROFILE_FINGERPRINT "${_fingerprint}" CACHE INTERNAL "Compiler the toolchain profile was probed with")
+    set_property(GLOBAL PROPERTY _TOOLCHAIN_PROFILE_LOADED TRUE)
+    message(STATUS "** Toolchain profile: ${_compiler} ${_version} (probed)")
+endfunction()
+
+#
+# usage:
+#   toolchain_profile_get(KEY OUTPUT_VARIABLE)
+#
+# Sets OUTPUT_VARIABLE to the stored value of KEY, and OUTPUT_VARIABLE_FOUND to whether KEY is stored
+#
+function(toolchain_profile_get KEY OUTPUT_VARIABLE)
+    if (DEFINED CACHE{_TOOLCHAIN_PROFILE_${KEY}})
+        set(${OUTPUT_VARIABLE} "$CACHE{_TOOLCHAIN_PROFILE_${KEY}}" PARENT_SCOPE)
+        set(${OUTPUT_VARIABLE}_FOUND TRUE PARENT_SCOPE)
+    else ()
+        set(${OUTPUT_VARIABLE} "" PARENT_SCOPE)
+        set(${OUTPUT_VARIABLE}_FOUND FALSE PARENT_SCOPE)
+    endif ()
+endfunction()
+
+#
+# usage:
+#   toolchain_profile_set(KEY [VALUE...])
+#
+# Stores VALUE (a list is kept as is) under KEY until the compiler changes
+#
+function(toolchain_profile_set KEY)
+    set(_TOOLCHAIN_PROFILE_${KEY} "${ARGN}" CACHE INTERNAL "Toolchain profile: ${KEY}")
+    if (NOT KEY IN_LIST _TOOLCHAIN_PROFILE_KEYS)
+        set(_keys ${_TOOLCHAIN_PROFILE_KEYS} ${KEY})
+        set(_TOOLCHAIN_PROFILE_KEYS "${_keys}" CACHE INTERNAL "Keys stored in the toolchain profile")
+    endif ()
+endfunction()
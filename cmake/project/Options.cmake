@@ -1,17 +1,27 @@
 include_guard(DIRECTORY)
 
-include(CheckSanitizerSupport)
+include(ToolchainProfile)
 include(CMakeDependentOption)
 
+# === CONFIGURE OPTIONS ===
+option(CONFIGURE_QUIET "Hide the per-target status lines of register_*() and the hardening probes (warnings and the summary stay)" OFF)
+
+# Probe the compiler once per build tree, every per-target function reads the result
+load_toolchain_profile()
+
 # Check what sanitizers are supported
-check_sanitizers_support(SUPPORTS_UBSAN SUPPORTS_ASAN)
+toolchain_profile_get(SUPPORTS_UBSAN SUPPORTS_UBSAN)
+toolchain_profile_get(SUPPORTS_ASAN SUPPORTS_ASAN)
 
 #
 
 # === CACHE CONFIGURATION OPTIONS ===
 set(ENABLE_CCACHE ON CACHE BOOL "Enable ccache for faster rebuilds")
+set(COMPILER_CACHE "auto" CACHE STRING "Compiler cache: auto (ccache > sccache), ccache, sccache or none")
+set_property(CACHE COMPILER_CACHE PROPERTY STRINGS auto ccache sccache none)
+set(COMPILER_CACHE_REMOTE "" CACHE STRING "Remote compiler cache backend (ccache remote_storage URL, sccache s3://, gs://, redis://, http(s)://)")
 
-mark_as_advanced(ENABLE_CCACHE)
+mark_as_advanced(ENABLE_CCACHE COMPILER_CACHE_REMOTE)
 
 # === PACKAGE MANAGEMENT OPTIONS ===
 set(PACKAGE_MANAGERS "CPM" CACHE STRING "Package managers to enable (semicolon-separated list: CPM, XMake)")
@@ -36,7 +46,13 @@ set(ENABLE_GLOBAL_EXCEPTIONS "ON" CACHE STRING "Enable global exception handling
 set(ENABLE_GLOBAL_WARNINGS_AS_ERRORS "${DEV_MODE}" CACHE STRING "Enable global warnings as errors")
 set(ENABLE_GLOBAL_SANITIZERS "${DEV_MODE}" CACHE STRING "Enable global sanitizers")
 set(ENABLE_GLOBAL_HARDENING "${DEV_MODE}" CACHE STRING "Enable global hardening")
+set(HARDENING_LEVEL "lightweight" CACHE STRING "Hardening tier: none, lightweight (production-cheap checks) or full (adds libstdc++ debug containers)")
+set_property(CACHE HARDENING_LEVEL PROPERTY STRINGS none lightweight full)
 set(ENABLE_GLOBAL_STATIC_ANALYSIS "${DEV_MODE}" CACHE STRING "Enable global static analysis")
+set(CLANG_TIDY_MODE "target" CACHE STRING "How clang-tidy runs: target (cached tidy / <target>_tidy build targets) or compile (with every compile)")
+set_property(CACHE CLANG_TIDY_MODE PROPERTY STRINGS target compile)
+set(CLANG_TIDY_CACHE_DIR "${CMAKE_BINARY_DIR}/tidy-cache" CACHE PATH "clang-tidy results by hash of the preprocessed source, .clang-tidy and command line")
+set(CLANG_TIDY_JOBS "0" CACHE STRING "Concurrent clang-tidy jobs with Ninja (0 = build parallelism)")
 
 # === SANITIZER OPTIONS ===
 if (DEV_MODE OR ENABLE_GLOBAL_SANITIZERS)
@@ -61,16 +77,71 @@ if (NOT ENABLE_DEBUG_INFO)
 else ()
     set(DEBUG_INFO_LEVEL "2" CACHE STRING "Debug information level (0-3 for GCC/Clang, ignored for MSVC)")
 endif ()
+set(DEBUG_INFO_FORMAT "default" CACHE STRING "Debug information format: default, split (-gsplit-dwarf, MSVC /Z7 + /DEBUG:FASTLINK), compressed (-gz=zstd) or both")
+set_property(CACHE DEBUG_INFO_FORMAT PROPERTY STRINGS default split compressed both)
+set(ENABLE_PROFILER "none" CACHE STRING "Runtime profiler linked into registered targets: none (zone macros compile out), tracy, perfetto or itt")
+set_property(CACHE ENABLE_PROFILER PROPERTY STRINGS none tracy perfetto itt)
 
 # === LINKING OPTIONS ===
 option(ENABLE_STATIC_RUNTIME "Statically link runtime libraries for better portability" OFF)
+set(LINKER "auto" CACHE STRING "Linker to use: auto (mold > lld > gold), mold, lld, gold or default")
+set_property(CACHE LINKER PROPERTY STRINGS auto mold lld gold default)
+set(RUNTIME_DEPENDENCY_COPY "copy" CACHE STRING "How shared library dependencies reach the build tree: copy (one stamped step per target), link (hard links) or post_build (one copy per library after every link)")
+set_property(CACHE RUNTIME_DEPENDENCY_COPY PROPERTY STRINGS copy link post_build)
+set(ALLOCATOR "system" CACHE STRING "malloc implementation of registered executables and tests: system, mimalloc, jemalloc, tcmalloc or snmalloc")
+set_property(CACHE ALLOCATOR PROPERTY STRINGS system mimalloc jemalloc tcmalloc snmalloc)
 option(ENABLE_GLOBAL_IPO "Enable global link-time optimization (LTO)" ${RELEASE_MODE})
+set(IPO_LTO_MODE "thin" CACHE STRING "LTO flavour when IPO is enabled: thin (ThinLTO, Clang only) or full")
+set_property(CACHE IPO_LTO_MODE PROPERTY STRINGS thin full)
+set(IPO_LTO_CACHE_DIR "${CMAKE_BINARY_DIR}/lto-cache" CACHE PATH "Incremental LTO cache directory, empty to disable")
+option(IPO_MSVC_INCREMENTAL_LTCG "Link MSVC IPO builds with /LTCG:INCREMENTAL (keeps .iobj/.ipdb next to the objects, not in IPO_LTO_CACHE_DIR)" OFF)
+set(MARCH "" CACHE STRING "CPU level for all targets: native, x86-64-v2, x86-64-v3, x86-64-v4, ... (empty keeps the compiler default)")
+set_property(CACHE MARCH PROPERTY STRINGS "" native x86-64-v2 x86-64-v3 x86-64-v4)
+option(LEAN_BINARIES "Smaller, faster loading binaries: section GC, identical code folding, lean dynamic tables, hidden visibility for exported shared libraries" OFF)
+set(LEAN_ICF "all" CACHE STRING "Identical code folding with LEAN_BINARIES (lld, gold, mold): all, safe (keeps address-taken functions apart) or none")
+set_property(CACHE LEAN_ICF PROPERTY STRINGS all safe none)
+
+# === PROFILE-GUIDED OPTIMIZATION OPTIONS ===
+set(PGO_MODE "OFF" CACHE STRING "Profile-guided optimization: OFF, GENERATE (instrument + train) or USE (optimize with profiles)")
+set_property(CACHE PGO_MODE PROPERTY STRINGS OFF GENERATE USE)
+set(PGO_PROFILE_DIR "${CMAKE_BINARY_DIR}/pgo" CACHE PATH "Directory holding PGO training profiles")
+
+# === POST-LINK OPTIMIZATION OPTIONS ===
+cmake_dependent_option(
+        ENABLE_BOLT
+        "Optimize the code layout of registered executables with llvm-bolt (<binary>.bolt, installed in place of the binary)"
+        OFF "RELEASE_MODE" OFF
+)
+set(BOLT_PROFILE_MODE "instrument" CACHE STRING "How the BOLT training run is profiled: instrument (llvm-bolt -instrument) or perf (perf record + perf2bolt)")
+set_property(CACHE BOLT_PROFILE_MODE PROPERTY STRINGS instrument perf)
+option(BOLT_PERF_LBR "Record branch stacks (LBR / BRBE) with perf, turn off on hosts without them (VMs)" ON)
+set(BOLT_PROFILE_DIR "${CMAKE_BINARY_DIR}/bolt" CACHE PATH "Directory holding BOLT training profiles")
+set(BOLT_OPTIONS "-reorder-blocks=ext-tsp;-reorder-functions=hfsort;-split-functions;-split-all-cold;-split-eh;-dyno-stats"
+        CACHE STRING "llvm-bolt options used to write <binary>.bolt")
+
+# === BUILD ACCELERATION OPTIONS ===
+option(ENABLE_GLOBAL_PCH "Enable precompiled headers for all registered targets" OFF)
+set(GLOBAL_PCH_HEADERS "<algorithm>;<memory>;<string>;<string_view>;<unordered_map>;<utility>;<vector>"
+        CACHE STRING "Headers precompiled when ENABLE_GLOBAL_PCH is on and a target sets no PRECOMPILE_HEADERS")
+option(ENABLE_GLOBAL_UNITY_BUILD "Enable batched unity builds for all registered targets" OFF)
+set(GLOBAL_UNITY_BUILD_BATCH_SIZE "8" CACHE STRING "Sources per unity file when a target sets no UNITY_BATCH_SIZE (0 = unlimited)")
+option(ENABLE_BUILD_PROFILING "Trace compile times of registered targets (-ftime-trace, MSVC /Bt+ /d1reportTime), ranked by the build-profile target" OFF)
+option(ENABLE_IMPORT_STD "Build registered targets as C++23 with import std (CMake 3.30+, clang 18+ with libc++ or MSVC 17.10+, Ninja 1.11+)" OFF)
 
 # === EMSCRIPTEN OPTIONS ===
-option(ENABLE_EMSDK_AUTO_INSTALL "Automatically install EMSDK locally if not found" ON)
+option(ENABLE_EMSDK_AUTO_INSTALL "Automatically install EMSDK to EMSDK_CACHE_DIR if not found" ON)
+set(EMSDK_VERSION "latest" CACHE STRING "EMSDK version installed by ENABLE_EMSDK_AUTO_INSTALL (pinned by the emscripten presets)")
+set(EMSDK_CACHE_DIR "" CACHE PATH "Shared directory EMSDK versions are installed to (empty = $EMSDK_CACHE_DIR, else the user cache directory)")
+set(EMSDK_EM_CACHE "" CACHE PATH "Prebuilt Emscripten system library cache to use instead of the one next to EMSDK (empty = $EM_CACHE)")
+option(EMSDK_PREWARM "Build the Emscripten system libraries of EMSDK_PREWARM_VARIANTS at configure time (embuilder)" OFF)
+set(EMSDK_PREWARM_VARIANTS "pthreads;pthreads-lto" CACHE STRING "System library variants built by EMSDK_PREWARM (default, pthreads, lto, pthreads-lto)")
 
 # === TESTING OPTIONS ==
 set(BUILD_TESTING ON CACHE BOOL "Build and enable testing")
+set(BENCHMARK_BASELINE_DIR "${CMAKE_SOURCE_DIR}/benchmarks/baseline" CACHE PATH "Stored benchmark results compared by the benchmark-compare target")
+set(BENCHMARK_REGRESSION_THRESHOLD "10" CACHE STRING "Slowdown in percent past which benchmark-compare fails")
+set(BENCHMARK_REPETITIONS "3" CACHE STRING "Google Benchmark repetitions per registered benchmark, medians are compared")
+set(TEST_IMPACT_RANGE "HEAD" CACHE STRING "git diff range whose changes select the tests run by ctest-affected (environment variable TEST_IMPACT_RANGE wins)")
 
 #
 
@@ -78,8 +149,14 @@ set(BUILD_TESTING ON CACHE BOOL "Build and enable testing")
 mark_as_advanced(
         ENABLE_ASAN ENABLE_LSAN ENABLE_UBSAN ENABLE_TSAN ENABLE_MSAN
         ENABLE_CLANG_TIDY ENABLE_CPPCHECK
-        ENABLE_UNITY_BUILD ENABLE_PCH
-        ENABLE_EMSDK_AUTO_INSTALL
+        GLOBAL_PCH_HEADERS GLOBAL_UNITY_BUILD_BATCH_SIZE
+        PGO_PROFILE_DIR
+        BOLT_PERF_LBR BOLT_PROFILE_DIR BOLT_OPTIONS
+        BENCHMARK_BASELINE_DIR BENCHMARK_REPETITIONS TEST_IMPACT_RANGE
+        IPO_LTO_MODE IPO_LTO_CACHE_DIR IPO_MSVC_INCREMENTAL_LTCG LEAN_ICF
+        CLANG_TIDY_CACHE_DIR CLANG_TIDY_JOBS
+        RUNTIME_DEPENDENCY_COPY
+        ENABLE_EMSDK_AUTO_INSTALL EMSDK_CACHE_DIR EMSDK_EM_CACHE EMSDK_PREWARM_VARIANTS
         ENABLE_EXCEPTIONS
         ENABLE_EDIT_AND_CONTINUE
 )
@@ -98,6 +175,9 @@ cmake_dependent_option(
         ON "NOT ENABLE_ASAN AND NOT ENABLE_LSAN" OFF
 )
 
+# Select the linker first, the IPO and hardening probes below must link with it
+include(${CMAKE_CURRENT_LIST_DIR}/impl/Linker.cmake)
+
 # Apply global hardening immediately if enabled
 if (ENABLE_GLOBAL_HARDENING)
     include(TargetHardening)
@@ -110,6 +190,12 @@ if (ENABLE_GLOBAL_IPO)
     enable_global_interprocedural_optimization()
 endif ()
 
+# Apply the global CPU level if requested
+if (MARCH)
+    include(TargetInstructionSets)
+    enable_global_march()
+endif ()
+
 # Apply global sanitizers if enabled
 if (ENABLE_GLOBAL_SANITIZERS)
     include(TargetSanitizers)
@@ -135,12 +221,26 @@ if (ENABLE_EDIT_AND_CONTINUE OR ENABLE_DEBUG_INFO)
 endif ()
 
 # Print configuration summary
+get_current_compiler(_summary_compiler INCLUDE_VERSION)
+message(STATUS "Toolchain: ${_summary_compiler} (quiet:${CONFIGURE_QUIET})")
 message(STATUS "Build type: ${CMAKE_BUILD_TYPE}")
 message(STATUS "C++ standard: ${CMAKE_CXX_STANDARD}")
 message(STATUS "DEV_MODE: ${DEV_MODE}")
 message(STATUS "RELEASE_MODE: ${RELEASE_MODE}")
 message(STATUS "Sanitizers: ${ENABLE_GLOBAL_SANITIZERS} (ASan:${ENABLE_ASAN}, UBSan:${ENABLE_UBSAN})")
-message(STATUS "Static analysis: ${ENABLE_GLOBAL_STATIC_ANALYSIS}")
-message(STATUS "Debug options: Edit&Continue:${ENABLE_EDIT_AND_CONTINUE}, DebugInfo:${ENABLE_DEBUG_INFO} (level:${DEBUG_INFO_LEVEL})")
+include(TargetHardening)
+get_hardening_level_overhead("${HARDENING_LEVEL}" HARDENING_OVERHEAD)
+message(STATUS "Hardening: ${ENABLE_GLOBAL_HARDENING} (level:${HARDENING_LEVEL}, expected overhead: ${HARDENING_OVERHEAD})")
+message(STATUS "Static analysis: ${ENABLE_GLOBAL_STATIC_ANALYSIS} (clang-tidy:${CLANG_TIDY_MODE})")
+message(STATUS "Debug options: Edit&Continue:${ENABLE_EDIT_AND_CONTINUE}, DebugInfo:${ENABLE_DEBUG_INFO} (level:${DEBUG_INFO_LEVEL}, format:${DEBUG_INFO_FORMAT})")
+message(STATUS "Profiler: ${ENABLE_PROFILER}")
 message(STATUS "Static linking: runtime:${ENABLE_STATIC_RUNTIME}")
+message(STATUS "Linker: ${LINKER_SELECTED} (requested:${LINKER})")
+message(STATUS "Allocator: ${ALLOCATOR}")
+message(STATUS "Lean binaries: ${LEAN_BINARIES} (ICF:${LEAN_ICF})")
+message(STATUS "IPO: ${ENABLE_GLOBAL_IPO} (mode:${IPO_LTO_MODE}, cache:${IPO_LTO_CACHE_DIR})")
+message(STATUS "PGO: ${PGO_MODE} (profiles:${PGO_PROFILE_DIR})")
+message(STATUS "BOLT: ${ENABLE_BOLT} (profile:${BOLT_PROFILE_MODE}, data:${BOLT_PROFILE_DIR})")
+message(STATUS "CPU level: ${MARCH}")
+message(STATUS "Build acceleration: PCH:${ENABLE_GLOBAL_PCH}, Unity:${ENABLE_GLOBAL_UNITY_BUILD} (batch:${GLOBAL_UNITY_BUILD_BATCH_SIZE}), Profiling:${ENABLE_BUILD_PROFILING}, import std:${ENABLE_IMPORT_STD}")
 message(STATUS "=== End of Configuration ===")
\ No newline at end of file
@@ -25,4 +25,15 @@ endif ()
 # Set to OLD to suppress the warning until CPM is updated
 if (POLICY CMP0169)
     cmake_policy(SET CMP0169 OLD)
-endif ()
\ No newline at end of file
+endif ()
+
+# import std is still experimental, its gate must be open before project() enables CXX (ENABLE_IMPORT_STD)
+if (ENABLE_IMPORT_STD AND NOT DEFINED CMAKE_EXPERIMENTAL_CXX_IMPORT_STD)
+    if (CMAKE_VERSION VERSION_GREATER_EQUAL 4.1)
+        set(CMAKE_EXPERIMENTAL_CXX_IMPORT_STD "d0edc3af-4c50-42ea-a356-e2862fe7a444")
+    elseif (CMAKE_VERSION VERSION_GREATER_EQUAL 4.0)
+        set(CMAKE_EXPERIMENTAL_CXX_IMPORT_STD "a9e1cf81-9932-4810-974b-6eccaf14e457")
+    elseif (CMAKE_VERSION VERSION_GREATER_EQUAL 3.30)
+        set(CMAKE_EXPERIMENTAL_CXX_IMPORT_STD "0e5b6991-d74f-4b3d-a41c-cf096e0b2508")
+    endif ()
+endif ()
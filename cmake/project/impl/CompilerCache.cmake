@@ -3,20 +3,146 @@ include_guard(DIRECTORY)
 #
 # Compiler cache support (ccache/sccache)
 #
+# COMPILER_CACHE:
+#   auto    - ccache if found, otherwise sccache
+#   ccache  - require ccache
+#   sccache - require sccache
+#   none    - no compiler launcher
+#
+# COMPILER_CACHE_REMOTE (optional):
+#   ccache  - remote storage URL (redis://, http://, file://...), needs ccache 4.4+
+#   sccache - s3://bucket[/prefix], gs://bucket[/prefix], redis://host[:port] or http(s):// (WebDAV)
+#
+# Sets COMPILER_CACHE_SELECTED to the chosen cache (ccache, sccache or none)
+#
+
+set(COMPILER_CACHE_SELECTED "none")
+
+string(TOLOWER "${COMPILER_CACHE}" _cache_request)
+if (NOT ENABLE_CCACHE OR _cache_request STREQUAL "")
+    set(_cache_request "none")
+endif ()
+if (NOT _cache_request MATCHES "^(auto|ccache|sccache|none)$")
+    message(FATAL_ERROR "Unknown COMPILER_CACHE '${COMPILER_CACHE}' (expected auto, ccache, sccache or none)")
+endif ()
 
-if (ENABLE_CCACHE)
+if (_cache_request MATCHES "^(auto|ccache)$")
     find_program(CCACHE_PROGRAM ccache)
+endif ()
+if (_cache_request MATCHES "^(auto|sccache)$")
     find_program(SCCACHE_PROGRAM sccache)
+endif ()
+
+set(_cache_launcher "")
+
+if (CCACHE_PROGRAM AND _cache_request MATCHES "^(auto|ccache)$")
+    message(STATUS "** ccache found: ${CCACHE_PROGRAM}")
+    set(COMPILER_CACHE_SELECTED "ccache")
+
+    # Relative paths below the source tree make hits portable across checkouts and build directories,
+    # the sloppiness lets PCH and __DATE__/__TIME__ users hit the cache at all
+    set(_cache_settings
+            "base_dir=${PROJECT_SOURCE_DIR}"
+            "hash_dir=false"
+            "sloppiness=pch_defines,time_macros,include_file_mtime,include_file_ctime"
+    )
+    if (COMPILER_CACHE_REMOTE)
+        list(APPEND _cache_settings "remote_storage=${COMPILER_CACHE_REMOTE}")
+    endif ()
 
-    if (CCACHE_PROGRAM)
-        message(STATUS "** ccache found: ${CCACHE_PROGRAM}")
-        set(CMAKE_CXX_COMPILER_LAUNCHER "${CCACHE_PROGRAM}")
-        set(CMAKE_C_COMPILER_LAUNCHER "${CCACHE_PROGRAM}")
-    elseif (SCCACHE_PROGRAM)
-        message(STATUS "** sccache found: ${SCCACHE_PROGRAM}")
-        set(CMAKE_CXX_COMPILER_LAUNCHER "${SCCACHE_PROGRAM}")
-        set(CMAKE_C_COMPILER_LAUNCHER "${SCCACHE_PROGRAM}")
+    execute_process(
+            COMMAND "${CCACHE_PROGRAM}" --version
+            OUTPUT_VARIABLE _ccache_version_output
+            ERROR_QUIET
+    )
+    string(REGEX MATCH "version ([0-9]+\\.[0-9]+)" _ccache_version "${_ccache_version_output}")
+    set(_ccache_version "${CMAKE_MATCH_1}")
+
+    if (_ccache_version VERSION_GREATER_EQUAL 4.8)
+        # ccache 4.8+ takes settings on the command line, no wrapper process per compile
+        set(_cache_launcher "${CCACHE_PROGRAM}" ${_cache_settings})
     else ()
-        message(STATUS "** No compiler cache found (ccache/sccache)")
+        # Older releases only read the environment, whose names don't all follow the setting names
+        set(_cache_env "")
+        foreach (_setting ${_cache_settings})
+            string(REGEX REPLACE "^([a-z_]+)=(.*)$" "\\1;\\2" _setting "${_setting}")
+            list(GET _setting 0 _key)
+            list(GET _setting 1 _value)
+            if (_key STREQUAL "base_dir")
+                list(APPEND _cache_env "CCACHE_BASEDIR=${_value}")
+            elseif (_key STREQUAL "hash_dir" AND NOT _value)
+                list(APPEND _cache_env "CCACHE_NOHASHDIR=1")
+            elseif (_key STREQUAL "sloppiness")
+                list(APPEND _cache_env "CCACHE_SLOPPINESS=${_value}")
+            elseif (_key STREQUAL "remote_storage")
+                list(APPEND _cache_env "CCACHE_REMOTE_STORAGE=${_value}")
+            endif ()
+        endforeach ()
+        set(_cache_launcher "${CMAKE_COMMAND}" -E env ${_cache_env} "${CCACHE_PROGRAM}")
+    endif ()
+    set(_cache_stats_commands
+            COMMAND "${CCACHE_PROGRAM}" --show-stats
+            COMMAND "${CCACHE_PROGRAM}" --zero-stats
+    )
+
+elseif (SCCACHE_PROGRAM AND _cache_request MATCHES "^(auto|sccache)$")
+    message(STATUS "** sccache found: ${SCCACHE_PROGRAM}")
+    set(COMPILER_CACHE_SELECTED "sccache")
+
+    # Path normalisation for cross-checkout hits, ignored by sccache releases without basedir support
+    set(_cache_env "SCCACHE_BASEDIRS=${PROJECT_SOURCE_DIR}")
+    if (COMPILER_CACHE_REMOTE MATCHES "^s3://([^/]+)/?(.*)$")
+        list(APPEND _cache_env "SCCACHE_BUCKET=${CMAKE_MATCH_1}")
+        if (CMAKE_MATCH_2)
+            list(APPEND _cache_env "SCCACHE_S3_KEY_PREFIX=${CMAKE_MATCH_2}")
+        endif ()
+    elseif (COMPILER_CACHE_REMOTE MATCHES "^gs://([^/]+)/?(.*)$")
+        list(APPEND _cache_env "SCCACHE_GCS_BUCKET=${CMAKE_MATCH_1}" "SCCACHE_GCS_RW_MODE=READ_WRITE")
+        if (CMAKE_MATCH_2)
+            list(APPEND _cache_env "SCCACHE_GCS_KEY_PREFIX=${CMAKE_MATCH_2}")
+        endif ()
+    elseif (COMPILER_CACHE_REMOTE MATCHES "^rediss?://")
+        list(APPEND _cache_env "SCCACHE_REDIS_ENDPOINT=${COMPILER_CACHE_REMOTE}")
+    elseif (COMPILER_CACHE_REMOTE MATCHES "^https?://")
+        list(APPEND _cache_env "SCCACHE_WEBDAV_ENDPOINT=${COMPILER_CACHE_REMOTE}")
+    elseif (COMPILER_CACHE_REMOTE)
+        message(FATAL_ERROR "COMPILER_CACHE_REMOTE '${COMPILER_CACHE_REMOTE}' is not a supported sccache backend (s3://, gs://, redis://, http(s)://)")
+    endif ()
+
+    # sccache reads its configuration when the server starts, which happens on the first compile
+    set(_cache_launcher "${CMAKE_COMMAND}" -E env ${_cache_env} "${SCCACHE_PROGRAM}")
+    set(_cache_stats_commands
+            COMMAND "${SCCACHE_PROGRAM}" --show-stats
+            COMMAND "${SCCACHE_PROGRAM}" --zero-stats
+    )
+
+elseif (_cache_request MATCHES "^(ccache|sccache)$")
+    message(FATAL_ERROR "COMPILER_CACHE=${_cache_request} requested but '${_cache_request}' was not found")
+elseif (_cache_request STREQUAL "auto")
+    message(STATUS "** No compiler cache found (ccache/sccache)")
+endif ()
+
+if (_cache_launcher)
+    set(CMAKE_CXX_COMPILER_LAUNCHER ${_cache_launcher})
+    set(CMAKE_C_COMPILER_LAUNCHER ${_cache_launcher})
+    if (COMPILER_CACHE_REMOTE)
+        message(STATUS "** Compiler cache remote: ${COMPILER_CACHE_REMOTE}")
+    endif ()
+
+    # Print and reset hit/miss counters, so CI can trend the hit rate per build
+    if (NOT TARGET cache-stats)
+        add_custom_target(cache-stats
+                ${_cache_stats_commands}
+                COMMENT "Compiler cache (${COMPILER_CACHE_SELECTED}) statistics"
+                VERBATIM
+        )
     endif ()
 endif ()
+
+unset(_cache_env)
+unset(_cache_launcher)
+unset(_cache_request)
+unset(_cache_settings)
+unset(_cache_stats_commands)
+unset(_ccache_version)
+unset(_ccache_version_output)
@@ -0,0 +1,108 @@
+include_guard(DIRECTORY)
+include(CheckLinkerFlag)
+include(GetCurrentCompiler)
+
+#
+# Fast linker selection (mold/lld/gold)
+#
+# LINKER:
+#   auto    - first working linker of mold, lld, gold (system default on Apple and Emscripten)
+#   mold    - require mold
+#   lld     - require lld (lld-link for MSVC/clang-cl)
+#   gold    - require gold
+#   default - keep the toolchain default
+#
+# Sets LINKER_SELECTED to the chosen linker and LINKER_SELECTED_FLAG to the -fuse-ld= flag (empty with CMAKE_LINKER_TYPE)
+#
+
+set(LINKER_SELECTED "default")
+set(LINKER_SELECTED_FLAG "")
+
+string(TOLOWER "${LINKER}" _linker_request)
+if (_linker_request STREQUAL "")
+    set(_linker_request "default")
+endif ()
+if (NOT _linker_request MATCHES "^(auto|mold|lld|gold|default)$")
+    message(FATAL_ERROR "Unknown LINKER '${LINKER}' (expected auto, mold, lld, gold or default)")
+endif ()
+
+get_current_compiler(_linker_compiler)
+
+# gold cannot load the LLVM ThinLTO plugin pipeline reliably. Only global IPO is known here, targets enabling
+# IPO on their own are checked against the selected linker by target_enable_interprocedural_optimization()
+string(TOLOWER "${IPO_LTO_MODE}" _linker_lto_mode)
+set(_linker_thinlto OFF)
+if (ENABLE_GLOBAL_IPO AND "${_linker_compiler}" MATCHES "^CLANG" AND NOT _linker_lto_mode STREQUAL "full")
+    set(_linker_thinlto ON)
+endif ()
+if (_linker_request STREQUAL "gold" AND _linker_thinlto)
+    message(FATAL_ERROR "LINKER=gold is incompatible with ThinLTO, use LINKER=lld/mold or IPO_LTO_MODE=full")
+endif ()
+
+if (_linker_request STREQUAL "auto")
+    if (APPLE OR "${_linker_compiler}" STREQUAL "EMSCRIPTEN")
+        set(_linker_candidates "")
+    elseif ("${_linker_compiler}" MATCHES "MSVC")
+        set(_linker_candidates lld)
+    elseif (_linker_thinlto)
+        set(_linker_candidates mold lld)
+    else ()
+        set(_linker_candidates mold lld gold)
+    endif ()
+elseif (_linker_request STREQUAL "default")
+    set(_linker_candidates "")
+else ()
+    set(_linker_candidates ${_linker_request})
+endif ()
+
+foreach (_linker ${_linker_candidates})
+    string(TOUPPER "${_linker}" _linker_upper)
+
+    if ("${_linker_compiler}" MATCHES "MSVC")
+        # MSVC and clang-cl drive the linker directly, swap link.exe for lld-link
+        find_program(LLD_LINK_PROGRAM lld-link)
+        if (NOT LLD_LINK_PROGRAM)
+            continue()
+        endif ()
+        if (CMAKE_VERSION VERSION_GREATER_EQUAL 3.29)
+            set(CMAKE_LINKER_TYPE LLD)
+        else ()
+            set(CMAKE_LINKER "${LLD_LINK_PROGRAM}")
+        endif ()
+        set(LINKER_SELECTED lld)
+        break()
+    endif ()
+
+    check_linker_flag(CXX "-fuse-ld=${_linker}" LINKER_SUPPORTS_${_linker_upper})
+    if (NOT LINKER_SUPPORTS_${_linker_upper})
+        continue()
+    endif ()
+
+    if (CMAKE_VERSION VERSION_GREATER_EQUAL 3.29)
+        set(CMAKE_LINKER_TYPE ${_linker_upper})
+    else ()
+        add_link_options(-fuse-ld=${_linker})
+    endif ()
+    # Probes (check_linker_flag) run outside the targets, they need the flag explicitly
+    set(LINKER_SELECTED_FLAG "-fuse-ld=${_linker}")
+    set(LINKER_SELECTED ${_linker})
+    break()
+endforeach ()
+
+if (NOT _linker_request MATCHES "^(auto|default)$" AND NOT LINKER_SELECTED STREQUAL _linker_request)
+    message(FATAL_ERROR "LINKER=${_linker_request} requested but it is not usable with ${CMAKE_CXX_COMPILER_ID}")
+endif ()
+
+if (LINKER_SELECTED STREQUAL "default")
+    message(STATUS "** Using the toolchain default linker")
+else ()
+    message(STATUS "** Using the ${LINKER_SELECTED} linker")
+endif ()
+
+unset(_linker)
+unset(_linker_upper)
+unset(_linker_candidates)
+unset(_linker_compiler)
+unset(_linker_request)
+unset(_linker_thinlto)
+unset(_linker_lto_mode)
@@ -0,0 +1,111 @@
+#
+# Asset download and verification, shared by target_register_asset() at configure time
+# and by the <target>_assets build step, which runs this file with cmake -P:
+#
+#   cmake -DASSET_FILE=<path> -DASSET_URL=<url> [-DASSET_HASH=<ALGO=value>] -DASSET_RECORD=<path>
+#         -DASSET_DESTINATION=<path> -DASSET_STAMP=<path> [-DASSET_REQUIRED=ON] -P AssetFetch.cmake
+#
+
+# Helper function to describe FILE for the hash check records: expected hash, size and modification time
+function(_asset_fingerprint FILE HASH RESULT_VAR)
+    file(SIZE "${FILE}" _size)
+    file(TIMESTAMP "${FILE}" _mtime "%s" UTC)
+    set(${RESULT_VAR} "${HASH}|${_size}|${_mtime}" PARENT_SCOPE)
+endfunction()
+
+# Helper function to check FILE against HASH (ALGO=value).
+# RECORD keeps the fingerprint of the last successful check, an unchanged file is not hashed again.
+function(_asset_verify_hash FILE HASH RECORD RESULT_VAR)
+    set(${RESULT_VAR} FALSE PARENT_SCOPE)
+    if (NOT EXISTS "${FILE}" OR NOT HASH MATCHES "^([^=]+)=(.+)$")
+        return()
+    endif ()
+    string(TOUPPER "${CMAKE_MATCH_1}" _algorithm)
+    string(TOLOWER "${CMAKE_MATCH_2}" _expected)
+
+    _asset_fingerprint("${FILE}" "${HASH}" _fingerprint)
+    if (EXISTS "${RECORD}")
+        file(READ "${RECORD}" _recorded)
+        if (_recorded STREQUAL _fingerprint)
+            set(${RESULT_VAR} TRUE PARENT_SCOPE)
+            return()
+        endif ()
+    endif ()
+
+    file(${_algorithm} "${FILE}" _actual)
+    if (_actual STREQUAL _expected)
+        file(WRITE "${RECORD}" "${_fingerprint}")
+        set(${RESULT_VAR} TRUE PARENT_SCOPE)
+    endif ()
+endfunction()
+
+# Helper function to make sure FILE exists (and matches HASH when given), downloading it from URL otherwise.
+# Downloads go to a temporary file first, build trees sharing ASSET_CACHE_DIR may fetch the same asset at once.
+function(_asset_fetch FILE URL HASH RECORD RESULT_VAR ERROR_VAR)
+    set(${RESULT_VAR} TRUE PARENT_SCOPE)
+    set(${ERROR_VAR} "" PARENT_SCOPE)
+
+    if (HASH)
+        _asset_verify_hash("${FILE}" "${HASH}" "${RECORD}" _verified)
+        if (_verified)
+            return()
+        endif ()
+        if (EXISTS "${FILE}")
+            message(STATUS "Asset '${FILE}' hash mismatch (expected: ${HASH}), will re-download")
+        endif ()
+    elseif (EXISTS "${FILE}")
+        return()
+    endif ()
+
+    message(STATUS "Downloading asset '${FILE}' from: ${URL}")
+    get_filename_component(_dir "${FILE}" DIRECTORY)
+    file(MAKE_DIRECTORY "${_dir}")
+
+    string(RANDOM LENGTH 8 _suffix)
+    set(_download "${FILE}.download-${_suffix}")
+    set(_expected_hash "")
+    if (HASH)
+        set(_expected_hash EXPECTED_HASH "${HASH}")
+    endif ()
+    file(DOWNLOAD "${URL}" "${_download}"
+            ${_expected_hash}
+            STATUS _status
+            LOG _log
+    )
+
+    list(GET _status 0 _error)
+    if (_error)
+        list(GET _status 1 _error_message)
+        file(REMOVE "${_download}")
+        set(${RESULT_VAR} FALSE PARENT_SCOPE)
+        set(${ERROR_VAR} "${_error_message}\nLog: ${_log}" PARENT_SCOPE)
+        return()
+    endif ()
+
+    file(RENAME "${_download}" "${FILE}")
+    if (HASH)
+        # file(DOWNLOAD) already checked the hash
+        _asset_fingerprint("${FILE}" "${HASH}" _fingerprint)
+        file(WRITE "${RECORD}" "${_fingerprint}")
+    endif ()
+    message(STATUS "Successfully downloaded: ${FILE}")
+endfunction()
+
+#
+
+if (CMAKE_SCRIPT_MODE_FILE STREQUAL CMAKE_CURRENT_LIST_FILE)
+    _asset_fetch("${ASSET_FILE}" "${ASSET_URL}" "${ASSET_HASH}" "${ASSET_RECORD}" _fetched _error)
+    if (NOT _fetched)
+        if (ASSET_REQUIRED)
+            message(FATAL_ERROR "Failed to download asset '${ASSET_FILE}': ${_error}")
+        endif ()
+        # No stamp, the next build tries again
+        message(WARNING "Failed to download asset '${ASSET_FILE}': ${_error}")
+        return()
+    endif ()
+
+    get_filename_component(_destination_dir "${ASSET_DESTINATION}" DIRECTORY)
+    file(MAKE_DIRECTORY "${_destination_dir}")
+    file(COPY_FILE "${ASSET_FILE}" "${ASSET_DESTINATION}" ONLY_IF_DIFFERENT)
+    file(TOUCH "${ASSET_STAMP}")
+endif ()
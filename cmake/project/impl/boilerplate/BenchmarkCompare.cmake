@@ -0,0 +1,202 @@
+#
+# Compares benchmark results against a stored baseline, run by the benchmark-compare and benchmark-baseline targets:
+#
+#   cmake -DRESULTS_DIR=<dir> -DBASELINE_DIR=<dir> [-DTHRESHOLD=<percent>] [-DUPDATE_BASELINE=ON] -P BenchmarkCompare.cmake
+#
+# Reads Google Benchmark (--benchmark_out_format=json) and nanobench (templates::json()) results.
+# Medians are compared when a result holds aggregates (--benchmark_repetitions), single runs otherwise.
+# Fails when a benchmark got slower than its baseline by more than THRESHOLD percent.
+#
+
+# Helper function to convert a JSON number in a unit of 10^UNIT_EXPONENT seconds to integer picoseconds.
+# CMake math() is integer only, so the decimal digits are shifted instead of multiplied.
+function(_benchmark_to_picoseconds VALUE UNIT_EXPONENT RESULT_VAR)
+    if (NOT VALUE MATCHES "^([0-9]*)(\\.([0-9]*))?([eE]([+-]?[0-9]+))?$")
+        set(${RESULT_VAR} "" PARENT_SCOPE)
+        return()
+    endif ()
+    set(_digits "${CMAKE_MATCH_1}${CMAKE_MATCH_3}")
+    string(LENGTH "${CMAKE_MATCH_3}" _fraction_length)
+    set(_exponent 0)
+    if (CMAKE_MATCH_5)
+        set(_exponent ${CMAKE_MATCH_5})
+    endif ()
+    math(EXPR _exponent "${_exponent} - ${_fraction_length} + ${UNIT_EXPONENT} + 12")
+
+    # 15 significant digits are plenty and keep the result in 64 bits
+    string(REGEX REPLACE "^0+" "" _digits "${_digits}")
+    string(LENGTH "${_digits}" _length)
+    if (_length GREATER 15)
+        math(EXPR _exponent "${_exponent} + ${_length} - 15")
+        string(SUBSTRING "${_digits}" 0 15 _digits)
+        set(_length 15)
+    endif ()
+
+    if (_length EQUAL 0)
+        set(_digits 0)
+    elseif (_exponent GREATER_EQUAL 0)
+        if (_exponent GREATER 18)
+            set(_exponent 18)
+        endif ()
+        string(REPEAT "0" ${_exponent} _zeros)
+        string(APPEND _digits "${_zeros}")
+    else ()
+        # Rounded, JSON writers print 1e-07 as 9.9999999999999995e-08
+        math(EXPR _keep "${_length} + ${_exponent}")
+        if (_keep LESS 0)
+            set(_digits 0)
+        else ()
+            string(SUBSTRING "${_digits}" ${_keep} 1 _next)
+            if (_keep EQUAL 0)
+                set(_digits 0)
+            else ()
+                string(SUBSTRING "${_digits}" 0 ${_keep} _digits)
+            endif ()
+            if (_next GREATER_EQUAL 5)
+                math(EXPR _digits "${_digits} + 1")
+            endif ()
+        endif ()
+    endif ()
+
+    math(EXPR _digits "${_digits}")
+    set(${RESULT_VAR} ${_digits} PARENT_SCOPE)
+endfunction()
+
+# Helper function to read the results of FILE as a list of <name>=<picoseconds>
+function(_benchmark_read_results FILE RESULT_VAR)
+    file(READ "${FILE}" _json)
+    set(_single "")
+    set(_medians "")
+
+    string(JSON _count ERROR_VARIABLE _error LENGTH "${_json}" benchmarks)
+    if (NOT _error AND _count GREATER 0)
+        # Google Benchmark
+        set(_exponents ns -9 us -6 ms -3 s 0)
+        math(EXPR _last "${_count} - 1")
+        foreach (_index RANGE ${_last})
+            string(JSON _entry GET "${_json}" benchmarks ${_index})
+            string(JSON _name ERROR_VARIABLE _error GET "${_entry}" run_name)
+            if (_error)
+                string(JSON _name GET "${_entry}" name)
+            endif ()
+            string(JSON _time GET "${_entry}" real_time)
+            string(JSON _unit ERROR_VARIABLE _error GET "${_entry}" time_unit)
+            if (_error)
+                set(_unit ns)
+            endif ()
+            list(FIND _exponents ${_unit} _unit_index)
+            math(EXPR _unit_index "${_unit_index} + 1")
+            list(GET _exponents ${_unit_index} _exponent)
+            _benchmark_to_picoseconds("${_time}" ${_exponent} _ps)
+
+            string(JSON _run_type ERROR_VARIABLE _error GET "${_entry}" run_type)
+            string(JSON _aggregate ERROR_VARIABLE _error GET "${_entry}" aggregate_name)
+            if (_run_type STREQUAL "aggregate")
+                if (_aggregate STREQUAL "median")
+                    list(APPEND _medians "${_name}=${_ps}")
+                endif ()
+            else ()
+                list(APPEND _single "${_name}=${_ps}")
+            endif ()
+        endforeach ()
+    elseif (_error)
+        # nanobench, elapsed times are in seconds
+        string(JSON _count ERROR_VARIABLE _error LENGTH "${_json}" results)
+        if (_error)
+            message(WARNING "${FILE}: not a Google Benchmark or nanobench JSON result")
+        elseif (_count GREATER 0)
+            math(EXPR _last "${_count} - 1")
+            foreach (_index RANGE ${_last})
+                string(JSON _name GET "${_json}" results ${_index} name)
+                string(JSON _time GET "${_json}" results ${_index} "median(elapsed)")
+                _benchmark_to_picoseconds("${_time}" 0 _ps)
+                list(APPEND _medians "${_name}=${_ps}")
+            endforeach ()
+        endif ()
+    endif ()
+
+    if (_medians)
+        set(${RESULT_VAR} "${_medians}" PARENT_SCOPE)
+    else ()
+        set(${RESULT_VAR} "${_single}" PARENT_SCOPE)
+    endif ()
+endfunction()
+
+# Helper function to format picoseconds for the report
+function(_benchmark_format_time PICOSECONDS RESULT_VAR)
+    math(EXPR _ns "${PICOSECONDS} / 1000")
+    math(EXPR _fraction "(${PICOSECONDS} % 1000) / 10")
+    if (_fraction LESS 10)
+        set(_fraction "0${_fraction}")
+    endif ()
+    set(${RESULT_VAR} "${_ns}.${_fraction} ns" PARENT_SCOPE)
+endfunction()
+
+#
+
+file(GLOB _results LIST_DIRECTORIES false "${RESULTS_DIR}/*.json")
+if (NOT _results)
+    message(FATAL_ERROR "No benchmark results in ${RESULTS_DIR}, run ctest -L benchmark first")
+endif ()
+
+if (UPDATE_BASELINE)
+    file(MAKE_DIRECTORY "${BASELINE_DIR}")
+    file(COPY ${_results} DESTINATION "${BASELINE_DIR}")
+    message(STATUS "Benchmark baseline updated in ${BASELINE_DIR}")
+    return()
+endif ()
+
+if (NOT THRESHOLD MATCHES "^[0-9]+$")
+    message(FATAL_ERROR "BENCHMARK_REGRESSION_THRESHOLD must be a whole percentage, got '${THRESHOLD}'")
+endif ()
+
+set(_regressions "")
+foreach (_result ${_results})
+    get_filename_component(_file_name "${_result}" NAME)
+    get_filename_component(_suite "${_result}" NAME_WE)
+    if (NOT EXISTS "${BASELINE_DIR}/${_file_name}")
+        message(STATUS "${_suite}: no baseline, skipped")
+        continue()
+    endif ()
+
+    _benchmark_read_results("${_result}" _current)
+    _benchmark_read_results("${BASELINE_DIR}/${_file_name}" _baseline)
+
+    foreach (_entry ${_current})
+        string(REGEX MATCH "^(.*)=([0-9]+)$" _match "${_entry}")
+        set(_name "${CMAKE_MATCH_1}")
+        set(_time "${CMAKE_MATCH_2}")
+
+        set(_base_time "")
+        foreach (_base_entry ${_baseline})
+            string(REGEX MATCH "^(.*)=([0-9]+)$" _match "${_base_entry}")
+            if (CMAKE_MATCH_1 STREQUAL _name)
+                set(_base_time "${CMAKE_MATCH_2}")
+                break()
+            endif ()
+        endforeach ()
+        if (_base_time STREQUAL "" OR _base_time EQUAL 0)
+            message(STATUS "${_suite}/${_name}: no baseline, skipped")
+            continue()
+        endif ()
+
+        _benchmark_format_time(${_time} _time_text)
+        _benchmark_format_time(${_base_time} _base_text)
+        math(EXPR _change "(${_time} - ${_base_time}) * 100 / ${_base_time}")
+        set(_line "${_suite}/${_name}: ${_time_text} (baseline ${_base_text}, ${_change}%)")
+
+        math(EXPR _limit "${_base_time} * (100 + ${THRESHOLD}) / 100")
+        if (_time GREATER _limit)
+            list(APPEND _regressions "${_line}")
+            message(STATUS "REGRESSION ${_line}")
+        else ()
+            message(STATUS "ok ${_line}")
+        endif ()
+    endforeach ()
+endforeach ()
+
+if (_regressions)
+    list(LENGTH _regressions _count)
+    string(REPLACE ";" "\n  " _regressions "${_regressions}")
+    message(FATAL_ERROR "${_count} benchmark(s) regressed by more than ${THRESHOLD}%:\n  ${_regressions}")
+endif ()
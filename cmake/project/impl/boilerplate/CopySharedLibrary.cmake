@@ -1,84 +1,31 @@
 include_guard(DIRECTORY)
 include(CMakePackageConfigHelpers)
     include(GetCurrentCompiler)
+include(TargetDependencyClosure)
+include(TargetRuntimeDependencies)
 
 # Helper function to copy shared library dependencies to build directory for direct execution
 function(_copy_shared_library_dependencies_to_build_dir TARGET_NAME)
-    # Get the target's link libraries
-    get_target_property(TARGET_LINK_LIBS ${TARGET_NAME} LINK_LIBRARIES)
-    if (NOT TARGET_LINK_LIBS)
-        return()
-    endif ()
+    get_target_dependency_closure(${TARGET_NAME} _dependencies)
 
-    # Process each linked library
-    foreach (LIB ${TARGET_LINK_LIBS})
-        if (TARGET ${LIB})
-            get_target_property(LIB_TYPE ${LIB} TYPE)
+    set(_shared_dependencies "")
+    foreach (LIB ${_dependencies})
+        get_target_property(LIB_TYPE ${LIB} TYPE)
+        get_target_property(LIB_IMPORTED ${LIB} IMPORTED)
 
-            # Ensure build order dependency for all target types
+        # Ensure build order dependency for all target types
+        if (NOT LIB_IMPORTED)
             add_dependencies(${TARGET_NAME} ${LIB})
-
-            # Copy shared libraries to target directory for direct execution
-            if (LIB_TYPE STREQUAL "SHARED_LIBRARY")
-                # Add a post-build step to copy the shared library to the target's directory
-                add_custom_command(TARGET ${TARGET_NAME} POST_BUILD
-                        COMMAND ${CMAKE_COMMAND} -E copy_if_different
-                        "$<TARGET_FILE:${LIB}>"
-                        "$<TARGET_FILE_DIR:${TARGET_NAME}>/"
-                        COMMENT "Copying shared library ${LIB} for ${TARGET_NAME}"
-                        VERBATIM
-                )
-
-                message(STATUS "** Will copy shared library ${LIB} to build directory for ${TARGET_NAME}")
-            endif ()
-
-            # Recursively handle dependencies of this library
-            _copy_shared_library_dependencies_to_build_dir_recursive(${TARGET_NAME} ${LIB})
         endif ()
-    endforeach ()
-endfunction()
-
-# Helper function to recursively handle dependencies
-function(_copy_shared_library_dependencies_to_build_dir_recursive MAIN_TARGET LIB_TARGET)
-    get_target_property(LIB_LINK_LIBS ${LIB_TARGET} LINK_LIBRARIES)
-    if (NOT LIB_LINK_LIBS)
-        return()
-    endif ()
-
-    foreach (NESTED_LIB ${LIB_LINK_LIBS})
-        if (TARGET ${NESTED_LIB})
-            get_target_property(NESTED_LIB_TYPE ${NESTED_LIB} TYPE)
-
-            # Ensure build order dependency
-            add_dependencies(${MAIN_TARGET} ${NESTED_LIB})
-
-            # Copy shared libraries
-            if (NESTED_LIB_TYPE STREQUAL "SHARED_LIBRARY")
-                add_custom_command(TARGET ${MAIN_TARGET} POST_BUILD
-                        COMMAND ${CMAKE_COMMAND} -E copy_if_different
-                        "$<TARGET_FILE:${NESTED_LIB}>"
-                        "$<TARGET_FILE_DIR:${MAIN_TARGET}>/"
-                        COMMENT "Copying transitive shared library ${NESTED_LIB} for ${MAIN_TARGET}"
-                        VERBATIM
-                )
 
-                message(STATUS "** Will copy transitive shared library ${NESTED_LIB} to build directory for ${MAIN_TARGET}")
-            endif ()
-
-            # Continue recursively (with depth limit to avoid infinite loops)
-            get_target_property(PROCESSED ${MAIN_TARGET} _PROCESSED_DEPS)
-            if (NOT PROCESSED)
-                set_target_properties(${MAIN_TARGET} PROPERTIES _PROCESSED_DEPS "")
-                set(PROCESSED "")
-            endif ()
-
-            if (NOT "${NESTED_LIB}" IN_LIST PROCESSED)
-                list(APPEND PROCESSED ${NESTED_LIB})
-                set_target_properties(${MAIN_TARGET} PROPERTIES _PROCESSED_DEPS "${PROCESSED}")
-                _copy_shared_library_dependencies_to_build_dir_recursive(${MAIN_TARGET} ${NESTED_LIB})
-            endif ()
+        if (LIB_TYPE STREQUAL "SHARED_LIBRARY")
+            list(APPEND _shared_dependencies ${LIB})
+            message(STATUS "** Will copy shared library ${LIB} to build directory for ${TARGET_NAME}")
         endif ()
     endforeach ()
+
+    # Copy shared libraries to target directory for direct execution
+    target_copy_runtime_dependencies(${TARGET_NAME} TARGETS ${_shared_dependencies})
 endfunction()
 
 # Helper function to copy AddressSanitizer runtime DLL to build directory for direct execution
@@ -100,24 +47,8 @@ function(_copy_asan_dll_to_build_dir TARGET_NAME)
     _find_asan_dll_path(ASAN_DLL_PATH)
 
     if (ASAN_DLL_PATH AND EXISTS "${ASAN_DLL_PATH}")
-        # Get the target's output directory
-        get_target_property(TARGET_OUTPUT_DIR ${TARGET_NAME} RUNTIME_OUTPUT_DIRECTORY)
-        if (NOT TARGET_OUTPUT_DIR)
-            set(TARGET_OUTPUT_DIR $<TARGET_FILE_DIR:${TARGET_NAME}>)
-        endif ()
-
-        # Normalize path for CMake (use forward slashes)
-        file(TO_CMAKE_PATH "${ASAN_DLL_PATH}" ASAN_DLL_CMAKE_PATH)
-        get_filename_component(ASAN_DLL_NAME "${ASAN_DLL_CMAKE_PATH}" NAME)
-
-        # Add a post-build step to copy the DLL to the target's output directory
-        add_custom_command(TARGET ${TARGET_NAME} POST_BUILD
-                COMMAND ${CMAKE_COMMAND} -E copy_if_different
-                "${ASAN_DLL_CMAKE_PATH}"
-                "$<TARGET_FILE_DIR:${TARGET_NAME}>/${ASAN_DLL_NAME}"
-                COMMENT "Copying AddressSanitizer runtime DLL for ${TARGET_NAME}"
-                VERBATIM
-        )
+        # Copy the DLL to the target's output directory, with the target's other runtime dependencies
+        target_copy_runtime_dependencies(${TARGET_NAME} FILES "${ASAN_DLL_PATH}")
 
         message(STATUS "** Will copy AddressSanitizer runtime DLL to build directory for ${TARGET_NAME}")
     else ()
@@ -127,6 +58,14 @@ endfunction()
 
 # Helper function to find AddressSanitizer DLL path (shared between install and build directory copying)
 function(_find_asan_dll_path OUTPUT_VAR)
+    # The search globs whole Visual Studio installations, do it once per configure
+    get_property(_searched GLOBAL PROPERTY _ASAN_DLL_PATH SET)
+    if (_searched)
+        get_property(ASAN_DLL_PATH GLOBAL PROPERTY _ASAN_DLL_PATH)
+        set(${OUTPUT_VAR} "${ASAN_DLL_PATH}" PARENT_SCOPE)
+        return()
+    endif ()
+
     # Determine architecture-specific DLL name
     if (CMAKE_SIZEOF_VOID_P EQUAL 8)
         set(ASAN_DLL_PATTERN "clang_rt.asan_dynamic-x86_64.dll")
@@ -220,6 +159,7 @@ function(_find_asan_dll_path OUTPUT_VAR)
         endforeach ()
     endif ()
 
+    set_property(GLOBAL PROPERTY _ASAN_DLL_PATH "${ASAN_DLL_PATH}")
     set(${OUTPUT_VAR} "${ASAN_DLL_PATH}" PARENT_SCOPE)
 endfunction()
 
@@ -468,69 +408,12 @@ endif()
     # Install the script to run after the main installation
     install(SCRIPT ${install_script_file} COMPONENT Runtime)
 
-    # Enhanced handling of TARGET_NAME dependencies to include transitive dependencies
-    get_target_property(target_link_libs ${TARGET_NAME} LINK_LIBRARIES)
-    if (target_link_libs)
-        # Function to collect all dependency targets recursively (including static libraries with shared deps)
-        function(collect_all_dependency_targets target_name visited_targets dependency_targets)
-            # Avoid infinite recursion
-            if (target_name IN_LIST visited_targets)
-                return()
-            endif ()
-            list(APPEND visited_targets ${target_name})
-
-            if (TARGET ${target_name})
-                get_target_property(target_type ${target_name} TYPE)
-
-                list(APPEND dependency_targets ${target_name})
-
-                # Recursively check this TARGET_NAME's dependencies
-                get_target_property(target_deps ${target_name} LINK_LIBRARIES)
-                if (target_deps)
-                    foreach (dep ${target_deps})
-                        collect_all_dependency_targets(${dep} \"${visited_targets}\" dependency_targets)
-                    endforeach ()
-                endif ()
-
-                # Also check interface link libraries for transitive dependencies
-                get_target_property(interface_deps ${target_name} INTERFACE_LINK_LIBRARIES)
-                if (interface_deps)
-                    foreach (dep ${interface_deps})
-                        if (TARGET ${dep})
-                            collect_all_dependency_targets(${dep} \"${visited_targets}\" dependency_targets)
-                        endif ()
-                    endforeach ()
-                endif ()
-            endif ()
-
-            # Propagate results back to parent scope
-            set(dependency_targets ${dependency_targets} PARENT_SCOPE)
-            set(visited_targets ${visited_targets} PARENT_SCOPE)
-        endfunction()
-
-        # Collect all dependency targets
-        set(all_dependency_targets \"\")
-        set(visited_list \"\")
-        foreach (lib ${target_link_libs})
-            collect_all_dependency_targets(${lib} \"${visited_list}\" all_dependency_targets)
-        endforeach ()
-
-        # Remove duplicates
-        if (all_dependency_targets)
-            list(REMOVE_DUPLICATES all_dependency_targets)
-        endif ()
-
-        # Install shared libraries for all dependency targets
-        foreach (dep_target ${all_dependency_targets})
-            if (TARGET ${dep_target})
-                get_target_property(dep_type ${dep_target} TYPE)
-                if (dep_type STREQUAL "SHARED_LIBRARY")
-                    install(FILES $<TARGET_FILE:${dep_target}>
-                            DESTINATION ${RUNTIME_DIR}
-                            COMPONENT Runtime
-                    )
-                endif ()
-            endif ()
-        endforeach ()
-    endif ()
+    # Install shared libraries for all dependency targets, including transitive ones
+    get_target_shared_dependencies(${TARGET_NAME} _shared_dependencies)
+    foreach (dep_target ${_shared_dependencies})
+        install(FILES $<TARGET_FILE:${dep_target}>
+                DESTINATION ${RUNTIME_DIR}
+                COMPONENT Runtime
+        )
+    endforeach ()
 endfunction()
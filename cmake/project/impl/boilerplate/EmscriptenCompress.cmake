@@ -0,0 +1,35 @@
+#
+# Precompresses the web output of a register_emscripten() target, run after each link:
+#
+#   cmake -DDIRECTORY=<dir> -DBASE_NAME=<name> -DFORMATS=gzip|brotli[|...] [-DBROTLI=<path>] -P EmscriptenCompress.cmake
+#
+# Writes <name>.wasm.gz / <name>.wasm.br (same for .js and the .data package) next to the originals,
+# for servers that send precompressed files (nginx gzip_static / brotli_static, the DEV_SERVER target, CDNs).
+#
+
+string(REPLACE "|" ";" FORMATS "${FORMATS}")
+list(FIND FORMATS gzip _gzip)
+list(FIND FORMATS brotli _brotli)
+
+foreach (_extension wasm js data)
+    set(_file "${DIRECTORY}/${BASE_NAME}.${_extension}")
+    if (NOT EXISTS "${_file}")
+        continue()
+    endif ()
+
+    if (_gzip GREATER -1)
+        # Written next to the output first, a browser must never see a truncated .gz
+        file(ARCHIVE_CREATE OUTPUT "${_file}.gz.tmp" PATHS "${_file}" FORMAT raw COMPRESSION GZip COMPRESSION_LEVEL 9)
+        file(RENAME "${_file}.gz.tmp" "${_file}.gz")
+    endif ()
+    if (_brotli GREATER -1 AND BROTLI)
+        execute_process(
+                COMMAND "${BROTLI}" --best --force --output=${_file}.br.tmp "${_file}"
+                RESULT_VARIABLE _result
+        )
+        if (NOT _result EQUAL 0)
+            message(FATAL_ERROR "brotli failed on ${_file}")
+        endif ()
+        file(RENAME "${_file}.br.tmp" "${_file}.br")
+    endif ()
+endforeach ()
@@ -1,4 +1,19 @@
 include_guard(DIRECTORY)
+include(GetUserCacheDirectory)
+include(${CMAKE_CURRENT_LIST_DIR}/AssetFetch.cmake)
+
+set(_ASSET_FETCH_SCRIPT "${CMAKE_CURRENT_LIST_DIR}/AssetFetch.cmake")
+
+option(ASSET_DEFER_DOWNLOAD "Download assets with a URL at build time, in parallel, instead of while configuring" OFF)
+
+# Downloaded assets with a HASH are stored by hash here, shared by every build tree
+if (DEFINED ENV{ASSET_CACHE_DIR})
+    set(_asset_cache_default "$ENV{ASSET_CACHE_DIR}")
+else ()
+    get_user_cache_directory(assets _asset_cache_default)
+endif ()
+set(ASSET_CACHE_DIR "${_asset_cache_default}" CACHE PATH "Hash-addressed cache for downloaded assets, empty keeps them in <source>/_assets")
+unset(_asset_cache_default)
 
 #
 # target_register_asset
@@ -14,9 +29,14 @@ include_guard(DIRECTORY)
 #     [DESTINATION relative/path] # relative path within target output directory
 #     [URL url_to_download_from] # URL to download the asset if missing or hash mismatch
 #     [HASH hash_algorithm=hash_value] # hash to verify file integrity (e.g., SHA256=abc123...)
+#                                      # With a HASH, downloads are stored in ASSET_CACHE_DIR/<algorithm>/<hash>/
 #     [REQUIRED] # fail build if asset cannot be found or downloaded
+#     [DEFER_DOWNLOAD] # download in the <target>_assets build step instead of while configuring (ASSET_DEFER_DOWNLOAD)
 #   )
 #
+# All assets of a target are copied by one <target>_assets target, each copy runs only when its source changed.
+# Hashes are only recomputed when the size or modification time of the file changed.
+#
 # Examples:
 #   # Copy cacert.pem to target output directory
 #   target_register_asset(target_name FILE cacert.pem)
@@ -34,7 +54,7 @@ include_guard(DIRECTORY)
 #   )
 #
 function(target_register_asset TARGET_NAME)
-    set(options REQUIRED)
+    set(options REQUIRED DEFER_DOWNLOAD)
     set(oneValueArgs FILE DESTINATION URL HASH)
     set(multiValueArgs)
 
@@ -55,9 +75,20 @@ function(target_register_asset TARGET_NAME)
         message(FATAL_ERROR "target_register_asset: Target '${TARGET_NAME}' does not exist")
     endif ()
 
+    if (ARG_HASH AND NOT ARG_HASH MATCHES "^([^=]+)=(.+)$")
+        message(WARNING "Invalid hash format for asset '${ARG_FILE}': ${ARG_HASH}")
+        unset(ARG_HASH)
+    endif ()
+
     # Resolve asset file path
     if (IS_ABSOLUTE "${ARG_FILE}")
         set(ASSET_SOURCE_PATH "${ARG_FILE}")
+    elseif (ARG_URL AND ARG_HASH AND ASSET_CACHE_DIR)
+        # Hash-addressed, so every build tree and project reuses the same download
+        string(REGEX MATCH "^([^=]+)=(.+)$" HASH_MATCH "${ARG_HASH}")
+        string(TOLOWER "${CMAKE_MATCH_1}/${CMAKE_MATCH_2}" HASH_PATH)
+        get_filename_component(ASSET_NAME "${ARG_FILE}" NAME)
+        set(ASSET_SOURCE_PATH "${ASSET_CACHE_DIR}/${HASH_PATH}/${ASSET_NAME}")
     else ()
         # Store downloaded assets in _assets directory
         if (ARG_URL)
@@ -67,6 +98,15 @@ function(target_register_asset TARGET_NAME)
         endif ()
     endif ()
 
+    # Where the last successful hash check is recorded, next to shared cache entries so other build trees see it
+    string(FIND "${ASSET_SOURCE_PATH}" "${ASSET_CACHE_DIR}/" CACHE_PREFIX_POS)
+    if (ASSET_CACHE_DIR AND CACHE_PREFIX_POS EQUAL 0)
+        set(ASSET_RECORD "${ASSET_SOURCE_PATH}.verified")
+    else ()
+        string(MD5 ASSET_PATH_HASH "${ASSET_SOURCE_PATH}")
+        set(ASSET_RECORD "${CMAKE_BINARY_DIR}/CMakeFiles/assets/${ASSET_PATH_HASH}.verified")
+    endif ()
+
     # Determine destination path
     if (ARG_DESTINATION)
         set(ASSET_DEST_RELATIVE "${ARG_DESTINATION}")
@@ -74,78 +114,29 @@ function(target_register_asset TARGET_NAME)
         get_filename_component(ASSET_DEST_RELATIVE "${ARG_FILE}" NAME)
     endif ()
 
-    # Generate unique target name for this asset
-    string(MAKE_C_IDENTIFIER "${TARGET_NAME}_asset_${ASSET_DEST_RELATIVE}" ASSET_TARGET_NAME)
-
-    # Check if we need to download/re-download the file
-    set(NEED_DOWNLOAD FALSE)
-
-    if (ARG_URL)
-        if (NOT EXISTS "${ASSET_SOURCE_PATH}")
-            message(STATUS "Asset '${ARG_FILE}' not found, will download from: ${ARG_URL}")
-            set(NEED_DOWNLOAD TRUE)
-        elseif (ARG_HASH)
-            # Check if existing file hash matches expected hash
-            string(REGEX MATCH "^([^=]+)=(.+)$" HASH_MATCH "${ARG_HASH}")
-            if (HASH_MATCH)
-                set(HASH_ALGORITHM "${CMAKE_MATCH_1}")
-                set(EXPECTED_HASH "${CMAKE_MATCH_2}")
-                file(${HASH_ALGORITHM} "${ASSET_SOURCE_PATH}" EXISTING_HASH)
-                if (NOT "${EXISTING_HASH}" STREQUAL "${EXPECTED_HASH}")
-                    message(STATUS "Asset '${ARG_FILE}' hash mismatch (expected: ${EXPECTED_HASH}, got: ${EXISTING_HASH}), will re-download")
-                    set(NEED_DOWNLOAD TRUE)
-                else ()
-                    message(STATUS "Asset '${ARG_FILE}' hash verified, no download needed")
-                endif ()
-            else ()
-                message(WARNING "Invalid hash format for asset '${ARG_FILE}': ${ARG_HASH}")
-            endif ()
-        endif ()
-
-        # Download the file if needed
-        if (NEED_DOWNLOAD)
-            message(STATUS "Downloading asset '${ARG_FILE}' from: ${ARG_URL}")
-
-            # Create directory if needed
-            get_filename_component(ASSET_DIR "${ASSET_SOURCE_PATH}" DIRECTORY)
-            file(MAKE_DIRECTORY "${ASSET_DIR}")
-
-            # Download the file
-            if (ARG_HASH)
-                file(DOWNLOAD
-                        "${ARG_URL}"
-                        "${ASSET_SOURCE_PATH}"
-                        EXPECTED_HASH "${ARG_HASH}"
-                        STATUS DOWNLOAD_STATUS
-                        LOG DOWNLOAD_LOG
-                )
-            else ()
-                file(DOWNLOAD
-                        "${ARG_URL}"
-                        "${ASSET_SOURCE_PATH}"
-                        STATUS DOWNLOAD_STATUS
-                        LOG DOWNLOAD_LOG
-                )
-            endif ()
+    set(DEFER_DOWNLOAD ${ASSET_DEFER_DOWNLOAD})
+    if (ARG_DEFER_DOWNLOAD)
+        set(DEFER_DOWNLOAD ON)
+    endif ()
+    if (NOT ARG_URL)
+        set(DEFER_DOWNLOAD OFF)
+    endif ()
 
-            # Check download status
-            list(GET DOWNLOAD_STATUS 0 DOWNLOAD_ERROR)
-            if (DOWNLOAD_ERROR)
-                list(GET DOWNLOAD_STATUS 1 DOWNLOAD_ERROR_MSG)
-                if (ARG_REQUIRED)
-                    message(FATAL_ERROR "Failed to download asset '${ARG_FILE}': ${DOWNLOAD_ERROR_MSG}\nLog: ${DOWNLOAD_LOG}")
-                else ()
-                    message(WARNING "Failed to download asset '${ARG_FILE}': ${DOWNLOAD_ERROR_MSG}")
-                    return()
-                endif ()
+    # Download the file now if needed
+    if (ARG_URL AND NOT DEFER_DOWNLOAD)
+        _asset_fetch("${ASSET_SOURCE_PATH}" "${ARG_URL}" "${ARG_HASH}" "${ASSET_RECORD}" DOWNLOADED DOWNLOAD_ERROR_MSG)
+        if (NOT DOWNLOADED)
+            if (ARG_REQUIRED)
+                message(FATAL_ERROR "Failed to download asset '${ARG_FILE}': ${DOWNLOAD_ERROR_MSG}")
             else ()
-                message(STATUS "Successfully downloaded: ${ARG_FILE}")
+                message(WARNING "Failed to download asset '${ARG_FILE}': ${DOWNLOAD_ERROR_MSG}")
+                return()
             endif ()
         endif ()
     endif ()
 
     # Check if asset exists after potential download
-    if (NOT EXISTS "${ASSET_SOURCE_PATH}")
+    if (NOT DEFER_DOWNLOAD AND NOT EXISTS "${ASSET_SOURCE_PATH}")
         if (ARG_REQUIRED)
             message(FATAL_ERROR "Required asset '${ARG_FILE}' not found at: ${ASSET_SOURCE_PATH}")
         else ()
@@ -154,24 +145,42 @@ function(target_register_asset TARGET_NAME)
         endif ()
     endif ()
 
-    # Create custom target to copy the asset
-    add_custom_target(${ASSET_TARGET_NAME}
-            COMMAND ${CMAKE_COMMAND} -E copy_if_different
-            "${ASSET_SOURCE_PATH}"
-            "$<TARGET_FILE_DIR:${TARGET_NAME}>/${ASSET_DEST_RELATIVE}"
-            DEPENDS "${ASSET_SOURCE_PATH}"
-            COMMENT "Copying asset: ${ARG_FILE} -> ${ASSET_DEST_RELATIVE}"
-    )
-
-    # Make the main target depend on the asset copy
-    add_dependencies(${TARGET_NAME} ${ASSET_TARGET_NAME})
+    # One copy rule per asset in the target's <target>_assets step, keyed by a stamp
+    _get_asset_target(${TARGET_NAME} ASSETS_TARGET_NAME)
+    string(MAKE_C_IDENTIFIER "${ASSET_DEST_RELATIVE}" ASSET_ID)
+    set(ASSET_STAMP "${CMAKE_CURRENT_BINARY_DIR}/CMakeFiles/${ASSETS_TARGET_NAME}.dir/${ASSET_ID}-$<CONFIG>.stamp")
+    set(ASSET_DEST "$<TARGET_FILE_DIR:${TARGET_NAME}>/${ASSET_DEST_RELATIVE}")
 
-    # Ensure destination directory exists
-    get_filename_component(DEST_DIR "$<TARGET_FILE_DIR:${TARGET_NAME}>/${ASSET_DEST_RELATIVE}" DIRECTORY)
-    add_custom_command(TARGET ${ASSET_TARGET_NAME} PRE_BUILD
-            COMMAND ${CMAKE_COMMAND} -E make_directory "${DEST_DIR}"
-            COMMENT "Creating asset directory: ${DEST_DIR}"
-    )
+    if (DEFER_DOWNLOAD)
+        add_custom_command(
+                OUTPUT "${ASSET_STAMP}"
+                COMMAND ${CMAKE_COMMAND}
+                "-DASSET_FILE=${ASSET_SOURCE_PATH}"
+                "-DASSET_URL=${ARG_URL}"
+                "-DASSET_HASH=${ARG_HASH}"
+                "-DASSET_RECORD=${ASSET_RECORD}"
+                "-DASSET_DESTINATION=${ASSET_DEST}"
+                "-DASSET_STAMP=${ASSET_STAMP}"
+                "-DASSET_REQUIRED=${ARG_REQUIRED}"
+                -P "${_ASSET_FETCH_SCRIPT}"
+                DEPENDS "${_ASSET_FETCH_SCRIPT}"
+                COMMENT "Fetching asset: ${ARG_FILE} -> ${ASSET_DEST_RELATIVE}"
+                VERBATIM
+        )
+    else ()
+        # Ensure destination directory exists
+        get_filename_component(DEST_DIR "${ASSET_DEST}" DIRECTORY)
+        add_custom_command(
+                OUTPUT "${ASSET_STAMP}"
+                COMMAND ${CMAKE_COMMAND} -E make_directory "${DEST_DIR}"
+                COMMAND ${CMAKE_COMMAND} -E copy_if_different "${ASSET_SOURCE_PATH}" "${ASSET_DEST}"
+                COMMAND ${CMAKE_COMMAND} -E touch "${ASSET_STAMP}"
+                DEPENDS "${ASSET_SOURCE_PATH}"
+                COMMENT "Copying asset: ${ARG_FILE} -> ${ASSET_DEST_RELATIVE}"
+                VERBATIM
+        )
+    endif ()
+    target_sources(${ASSETS_TARGET_NAME} PRIVATE "${ASSET_STAMP}")
 
     message(STATUS "Registered asset for target '${TARGET_NAME}': ${ARG_FILE} -> ${ASSET_DEST_RELATIVE}")
 endfunction()
@@ -184,12 +193,16 @@ endfunction()
 #     target_name
 #     [ASSETS asset1.txt path/to/asset2.png ...] # List of asset files
 #     [DESTINATION_PREFIX prefix/path] # prefix path for all assets in target output directory
+#     [BASE_URL url] # download each asset from <url>/<asset>
+#     [HASHES SHA256=... ...] # one hash per asset, in ASSETS order
+#     [REQUIRED] # fail build if an asset cannot be found or downloaded
+#     [DEFER_DOWNLOAD] # download in the <target>_assets build step, Ninja/Make fetch them in parallel
 #   )
 #
 function(target_register_assets TARGET_NAME)
-    set(options)
-    set(oneValueArgs DESTINATION_PREFIX)
-    set(multiValueArgs ASSETS)
+    set(options REQUIRED DEFER_DOWNLOAD)
+    set(oneValueArgs DESTINATION_PREFIX BASE_URL)
+    set(multiValueArgs ASSETS HASHES)
 
     cmake_parse_arguments(ARG "${options}" "${oneValueArgs}" "${multiValueArgs}" ${ARGN})
 
@@ -203,6 +216,22 @@ function(target_register_assets TARGET_NAME)
         message(FATAL_ERROR "target_register_assets: ASSETS list is required")
     endif ()
 
+    if (ARG_HASHES)
+        list(LENGTH ARG_ASSETS ASSET_COUNT)
+        list(LENGTH ARG_HASHES HASH_COUNT)
+        if (NOT ASSET_COUNT EQUAL HASH_COUNT)
+            message(FATAL_ERROR "target_register_assets: HASHES needs one entry per asset (${ASSET_COUNT} assets, ${HASH_COUNT} hashes)")
+        endif ()
+    endif ()
+
+    set(FORWARD_OPTIONS "")
+    foreach (OPTION REQUIRED DEFER_DOWNLOAD)
+        if (ARG_${OPTION})
+            list(APPEND FORWARD_OPTIONS ${OPTION})
+        endif ()
+    endforeach ()
+
+    set(ASSET_INDEX 0)
     foreach (FILE ${ARG_ASSETS})
         if (ARG_DESTINATION_PREFIX)
             get_filename_component(ASSET_NAME "${FILE}" NAME)
@@ -211,10 +240,45 @@ function(target_register_assets TARGET_NAME)
             set(DESTINATION "")
         endif ()
 
+        set(DOWNLOAD_ARGS "")
+        if (ARG_BASE_URL)
+            list(APPEND DOWNLOAD_ARGS URL "${ARG_BASE_URL}/${FILE}")
+        endif ()
+        if (ARG_HASHES)
+            list(GET ARG_HASHES ${ASSET_INDEX} ASSET_HASH)
+            list(APPEND DOWNLOAD_ARGS HASH "${ASSET_HASH}")
+        endif ()
+        math(EXPR ASSET_INDEX "${ASSET_INDEX} + 1")
+
         target_register_asset(
                 ${TARGET_NAME}
                 FILE "${FILE}"
                 DESTINATION "${DESTINATION}"
+                ${DOWNLOAD_ARGS}
+                ${FORWARD_OPTIONS}
         )
     endforeach ()
 endfunction()
+
+#
+
+# Helper function to get the custom target copying the assets of TARGET_NAME, created on first use.
+# Its custom commands must live in the calling directory, so other directories get their own step.
+function(_get_asset_target TARGET_NAME RESULT_VAR)
+    set(_name ${TARGET_NAME}_assets)
+    if (TARGET ${_name})
+        get_target_property(_dir ${_name} SOURCE_DIR)
+        if (NOT _dir STREQUAL CMAKE_CURRENT_SOURCE_DIR)
+            string(MD5 _suffix "${CMAKE_CURRENT_SOURCE_DIR}")
+            string(SUBSTRING "${_suffix}" 0 8 _suffix)
+            set(_name ${TARGET_NAME}_assets_${_suffix})
+        endif ()
+    endif ()
+
+    if (NOT TARGET ${_name})
+        add_custom_target(${_name})
+        add_dependencies(${TARGET_NAME} ${_name})
+    endif ()
+
+    set(${RESULT_VAR} ${_name} PARENT_SCOPE)
+endfunction()
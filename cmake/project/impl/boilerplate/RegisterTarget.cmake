@@ -1,11 +1,29 @@
 include_guard(DIRECTORY)
+include(GenerateExportHeader)
+include(TargetPrecompiledHeaders)
+include(TargetUnityBuild)
+include(TargetProfileGuidedOptimization)
+include(TargetBolt)
+include(TargetInstructionSets)
+include(TargetBuildProfiling)
+include(TargetTestImpact)
+include(TargetAllocator)
+include(TargetProfiler)
+include(TargetLeanBinaries)
+include(TargetCxxModules)
+include(ConfigureQuiet)
+include(ToolchainProfile)
 include(${CMAKE_CURRENT_LIST_DIR}/CopySharedLibrary.cmake)
 
+set(_BENCHMARK_COMPARE_SCRIPT "${CMAKE_CURRENT_LIST_DIR}/BenchmarkCompare.cmake")
+set(_EMSCRIPTEN_COMPRESS_SCRIPT "${CMAKE_CURRENT_LIST_DIR}/EmscriptenCompress.cmake")
+set(_TEST_SHARD_SCRIPT "${CMAKE_CURRENT_LIST_DIR}/TestShard.cmake")
+
 function(_register_target_common target)
     cmake_parse_arguments(PARSE_ARGV 1 ARG
             ""
-            "NAMESPACE;EXPORT_SET;INSTALL_DESTINATION;CXX_STANDARD"
-            "COMPILE_OPTIONS;COMPILE_DEFINITIONS;INCLUDE_DIRS;LINK_LIBS;PROPERTIES"
+            "NAMESPACE;EXPORT_SET;INSTALL_DESTINATION;CXX_STANDARD;ENABLE_PCH;REUSE_PCH_FROM;UNITY_BUILD;UNITY_BATCH_SIZE;BUILD_PROFILING;ENABLE_PGO;PGO_PROFILE_DIR;ENABLE_BOLT;MARCH;ALLOCATOR;PROFILER;LEAN_BINARIES;IMPORT_STD"
+            "COMPILE_OPTIONS;COMPILE_DEFINITIONS;INCLUDE_DIRS;LINK_LIBS;PROPERTIES;PRECOMPILE_HEADERS;UNITY_EXCLUDE;TARGET_ISAS;ISA_SOURCES"
     )
 
     if (DEFINED ARG_CXX_STANDARD)
@@ -52,14 +70,101 @@ function(_register_target_common target)
         endforeach ()
     endif ()
 
+    # malloc replacement (ALLOCATOR), linked ahead of the other libraries
+    get_target_property(_type ${target} TYPE)
+    if (_type STREQUAL "EXECUTABLE")
+        set(_allocator_args)
+        if (DEFINED ARG_ALLOCATOR)
+            list(APPEND _allocator_args ALLOCATOR ${ARG_ALLOCATOR})
+        endif ()
+        target_use_allocator(${target} ${_allocator_args})
+    endif ()
+
     if (ARG_LINK_LIBS)
         target_link_libraries(${target} ${ARG_LINK_LIBS})
     endif ()
 
+    # import std (ENABLE_IMPORT_STD) and module scanning, PROPERTIES can still override it
+    set(_modules_args)
+    if (DEFINED ARG_IMPORT_STD)
+        list(APPEND _modules_args IMPORT_STD ${ARG_IMPORT_STD})
+    endif ()
+    target_enable_cxx_modules(${target} ${_modules_args})
+
+    # Section GC, identical code folding and hidden visibility (LEAN_BINARIES), PROPERTIES can still override it
+    set(_lean_args)
+    if (DEFINED ARG_LEAN_BINARIES)
+        list(APPEND _lean_args ENABLE ${ARG_LEAN_BINARIES})
+    endif ()
+    target_enable_lean_binaries(${target} ${_lean_args})
+
     if (ARG_PROPERTIES)
         set_target_properties(${target} PROPERTIES ${ARG_PROPERTIES})
     endif ()
 
+    # Precompiled headers (per-target headers, reuse from another target, or the global default)
+    set(_pch_args)
+    if (DEFINED ARG_ENABLE_PCH)
+        list(APPEND _pch_args ENABLE ${ARG_ENABLE_PCH})
+    endif ()
+    if (ARG_PRECOMPILE_HEADERS)
+        list(APPEND _pch_args HEADERS ${ARG_PRECOMPILE_HEADERS})
+    endif ()
+    if (DEFINED ARG_REUSE_PCH_FROM)
+        list(APPEND _pch_args REUSE_FROM ${ARG_REUSE_PCH_FROM})
+    endif ()
+    target_enable_precompiled_headers(${target} ${_pch_args})
+
+    # Unity (jumbo) builds, batched so parallel builds keep every core busy
+    set(_unity_args)
+    if (DEFINED ARG_UNITY_BUILD)
+        list(APPEND _unity_args ENABLE ${ARG_UNITY_BUILD})
+    endif ()
+    if (DEFINED ARG_UNITY_BATCH_SIZE)
+        list(APPEND _unity_args BATCH_SIZE ${ARG_UNITY_BATCH_SIZE})
+    endif ()
+    if (ARG_UNITY_EXCLUDE)
+        list(APPEND _unity_args EXCLUDE ${ARG_UNITY_EXCLUDE})
+    endif ()
+    target_enable_unity_build(${target} ${_unity_args})
+
+    # Compile time traces for the build-profile report
+    set(_profiling_args)
+    if (DEFINED ARG_BUILD_PROFILING)
+        list(APPEND _profiling_args ENABLE ${ARG_BUILD_PROFILING})
+    endif ()
+    target_enable_build_profiling(${target} ${_profiling_args})
+
+    # Runtime profiler client and zone macros (ENABLE_PROFILER)
+    set(_profiler_args)
+    if (DEFINED ARG_PROFILER)
+        list(APPEND _profiler_args PROFILER ${ARG_PROFILER})
+    endif ()
+    target_enable_profiler(${target} ${_profiler_args})
+
+    # Profile-guided optimization (PGO_MODE GENERATE|USE)
+    set(_pgo_args)
+    if (DEFINED ARG_ENABLE_PGO)
+        list(APPEND _pgo_args ENABLE ${ARG_ENABLE_PGO})
+    endif ()
+    if (DEFINED ARG_PGO_PROFILE_DIR)
+        list(APPEND _pgo_args PROFILE_DIR ${ARG_PGO_PROFILE_DIR})
+    endif ()
+    target_enable_profile_guided_optimization(${target} ${_pgo_args})
+
+    # Post-link code layout optimization (ENABLE_BOLT), passed by register_executable() only
+    if (DEFINED ARG_ENABLE_BOLT)
+        target_enable_bolt(${target} ENABLE "${ARG_ENABLE_BOLT}")
+    endif ()
+
+    # Fixed CPU level, and per-ISA variants of ISA_SOURCES picked at runtime
+    if (DEFINED ARG_MARCH)
+        target_set_march(${target} "${ARG_MARCH}")
+    endif ()
+    if (ARG_TARGET_ISAS)
+        target_enable_instruction_sets(${target} ISAS ${ARG_TARGET_ISAS} SOURCES ${ARG_ISA_SOURCES})
+    endif ()
+
     # Configure RPATH for shared library dependencies
     if (UNIX)
         set_target_properties(${target} PROPERTIES
@@ -101,6 +206,8 @@ function(_register_target_common target)
                 FILE_SET HEADERS DESTINATION include
                 FILE_SET CXX_MODULES DESTINATION include/modules
         )
+        # The optimized <binary>.bolt replaces the installed binary
+        _install_bolt_output(${target} bin)
 
         get_property(_exported_sets GLOBAL PROPERTY _REGISTER_EXPORTED_SETS)
         if (NOT ARG_EXPORT_SET IN_LIST _exported_sets)
@@ -153,6 +260,8 @@ endmacro()
 #     [INSTALL_DESTINATION <dir>]
 # )
 function(register_header_only_library name)
+    configure_quiet_scope()
+
     cmake_parse_arguments(PARSE_ARGV 1 ARG
             ""
             "NAMESPACE;EXPORT_SET;INSTALL_DESTINATION;CXX_STANDARD;HEADER_BASE_DIR"
@@ -239,18 +348,45 @@ endfunction()
 #     [ENABLE_HARDENING ON|OFF]
 #     [ENABLE_CLANG_TIDY ON|OFF]
 #     [ENABLE_CPPCHECK ON|OFF]
+#     [ENABLE_PCH ON|OFF]
+#     [PRECOMPILE_HEADERS <header> …]
+#     [REUSE_PCH_FROM     <target>]
+#     [UNITY_BUILD ON|OFF]
+#     [UNITY_BATCH_SIZE   <n>]
+#     [UNITY_EXCLUDE      <file> …]
+#     [BUILD_PROFILING ON|OFF]         override ENABLE_BUILD_PROFILING
+#     [ENABLE_PGO ON|OFF]
+#     [PGO_PROFILE_DIR    <dir>]
+#     [MARCH              <native|x86-64-v3|…>]
+#     [TARGET_ISAS        <sse4.2|avx2|avx512|neon> …]
+#     [ISA_SOURCES        <file> …]    compiled once per TARGET_ISAS entry, see TargetInstructionSets.cmake
+#     [PROFILER           none|tracy|perfetto|itt]   override ENABLE_PROFILER, see TargetProfiler.cmake
+#     [LEAN_BINARIES ON|OFF]           override LEAN_BINARIES, see TargetLeanBinaries.cmake
+#     [IMPORT_STD ON|OFF]              override ENABLE_IMPORT_STD, see TargetCxxModules.cmake
 # )
 function(register_library name)
-    cmake_parse_arguments(PARSE_ARGV 1 ARG
-            "STATIC;SHARED"
-            "NAMESPACE;EXPORT_SET;INSTALL_DESTINATION;CXX_STANDARD;EXPORT_HEADER;EXPORT_MACRO_NAME;HEADER_BASE_DIR;
-         ENABLE_EXCEPTIONS;ENABLE_IPO;WARNINGS_AS_ERRORS;
-         ENABLE_SANITIZER_ADDRESS;ENABLE_SANITIZER_LEAK;
-         ENABLE_SANITIZER_UNDEFINED_BEHAVIOR;ENABLE_SANITIZER_THREAD;
-         ENABLE_SANITIZER_MEMORY;ENABLE_HARDENING;
-         ENABLE_CLANG_TIDY;ENABLE_CPPCHECK"
-            "SOURCES;HEADERS;CXX_MODULES;INCLUDE_DIRS;LINK_LIBS;COMPILE_OPTIONS;COMPILE_DEFINITIONS;PROPERTIES"
+    configure_quiet_scope()
+
+    set(_options
+            STATIC SHARED
+    )
+    set(_one_value_args
+            NAMESPACE EXPORT_SET INSTALL_DESTINATION CXX_STANDARD EXPORT_HEADER EXPORT_MACRO_NAME HEADER_BASE_DIR
+            ENABLE_EXCEPTIONS ENABLE_IPO WARNINGS_AS_ERRORS
+            ENABLE_SANITIZER_ADDRESS ENABLE_SANITIZER_LEAK
+            ENABLE_SANITIZER_UNDEFINED_BEHAVIOR ENABLE_SANITIZER_THREAD
+            ENABLE_SANITIZER_MEMORY ENABLE_HARDENING
+            ENABLE_CLANG_TIDY ENABLE_CPPCHECK
+            ENABLE_PCH REUSE_PCH_FROM
+            UNITY_BUILD UNITY_BATCH_SIZE BUILD_PROFILING
+            ENABLE_PGO PGO_PROFILE_DIR
+            MARCH PROFILER LEAN_BINARIES IMPORT_STD
+    )
+    set(_multi_value_args
+            SOURCES HEADERS CXX_MODULES INCLUDE_DIRS LINK_LIBS COMPILE_OPTIONS COMPILE_DEFINITIONS PROPERTIES PRECOMPILE_HEADERS UNITY_EXCLUDE
+            TARGET_ISAS ISA_SOURCES
     )
+    cmake_parse_arguments(PARSE_ARGV 1 ARG "${_options}" "${_one_value_args}" "${_multi_value_args}")
 
     if (ARG_STATIC)
         set(_linkage STATIC)
@@ -303,8 +439,6 @@ function(register_library name)
     )
 
     if (DEFINED ARG_EXPORT_HEADER)
-        include(GenerateExportHeader)
-
         set(_export_file "${CMAKE_CURRENT_BINARY_DIR}/${ARG_EXPORT_HEADER}")
 
         set(_geh_extra)
@@ -322,6 +456,8 @@ function(register_library name)
                 BASE_DIRS "${CMAKE_CURRENT_BINARY_DIR}"
                 FILES "${_export_file}"
         )
+        # Lets LEAN_BINARIES hide every symbol the export macros do not mark
+        set_target_properties(${name} PROPERTIES _EXPORT_HEADER "${_export_file}")
 
         target_include_directories(${name} PUBLIC
                 "$<BUILD_INTERFACE:${CMAKE_CURRENT_BINARY_DIR}>"
@@ -336,12 +472,12 @@ function(register_library name)
     endif ()
 
     set(_forward CXX_STANDARD ${ARG_CXX_STANDARD})
-    foreach (_kw NAMESPACE EXPORT_SET INSTALL_DESTINATION)
+    foreach (_kw NAMESPACE EXPORT_SET INSTALL_DESTINATION ENABLE_PCH REUSE_PCH_FROM UNITY_BUILD UNITY_BATCH_SIZE BUILD_PROFILING ENABLE_PGO PGO_PROFILE_DIR MARCH PROFILER LEAN_BINARIES IMPORT_STD)
         if (DEFINED ARG_${_kw})
             list(APPEND _forward ${_kw} "${ARG_${_kw}}")
         endif ()
     endforeach ()
-    foreach (_mv INCLUDE_DIRS LINK_LIBS COMPILE_OPTIONS COMPILE_DEFINITIONS PROPERTIES)
+    foreach (_mv INCLUDE_DIRS LINK_LIBS COMPILE_OPTIONS COMPILE_DEFINITIONS PROPERTIES PRECOMPILE_HEADERS UNITY_EXCLUDE TARGET_ISAS ISA_SOURCES)
         if (ARG_${_mv})
             list(APPEND _forward ${_mv} ${ARG_${_mv}})
         endif ()
@@ -349,6 +485,7 @@ function(register_library name)
 
     _register_target_common(${name} ${_forward})
     _register_forward_quality_opts(${name})
+    target_track_binary_size(${name})
 endfunction()
 
 
@@ -376,18 +513,44 @@ endfunction()
 #     [ENABLE_HARDENING ON|OFF]
 #     [ENABLE_CLANG_TIDY ON|OFF]
 #     [ENABLE_CPPCHECK ON|OFF]
+#     [ENABLE_PCH ON|OFF]
+#     [PRECOMPILE_HEADERS <header> …]
+#     [REUSE_PCH_FROM     <target>]
+#     [UNITY_BUILD ON|OFF]
+#     [UNITY_BATCH_SIZE   <n>]
+#     [UNITY_EXCLUDE      <file> …]
+#     [BUILD_PROFILING ON|OFF]         override ENABLE_BUILD_PROFILING
+#     [ENABLE_PGO ON|OFF]
+#     [PGO_PROFILE_DIR    <dir>]
+#     [MARCH              <native|x86-64-v3|…>]
+#     [TARGET_ISAS        <sse4.2|avx2|avx512|neon> …]
+#     [ISA_SOURCES        <file> …]    compiled once per TARGET_ISAS entry, see TargetInstructionSets.cmake
+#     [ALLOCATOR          system|mimalloc|jemalloc|tcmalloc|snmalloc]   override ALLOCATOR, see TargetAllocator.cmake
+#     [PROFILER           none|tracy|perfetto|itt]   override ENABLE_PROFILER, see TargetProfiler.cmake
+#     [ENABLE_BOLT ON|OFF]             override ENABLE_BOLT, see TargetBolt.cmake
+#     [LEAN_BINARIES ON|OFF]           override LEAN_BINARIES, see TargetLeanBinaries.cmake
+#     [IMPORT_STD ON|OFF]              override ENABLE_IMPORT_STD, see TargetCxxModules.cmake
 # )
 function(register_executable name)
-    cmake_parse_arguments(PARSE_ARGV 1 ARG
-            ""
-            "NAMESPACE;EXPORT_SET;INSTALL_DESTINATION;CXX_STANDARD;HEADER_BASE_DIR;
-         ENABLE_EXCEPTIONS;ENABLE_IPO;WARNINGS_AS_ERRORS;
-         ENABLE_SANITIZER_ADDRESS;ENABLE_SANITIZER_LEAK;
-         ENABLE_SANITIZER_UNDEFINED_BEHAVIOR;ENABLE_SANITIZER_THREAD;
-         ENABLE_SANITIZER_MEMORY;ENABLE_HARDENING;
-         ENABLE_CLANG_TIDY;ENABLE_CPPCHECK"
-            "SOURCES;HEADERS;CXX_MODULES;INCLUDE_DIRS;LINK_LIBS;COMPILE_OPTIONS;COMPILE_DEFINITIONS;PROPERTIES"
+    configure_quiet_scope()
+
+    set(_one_value_args
+            NAMESPACE EXPORT_SET INSTALL_DESTINATION CXX_STANDARD HEADER_BASE_DIR
+            ENABLE_EXCEPTIONS ENABLE_IPO WARNINGS_AS_ERRORS
+            ENABLE_SANITIZER_ADDRESS ENABLE_SANITIZER_LEAK
+            ENABLE_SANITIZER_UNDEFINED_BEHAVIOR ENABLE_SANITIZER_THREAD
+            ENABLE_SANITIZER_MEMORY ENABLE_HARDENING
+            ENABLE_CLANG_TIDY ENABLE_CPPCHECK
+            ENABLE_PCH REUSE_PCH_FROM
+            UNITY_BUILD UNITY_BATCH_SIZE BUILD_PROFILING
+            ENABLE_PGO PGO_PROFILE_DIR
+            MARCH ALLOCATOR PROFILER ENABLE_BOLT LEAN_BINARIES IMPORT_STD
     )
+    set(_multi_value_args
+            SOURCES HEADERS CXX_MODULES INCLUDE_DIRS LINK_LIBS COMPILE_OPTIONS COMPILE_DEFINITIONS PROPERTIES PRECOMPILE_HEADERS UNITY_EXCLUDE
+            TARGET_ISAS ISA_SOURCES
+    )
+    cmake_parse_arguments(PARSE_ARGV 1 ARG "" "${_one_value_args}" "${_multi_value_args}")
 
     add_executable(${name})
 
@@ -429,13 +592,18 @@ function(register_executable name)
         set(ARG_INSTALL_DESTINATION "bin")
     endif ()
 
+    # Only executables follow ENABLE_BOLT, tests and benchmarks are never shipped
+    if (NOT DEFINED ARG_ENABLE_BOLT)
+        set(ARG_ENABLE_BOLT "${ENABLE_BOLT}")
+    endif ()
+
     set(_forward CXX_STANDARD ${ARG_CXX_STANDARD} INSTALL_DESTINATION ${ARG_INSTALL_DESTINATION})
-    foreach (_kw NAMESPACE EXPORT_SET)
+    foreach (_kw NAMESPACE EXPORT_SET ENABLE_PCH REUSE_PCH_FROM UNITY_BUILD UNITY_BATCH_SIZE BUILD_PROFILING ENABLE_PGO PGO_PROFILE_DIR MARCH ALLOCATOR PROFILER ENABLE_BOLT LEAN_BINARIES IMPORT_STD)
         if (DEFINED ARG_${_kw})
             list(APPEND _forward ${_kw} "${ARG_${_kw}}")
         endif ()
     endforeach ()
-    foreach (_mv INCLUDE_DIRS LINK_LIBS COMPILE_OPTIONS COMPILE_DEFINITIONS PROPERTIES)
+    foreach (_mv INCLUDE_DIRS LINK_LIBS COMPILE_OPTIONS COMPILE_DEFINITIONS PROPERTIES PRECOMPILE_HEADERS UNITY_EXCLUDE TARGET_ISAS ISA_SOURCES)
         if (ARG_${_mv})
             list(APPEND _forward ${_mv} ${ARG_${_mv}})
         endif ()
@@ -443,6 +611,7 @@ function(register_executable name)
 
     _register_target_common(${name} ${_forward})
     _register_forward_quality_opts(${name})
+    target_track_binary_size(${name})
 endfunction()
 
 
@@ -461,6 +630,11 @@ endfunction()
 #     [LABELS             <label> …]
 #     [TIMEOUT            <seconds>]
 #     [ENVIRONMENT        <VAR=val> …]
+#     [RESOURCE_LOCK      <resource> …]
+#     [PROCESSORS         <n>]
+#     [DISCOVER_TESTS]                 one CTest entry per test case
+#     [SHARDS             <n>]         split the test cases over n CTest entries
+#     [FRAMEWORK          doctest|gtest|catch2]   default: detected from the linked libraries
 #     [ENABLE_EXCEPTIONS ON|OFF]
 #     [ENABLE_IPO ON|OFF]
 #     [WARNINGS_AS_ERRORS ON|OFF]
@@ -472,18 +646,60 @@ endfunction()
 #     [ENABLE_HARDENING ON|OFF]
 #     [ENABLE_CLANG_TIDY ON|OFF]
 #     [ENABLE_CPPCHECK ON|OFF]
+#     [ENABLE_PCH ON|OFF]
+#     [PRECOMPILE_HEADERS <header> …]
+#     [REUSE_PCH_FROM     <target>]
+#     [UNITY_BUILD ON|OFF]
+#     [UNITY_BATCH_SIZE   <n>]
+#     [UNITY_EXCLUDE      <file> …]
+#     [BUILD_PROFILING ON|OFF]         override ENABLE_BUILD_PROFILING
+#     [ENABLE_PGO ON|OFF]
+#     [PGO_PROFILE_DIR    <dir>]
+#     [ALLOCATOR          system|mimalloc|jemalloc|tcmalloc|snmalloc]   override ALLOCATOR
+#     [PROFILER           none|tracy|perfetto|itt]   override ENABLE_PROFILER
+#     [LEAN_BINARIES ON|OFF]           override LEAN_BINARIES
+#     [IMPORT_STD ON|OFF]              override ENABLE_IMPORT_STD
 # )
+#
+# A test binary is one CTest entry by default. DISCOVER_TESTS registers every test case on its own
+# (doctest_discover_tests, gtest_discover_tests or catch_discover_tests) so ctest -j can run them in parallel,
+# SHARDS splits them over a few entries instead, when the process startup outweighs a single case.
+# Both need the framework, which is usually linked after register_test(), so they are set up at the end
+# of the directory. LABELS, TIMEOUT, ENVIRONMENT, RESOURCE_LOCK and PROCESSORS apply to every entry.
+# Every test is tracked in test-impact.json, ctest-affected runs the ones whose dependencies changed.
 function(register_test name)
-    cmake_parse_arguments(PARSE_ARGV 1 ARG
-            ""
-            "CXX_STANDARD;WORKING_DIRECTORY;TIMEOUT;
-         ENABLE_EXCEPTIONS;ENABLE_IPO;WARNINGS_AS_ERRORS;
-         ENABLE_SANITIZER_ADDRESS;ENABLE_SANITIZER_LEAK;
-         ENABLE_SANITIZER_UNDEFINED_BEHAVIOR;ENABLE_SANITIZER_THREAD;
-         ENABLE_SANITIZER_MEMORY;ENABLE_HARDENING;
-         ENABLE_CLANG_TIDY;ENABLE_CPPCHECK"
-            "SOURCES;HEADERS;CXX_MODULES;INCLUDE_DIRS;LINK_LIBS;COMPILE_OPTIONS;COMPILE_DEFINITIONS;PROPERTIES;TEST_ARGS;LABELS;ENVIRONMENT"
+    configure_quiet_scope()
+
+    set(_options DISCOVER_TESTS)
+    set(_one_value_args
+            CXX_STANDARD WORKING_DIRECTORY TIMEOUT PROCESSORS SHARDS FRAMEWORK ALLOCATOR PROFILER LEAN_BINARIES IMPORT_STD
+            ENABLE_EXCEPTIONS ENABLE_IPO WARNINGS_AS_ERRORS
+            ENABLE_SANITIZER_ADDRESS ENABLE_SANITIZER_LEAK
+            ENABLE_SANITIZER_UNDEFINED_BEHAVIOR ENABLE_SANITIZER_THREAD
+            ENABLE_SANITIZER_MEMORY ENABLE_HARDENING
+            ENABLE_CLANG_TIDY ENABLE_CPPCHECK
+            ENABLE_PCH REUSE_PCH_FROM
+            UNITY_BUILD UNITY_BATCH_SIZE BUILD_PROFILING
+            ENABLE_PGO PGO_PROFILE_DIR
+    )
+    set(_multi_value_args
+            SOURCES HEADERS CXX_MODULES INCLUDE_DIRS LINK_LIBS COMPILE_OPTIONS COMPILE_DEFINITIONS PROPERTIES PRECOMPILE_HEADERS UNITY_EXCLUDE TEST_ARGS LABELS ENVIRONMENT
+            RESOURCE_LOCK
     )
+    cmake_parse_arguments(PARSE_ARGV 1 ARG "${_options}" "${_one_value_args}" "${_multi_value_args}")
+
+    if (DEFINED ARG_SHARDS AND NOT ARG_SHARDS MATCHES "^[1-9][0-9]*$")
+        message(FATAL_ERROR "register_test: SHARDS must be a positive number, got '${ARG_SHARDS}'")
+    endif ()
+    if (ARG_DISCOVER_TESTS AND ARG_SHARDS GREATER 1)
+        message(FATAL_ERROR "register_test: DISCOVER_TESTS and SHARDS cannot be combined for '${name}'")
+    endif ()
+    if (DEFINED ARG_FRAMEWORK)
+        string(TOLOWER "${ARG_FRAMEWORK}" ARG_FRAMEWORK)
+        if (NOT ARG_FRAMEWORK MATCHES "^(doctest|gtest|catch2)$")
+            message(FATAL_ERROR "register_test: unknown FRAMEWORK '${ARG_FRAMEWORK}' (expected doctest, gtest or catch2)")
+        endif ()
+    endif ()
 
     add_executable(${name})
 
@@ -525,7 +741,12 @@ function(register_test name)
     endif ()
 
     set(_forward CXX_STANDARD ${ARG_CXX_STANDARD})
-    foreach (_mv INCLUDE_DIRS LINK_LIBS COMPILE_OPTIONS COMPILE_DEFINITIONS PROPERTIES)
+    foreach (_kw ENABLE_PCH REUSE_PCH_FROM UNITY_BUILD UNITY_BATCH_SIZE BUILD_PROFILING ENABLE_PGO PGO_PROFILE_DIR ALLOCATOR PROFILER LEAN_BINARIES IMPORT_STD)
+        if (DEFINED ARG_${_kw})
+            list(APPEND _forward ${_kw} "${ARG_${_kw}}")
+        endif ()
+    endforeach ()
+    foreach (_mv INCLUDE_DIRS LINK_LIBS COMPILE_OPTIONS COMPILE_DEFINITIONS PROPERTIES PRECOMPILE_HEADERS UNITY_EXCLUDE)
         if (ARG_${_mv})
             list(APPEND _forward ${_mv} ${ARG_${_mv}})
         endif ()
@@ -539,25 +760,520 @@ function(register_test name)
         set(_wd "${ARG_WORKING_DIRECTORY}")
     endif ()
 
+    # Kept on the target, the CTest entries of DISCOVER_TESTS and SHARDS are only added at the end of the directory
+    set(_test_properties "")
+    foreach (_property LABELS TIMEOUT ENVIRONMENT RESOURCE_LOCK PROCESSORS)
+        if (DEFINED ARG_${_property})
+            list(APPEND _test_properties ${_property})
+            set_property(TARGET ${name} PROPERTY _REGISTER_TEST_${_property} "${ARG_${_property}}")
+        endif ()
+    endforeach ()
+    set_target_properties(${name} PROPERTIES
+            _REGISTER_TEST_PROPERTIES "${_test_properties}"
+            _REGISTER_TEST_ARGS "${ARG_TEST_ARGS}"
+            _REGISTER_TEST_WORKING_DIRECTORY "${_wd}"
+            _REGISTER_TEST_FRAMEWORK "${ARG_FRAMEWORK}"
+    )
+
+    if (ARG_DISCOVER_TESTS)
+        cmake_language(EVAL CODE "cmake_language(DEFER CALL _register_test_discover [[${name}]])")
+    elseif (ARG_SHARDS GREATER 1)
+        cmake_language(EVAL CODE "cmake_language(DEFER CALL _register_test_shards [[${name}]] [[${ARG_SHARDS}]])")
+    else ()
+        add_test(
+                NAME ${name}
+                COMMAND ${name} ${ARG_TEST_ARGS}
+                WORKING_DIRECTORY "${_wd}"
+        )
+        _register_test_apply_properties(${name} ${name})
+    endif ()
+
+    target_track_test_impact(${name})
+endfunction()
+
+
+# _register_test_apply_properties(<target> <test> …)
+# Sets the LABELS, TIMEOUT, ENVIRONMENT, RESOURCE_LOCK and PROCESSORS given to register_test() on the tests.
+function(_register_test_apply_properties target)
+    get_target_property(_test_properties ${target} _REGISTER_TEST_PROPERTIES)
+    foreach (_property ${_test_properties})
+        get_target_property(_value ${target} _REGISTER_TEST_${_property})
+        set_tests_properties(${ARGN} PROPERTIES ${_property} "${_value}")
+    endforeach ()
+endfunction()
+
+
+# _register_test_framework(<target> <out_var>)
+# The FRAMEWORK given to register_test(), or the one found in the libraries and include directories of the
+# target (CPM links doctest::doctest, GTest::gtest or Catch2::Catch2, xrepo adds the package include paths).
+# Empty when neither tells, e.g. xrepo packages resolved later by XREPO_BATCH_INSTALL.
+function(_register_test_framework target out_var)
+    get_target_property(_framework ${target} _REGISTER_TEST_FRAMEWORK)
+    if (NOT _framework)
+        get_target_property(_links ${target} LINK_LIBRARIES)
+        get_target_property(_includes ${target} INCLUDE_DIRECTORIES)
+        foreach (_item ${_links} ${_includes})
+            string(TOLOWER "${_item}" _item)
+            if (_item MATCHES "doctest")
+                set(_framework doctest)
+            elseif (_item MATCHES "gtest|gmock|googletest")
+                set(_framework gtest)
+            elseif (_item MATCHES "catch2")
+                set(_framework catch2)
+            else ()
+                continue()
+            endif ()
+            break()
+        endforeach ()
+    endif ()
+    if (NOT _framework)
+        set(_framework "")
+    endif ()
+    set(${out_var} "${_framework}" PARENT_SCOPE)
+endfunction()
+
+
+# _register_test_single(<target> <reason>)
+# One CTest entry running the whole test executable, when its cases cannot be registered on their own.
+function(_register_test_single target reason)
+    message(WARNING "register_test: ${reason}, '${target}' runs as a single test")
+    get_target_property(_args ${target} _REGISTER_TEST_ARGS)
+    get_target_property(_wd ${target} _REGISTER_TEST_WORKING_DIRECTORY)
     add_test(
-            NAME ${name}
-            COMMAND ${name} ${ARG_TEST_ARGS}
+            NAME ${target}
+            COMMAND ${target} ${_args}
+            WORKING_DIRECTORY "${_wd}"
+    )
+    _register_test_apply_properties(${target} ${target})
+endfunction()
+
+
+# _register_test_discover(<target>)
+# Deferred part of register_test(DISCOVER_TESTS): registers each test case of the framework on its own.
+# Falls back to a single CTest entry when the framework is unknown or ships no discovery script (e.g. xrepo packages).
+function(_register_test_discover target)
+    _register_test_framework(${target} _framework)
+    if (NOT _framework)
+        _register_test_single(${target} "cannot tell the test framework (pass FRAMEWORK doctest|gtest|catch2)")
+        return()
+    endif ()
+    get_target_property(_args ${target} _REGISTER_TEST_ARGS)
+    get_target_property(_wd ${target} _REGISTER_TEST_WORKING_DIRECTORY)
+
+    # Included in this scope every time, the scripts keep the path of their helper in a local variable
+    if (_framework STREQUAL "gtest")
+        include(GoogleTest)
+        set(_command gtest_discover_tests)
+    elseif (_framework STREQUAL "doctest")
+        set(_module "")
+        foreach (_candidate "${doctest_SOURCE_DIR}/scripts/cmake/doctest.cmake" "${doctest_DIR}/doctest.cmake")
+            if (EXISTS "${_candidate}")
+                set(_module "${_candidate}")
+                break()
+            endif ()
+        endforeach ()
+        if (NOT _module)
+            # Installed packages (xrepo adds them to CMAKE_PREFIX_PATH)
+            unset(_module)
+            find_file(_module doctest.cmake PATH_SUFFIXES lib/cmake/doctest NO_CACHE)
+        endif ()
+        if (_module)
+            include("${_module}")
+        endif ()
+        set(_command doctest_discover_tests)
+    else ()
+        set(_module "")
+        foreach (_candidate
+                "${Catch2_SOURCE_DIR}/extras/Catch.cmake"
+                "${Catch2_SOURCE_DIR}/contrib/Catch.cmake"
+                "${Catch2_DIR}/Catch.cmake")
+            if (EXISTS "${_candidate}")
+                set(_module "${_candidate}")
+                break()
+            endif ()
+        endforeach ()
+        if (_module)
+            include("${_module}")
+        endif ()
+        set(_command catch_discover_tests)
+    endif ()
+
+    if (NOT COMMAND ${_command})
+        _register_test_single(${target} "${_command}() is not available")
+        return()
+    endif ()
+
+    set(_extra_args "")
+    if (_args)
+        set(_extra_args EXTRA_ARGS ${_args})
+    endif ()
+    cmake_language(CALL ${_command} ${target}
+            ${_extra_args}
             WORKING_DIRECTORY "${_wd}"
+            TEST_PREFIX "${target}."
+            TEST_LIST ${target}_TESTS
     )
 
-    if (ARG_LABELS)
-        set_tests_properties(${name} PROPERTIES LABELS "${ARG_LABELS}")
+    # The discovered names are only known to CTest, list values (LABELS, ENVIRONMENT) cannot go through
+    # PROPERTIES either, so a CTest include script sets them after the discovery script listed the tests
+    get_target_property(_test_properties ${target} _REGISTER_TEST_PROPERTIES)
+    if (NOT _test_properties)
+        return()
+    endif ()
+    set(_content "if (${target}_TESTS)\n    set_tests_properties(\${${target}_TESTS} PROPERTIES")
+    foreach (_property ${_test_properties})
+        get_target_property(_value ${target} _REGISTER_TEST_${_property})
+        string(APPEND _content "\n            ${_property} [==[${_value}]==]")
+    endforeach ()
+    string(APPEND _content "\n    )\nendif ()\n")
+
+    set(_script "${CMAKE_CURRENT_BINARY_DIR}/${target}_test_properties.cmake")
+    file(WRITE "${_script}" "${_content}")
+    set_property(DIRECTORY APPEND PROPERTY TEST_INCLUDE_FILES "${_script}")
+endfunction()
+
+
+# _register_test_shards(<target> <count>)
+# Deferred part of register_test(SHARDS): one CTest entry per shard, <target>.shard-<index> (0 based).
+# Google Test shards through GTEST_TOTAL_SHARDS / GTEST_SHARD_INDEX, Catch2 (3.x) through --shard-count /
+# --shard-index, doctest through TestShard.cmake, which runs a --dt-first / --dt-last range of the test cases.
+function(_register_test_shards target count)
+    _register_test_framework(${target} _framework)
+    if (NOT _framework)
+        _register_test_single(${target} "cannot tell the test framework to shard (pass FRAMEWORK doctest|gtest|catch2)")
+        return()
+    endif ()
+    get_target_property(_args ${target} _REGISTER_TEST_ARGS)
+    get_target_property(_wd ${target} _REGISTER_TEST_WORKING_DIRECTORY)
+
+    if (_framework STREQUAL "catch2" AND DEFINED Catch2_VERSION AND Catch2_VERSION VERSION_LESS 3)
+        message(FATAL_ERROR "register_test: SHARDS needs Catch2 3.x, '${target}' uses Catch2 ${Catch2_VERSION}")
+    endif ()
+
+    set(_emulator "")
+    get_target_property(_target_emulator ${target} CROSSCOMPILING_EMULATOR)
+    if (_target_emulator)
+        set(_emulator ${_target_emulator})
+    endif ()
+
+    math(EXPR _last "${count} - 1")
+    set(_tests "")
+    foreach (_index RANGE ${_last})
+        set(_test ${target}.shard-${_index})
+        if (_framework STREQUAL "doctest")
+            string(JOIN "|" _command ${_emulator} "$<TARGET_FILE:${target}>" ${_args})
+            add_test(
+                    NAME ${_test}
+                    COMMAND ${CMAKE_COMMAND}
+                    "-DTEST_COMMAND=${_command}"
+                    -DSHARD_INDEX=${_index}
+                    -DSHARD_COUNT=${count}
+                    -P "${_TEST_SHARD_SCRIPT}"
+                    WORKING_DIRECTORY "${_wd}"
+            )
+        elseif (_framework STREQUAL "catch2")
+            add_test(
+                    NAME ${_test}
+                    COMMAND ${target} ${_args} --shard-count ${count} --shard-index ${_index}
+                    WORKING_DIRECTORY "${_wd}"
+            )
+        else ()
+            add_test(
+                    NAME ${_test}
+                    COMMAND ${target} ${_args}
+                    WORKING_DIRECTORY "${_wd}"
+            )
+        endif ()
+        list(APPEND _tests ${_test})
+    endforeach ()
+
+    _register_test_apply_properties(${target} ${_tests})
+    if (_framework STREQUAL "gtest")
+        foreach (_index RANGE ${_last})
+            set_property(TEST ${target}.shard-${_index} APPEND PROPERTY ENVIRONMENT
+                    GTEST_TOTAL_SHARDS=${count}
+                    GTEST_SHARD_INDEX=${_index}
+            )
+        endforeach ()
+    endif ()
+endfunction()
+
+# register_benchmark(<name>
+#     [FRAMEWORK          google|nanobench]   default: google
+#     [SOURCES            <file> …]
+#     [HEADERS            <file> …]
+#     [INCLUDE_DIRS       <dir>  …]
+#     [LINK_LIBS          <tgt>  …]
+#     [CXX_STANDARD       <std>]
+#     [COMPILE_OPTIONS     <opt> …]
+#     [COMPILE_DEFINITIONS <def> …]
+#     [PROPERTIES         <key val> …]
+#     [BENCHMARK_ARGS     <arg> …]
+#     [REPETITIONS        <n>]                default: BENCHMARK_REPETITIONS (google only)
+#     [WORKING_DIRECTORY  <dir>]
+#     [LABELS             <label> …]          "benchmark" is always added
+#     [TIMEOUT            <seconds>]
+#     [ENVIRONMENT        <VAR=val> …]
+#     [ENABLE_PCH ON|OFF]
+#     [PRECOMPILE_HEADERS <header> …]
+#     [REUSE_PCH_FROM     <target>]
+#     [UNITY_BUILD ON|OFF]
+#     [UNITY_BATCH_SIZE   <n>]
+#     [UNITY_EXCLUDE      <file> …]
+#     [BUILD_PROFILING ON|OFF]         override ENABLE_BUILD_PROFILING
+#     [ALLOCATOR          system|mimalloc|jemalloc|tcmalloc|snmalloc]   override ALLOCATOR
+#     [PROFILER           none|tracy|perfetto|itt]   override ENABLE_PROFILER
+#     [LEAN_BINARIES ON|OFF]           override LEAN_BINARIES
+#     [IMPORT_STD ON|OFF]              override ENABLE_IMPORT_STD
+# )
+#
+# Benchmark sources are always compiled optimized with debug info and NDEBUG, without sanitizer
+# instrumentation, whatever the configuration. The framework is fetched through CPM or xrepo.
+#
+# The CTest entry runs serially and writes JSON to ${CMAKE_BINARY_DIR}/benchmarks/<name>.json:
+# Google Benchmark through --benchmark_out, nanobench programs should render
+# ankerl::nanobench::templates::json() to the file named by the BENCHMARK_OUT environment variable.
+# benchmark-compare runs every benchmark and fails when one is slower than BENCHMARK_BASELINE_DIR by more
+# than BENCHMARK_REGRESSION_THRESHOLD percent, benchmark-baseline stores the current results as the baseline.
+function(register_benchmark name)
+    configure_quiet_scope()
+
+    set(_one_value_args
+            FRAMEWORK CXX_STANDARD REPETITIONS WORKING_DIRECTORY TIMEOUT
+            ENABLE_PCH REUSE_PCH_FROM
+            UNITY_BUILD UNITY_BATCH_SIZE BUILD_PROFILING ALLOCATOR PROFILER LEAN_BINARIES IMPORT_STD
+    )
+    set(_multi_value_args
+            SOURCES HEADERS INCLUDE_DIRS LINK_LIBS COMPILE_OPTIONS COMPILE_DEFINITIONS PROPERTIES PRECOMPILE_HEADERS UNITY_EXCLUDE BENCHMARK_ARGS LABELS ENVIRONMENT
+    )
+    cmake_parse_arguments(PARSE_ARGV 1 ARG "" "${_one_value_args}" "${_multi_value_args}")
+
+    if (NOT DEFINED ARG_FRAMEWORK)
+        set(ARG_FRAMEWORK google)
+    endif ()
+    string(TOLOWER "${ARG_FRAMEWORK}" ARG_FRAMEWORK)
+    if (NOT ARG_FRAMEWORK MATCHES "^(google|nanobench)$")
+        message(FATAL_ERROR "register_benchmark: unknown FRAMEWORK '${ARG_FRAMEWORK}' (expected google or nanobench)")
+    endif ()
+
+    add_executable(${name})
+
+    if (ARG_SOURCES)
+        target_sources(${name} PRIVATE ${ARG_SOURCES})
+    endif ()
+
+    if (ARG_HEADERS)
+        target_sources(${name} PRIVATE
+                FILE_SET HEADERS
+                BASE_DIRS "${CMAKE_CURRENT_SOURCE_DIR}"
+                FILES ${ARG_HEADERS}
+        )
+    endif ()
+
+    if (EXISTS "${CMAKE_CURRENT_SOURCE_DIR}/include")
+        target_include_directories(${name} PRIVATE
+                "$<BUILD_INTERFACE:${CMAKE_CURRENT_SOURCE_DIR}/include>"
+        )
+    endif ()
+
+    if (NOT DEFINED ARG_CXX_STANDARD)
+        if (DEFINED CMAKE_CXX_STANDARD)
+            set(ARG_CXX_STANDARD ${CMAKE_CXX_STANDARD})
+        else ()
+            set(ARG_CXX_STANDARD 17)
+        endif ()
+    endif ()
+
+    set(_forward CXX_STANDARD ${ARG_CXX_STANDARD})
+    foreach (_kw ENABLE_PCH REUSE_PCH_FROM UNITY_BUILD UNITY_BATCH_SIZE BUILD_PROFILING ALLOCATOR PROFILER LEAN_BINARIES IMPORT_STD)
+        if (DEFINED ARG_${_kw})
+            list(APPEND _forward ${_kw} "${ARG_${_kw}}")
+        endif ()
+    endforeach ()
+    foreach (_mv INCLUDE_DIRS LINK_LIBS COMPILE_OPTIONS COMPILE_DEFINITIONS PROPERTIES PRECOMPILE_HEADERS UNITY_EXCLUDE)
+        if (ARG_${_mv})
+            list(APPEND _forward ${_mv} ${ARG_${_mv}})
+        endif ()
+    endforeach ()
+
+    # No PGO instrumentation either, it would be measured too
+    _register_target_common(${name} ${_forward} ENABLE_PGO OFF)
+    _register_benchmark_release_flags(${name})
+    _register_benchmark_framework(${name} ${ARG_FRAMEWORK})
+
+    # Results
+    set(_results_dir "${CMAKE_BINARY_DIR}/benchmarks")
+    set(_json "${_results_dir}/${name}.json")
+    file(MAKE_DIRECTORY "${_results_dir}")
+
+    set(_args ${ARG_BENCHMARK_ARGS})
+    if (ARG_FRAMEWORK STREQUAL "google")
+        if (NOT DEFINED ARG_REPETITIONS)
+            set(ARG_REPETITIONS ${BENCHMARK_REPETITIONS})
+        endif ()
+        list(APPEND _args "--benchmark_out=${_json}" "--benchmark_out_format=json")
+        if (ARG_REPETITIONS GREATER 1)
+            # Medians of several runs keep the regression gate from tripping on noise
+            list(APPEND _args
+                    "--benchmark_repetitions=${ARG_REPETITIONS}"
+                    "--benchmark_report_aggregates_only=true"
+            )
+        endif ()
+    endif ()
+
+    set(_wd "${CMAKE_CURRENT_BINARY_DIR}")
+    if (DEFINED ARG_WORKING_DIRECTORY)
+        set(_wd "${ARG_WORKING_DIRECTORY}")
     endif ()
 
+    add_test(
+            NAME ${name}
+            COMMAND ${name} ${_args}
+            WORKING_DIRECTORY "${_wd}"
+    )
+
+    # Serial, concurrent benchmarks would compete for cores and caches
+    set(_labels benchmark ${ARG_LABELS})
+    set(_environment "BENCHMARK_OUT=${_json}" ${ARG_ENVIRONMENT})
+    set_tests_properties(${name} PROPERTIES
+            LABELS "${_labels}"
+            RUN_SERIAL TRUE
+            ENVIRONMENT "${_environment}"
+    )
+
     if (DEFINED ARG_TIMEOUT)
         set_tests_properties(${name} PROPERTIES TIMEOUT ${ARG_TIMEOUT})
     endif ()
 
-    if (ARG_ENVIRONMENT)
-        set_tests_properties(${name} PROPERTIES ENVIRONMENT "${ARG_ENVIRONMENT}")
+    _register_benchmark_compare_targets("${_results_dir}")
+    add_dependencies(benchmark-compare ${name})
+    add_dependencies(benchmark-baseline ${name})
+endfunction()
+
+
+# _register_benchmark_release_flags(<target>)
+# Release-with-debug-info code generation for every configuration.
+# Global sanitizer and hardening flags also apply to the libraries under test, they can only be undone for
+# the benchmark sources (the sanitizer runtimes stay linked), so a warning points to a release tree instead.
+function(_register_benchmark_release_flags target)
+    set(_optimized "$<CONFIG:Release,RelWithDebInfo,MinSizeRel>")
+
+    if (MSVC)
+        # /O2 is rejected next to the /RTC1 of Debug configurations
+        target_compile_options(${target} PRIVATE "$<${_optimized}:/Zi>")
+        target_link_options(${target} PRIVATE "$<${_optimized}:/DEBUG>")
+    else ()
+        target_compile_options(${target} PRIVATE -g "$<$<NOT:${_optimized}>:-O2>")
+        target_compile_definitions(${target} PRIVATE "$<$<NOT:${_optimized}>:NDEBUG>")
+        if (ENABLE_GLOBAL_SANITIZERS)
+            target_compile_options(${target} PRIVATE -fno-sanitize=all)
+        endif ()
+    endif ()
+
+    get_property(_warned GLOBAL PROPERTY _REGISTER_BENCHMARK_WARNED)
+    if (_warned)
+        return()
+    endif ()
+    set_property(GLOBAL PROPERTY _REGISTER_BENCHMARK_WARNED TRUE)
+
+    set(_skew "")
+    if (ENABLE_GLOBAL_SANITIZERS AND (ENABLE_ASAN OR ENABLE_UBSAN OR ENABLE_LSAN OR ENABLE_TSAN OR ENABLE_MSAN))
+        list(APPEND _skew "sanitizers")
+    endif ()
+    string(TOLOWER "${HARDENING_LEVEL}" _hardening_level)
+    if (ENABLE_GLOBAL_HARDENING AND _hardening_level STREQUAL "full")
+        # _GLIBCXX_DEBUG changes the std:: ABI, it cannot be dropped for a single target
+        list(APPEND _skew "_GLIBCXX_DEBUG containers")
+    endif ()
+    if (MSVC AND CMAKE_BUILD_TYPE STREQUAL "Debug")
+        list(APPEND _skew "unoptimized MSVC Debug builds")
+    endif ()
+    if (_skew)
+        string(JOIN ", " _skew ${_skew})
+        message(WARNING "Benchmarks link code built with ${_skew}, configure a release tree (RELEASE_MODE=ON) for representative numbers")
+    endif ()
+endfunction()
+
+
+# _register_benchmark_framework(<target> <google|nanobench>)
+# Fetches the framework once, through the same package managers as the test samples.
+function(_register_benchmark_framework target framework)
+    if (framework STREQUAL "google")
+        set(_cpm_target benchmark::benchmark)
+        set(_cpm_links benchmark::benchmark benchmark::benchmark_main)
+        set(_xrepo_package "benchmark 1.9.1")
+        set(_xrepo_name benchmark)
+    else ()
+        set(_cpm_target nanobench::nanobench)
+        set(_cpm_links nanobench::nanobench)
+        set(_xrepo_package "nanobench 4.3.11")
+        set(_xrepo_name nanobench)
+    endif ()
+
+    if (COMMAND CPMAddPackage)
+        if (NOT TARGET ${_cpm_target})
+            if (framework STREQUAL "google")
+                CPMAddPackage(
+                        NAME benchmark
+                        GITHUB_REPOSITORY google/benchmark
+                        VERSION 1.9.1
+                        SYSTEM ON
+                        OPTIONS
+                        "BENCHMARK_ENABLE_TESTING OFF"
+                        "BENCHMARK_ENABLE_INSTALL OFF"
+                        "BENCHMARK_ENABLE_WERROR OFF"
+                        "BENCHMARK_INSTALL_DOCS OFF"
+                )
+            else ()
+                CPMAddPackage(
+                        NAME nanobench
+                        GITHUB_REPOSITORY martinus/nanobench
+                        VERSION 4.3.11
+                        SYSTEM ON
+                )
+            endif ()
+        endif ()
+        target_link_dependencies(${target} PRIVATE ${_cpm_links})
+    elseif (COMMAND xrepo_package)
+        xrepo_package("${_xrepo_package}")
+        xrepo_target_packages(${target} ${_xrepo_name})
+    else ()
+        message(FATAL_ERROR "register_benchmark: no package manager available for ${framework}.")
     endif ()
 endfunction()
 
+
+# _register_benchmark_compare_targets(<results_dir>)
+# Creates benchmark-compare and benchmark-baseline once, both run every benchmark through CTest first.
+function(_register_benchmark_compare_targets results_dir)
+    if (TARGET benchmark-compare)
+        return()
+    endif ()
+
+    set(_run_benchmarks ${CMAKE_CTEST_COMMAND} -C $<CONFIG> -L "^benchmark$" --output-on-failure)
+    set(_compare
+            ${CMAKE_COMMAND}
+            "-DRESULTS_DIR=${results_dir}"
+            "-DBASELINE_DIR=${BENCHMARK_BASELINE_DIR}"
+            "-DTHRESHOLD=${BENCHMARK_REGRESSION_THRESHOLD}"
+    )
+
+    add_custom_target(benchmark-compare
+            COMMAND ${_run_benchmarks}
+            COMMAND ${_compare} -P "${_BENCHMARK_COMPARE_SCRIPT}"
+            WORKING_DIRECTORY "${CMAKE_BINARY_DIR}"
+            COMMENT "Comparing benchmarks against ${BENCHMARK_BASELINE_DIR} (threshold ${BENCHMARK_REGRESSION_THRESHOLD}%)"
+            VERBATIM
+    )
+    add_custom_target(benchmark-baseline
+            COMMAND ${_run_benchmarks}
+            COMMAND ${_compare} -DUPDATE_BASELINE=ON -P "${_BENCHMARK_COMPARE_SCRIPT}"
+            WORKING_DIRECTORY "${CMAKE_BINARY_DIR}"
+            COMMENT "Storing benchmark results as the baseline in ${BENCHMARK_BASELINE_DIR}"
+            VERBATIM
+    )
+endfunction()
+
 # register_emscripten(<name>
 #     [SOURCES            <file> …]
 #     [HEADERS            <file> …]
@@ -575,6 +1291,8 @@ endfunction()
 #     [HTML_TITLE         <string>]               default: "<name> - WebAssembly"
 #     [CANVAS_ID          <id>]                   default: "canvas"
 #     [OUTPUT_DIR         <dir>]
+#     [DEV_SERVER]                                <name>_serve target, serves OUTPUT_DIR cross-origin isolated
+#     [DEV_SERVER_PORT    <port>]                 default: 8080
 #
 #     # Symbol exports
 #     [EXPORTED_FUNCTIONS       <_func> …]
@@ -583,19 +1301,34 @@ endfunction()
 #     # Virtual filesystem
 #     [PRELOAD_FILES      <file> …]
 #     [EMBED_FILES        <file> …]
+#     [PRELOAD_LZ4]                               LZ4-compressed .data package, decompressed on access
+#     [PRELOAD_CACHE]                             keeps the .data package in IndexedDB between visits
+#
+#     # Delivery
+#     [COMPRESS gzip|brotli …]                    precompressed .wasm/.js/.data next to the output (and installed)
 #
 #     # Memory  (raw bytes or units: 16MB 128MB 1GB)
 #     [INITIAL_MEMORY <size>]
 #     [MAXIMUM_MEMORY <size>]
 #     [STACK_SIZE <size>]
 #
+#     # Optimization (non-Debug configurations)
+#     [OPTIMIZE size|speed|startup]               -Os / -O3 / -Oz with LTO; startup also pre-evaluates constructors
+#     [MALLOC dlmalloc|emmalloc|mimalloc]         emmalloc is smallest, mimalloc scales with threads
+#
 #     # Feature flags
 #     [WASM]
 #     [STANDALONE_WASM]
 #     [NODE_JS]
 #     [PTHREAD]
+#     [PTHREAD_POOL_SIZE <n|navigator.hardwareConcurrency>]   workers spawned before main(), implies PTHREAD
+#     [PROXY_TO_PTHREAD]                          main() on a worker, implies PTHREAD
+#     [OFFSCREEN_CANVAS]                          WebGL from workers, the canvas moves to main()'s thread
 #     [SIMD]
+#     [RELAXED_SIMD]                              implies SIMD, needs a browser with relaxed SIMD
+#     [WASM_BIGINT]                               i64 as JS BigInt, no legalization stubs
 #     [ASYNCIFY]
+#     [JSPI]                                      JS promise integration, replaces ASYNCIFY
 #     [ASSERTIONS]
 #     [SAFE_HEAP]
 #     [ALLOW_MEMORY_GROWTH]
@@ -618,26 +1351,53 @@ endfunction()
 #
 # No-op when EMSCRIPTEN is not defined (non-web builds are unaffected).
 function(register_emscripten name)
+    configure_quiet_scope()
+
     if (NOT DEFINED EMSCRIPTEN)
         message(STATUS "[register_emscripten] Skipping '${name}' — not an Emscripten build")
         return()
     endif ()
 
-    cmake_parse_arguments(PARSE_ARGV 1 ARG
-            "WASM;STANDALONE_WASM;NODE_JS;PTHREAD;SIMD;ASYNCIFY;ASSERTIONS;
-         SAFE_HEAP;ALLOW_MEMORY_GROWTH;CLOSURE_COMPILER"
-            "CXX_STANDARD;HTML_TEMPLATE;HTML_TITLE;CANVAS_ID;OUTPUT_DIR;
-         INITIAL_MEMORY;MAXIMUM_MEMORY;STACK_SIZE;INSTALL_DESTINATION;
-         ENABLE_EXCEPTIONS;ENABLE_IPO;WARNINGS_AS_ERRORS;
-         ENABLE_SANITIZER_ADDRESS;ENABLE_SANITIZER_LEAK;
-         ENABLE_SANITIZER_UNDEFINED_BEHAVIOR;ENABLE_SANITIZER_THREAD;
-         ENABLE_SANITIZER_MEMORY;ENABLE_HARDENING;
-         ENABLE_CLANG_TIDY;ENABLE_CPPCHECK"
-            "SOURCES;HEADERS;CXX_MODULES;INCLUDE_DIRS;LINK_LIBS;
-         COMPILE_OPTIONS;COMPILE_DEFINITIONS;PROPERTIES;DEPENDENCIES;
-         EXPORTED_FUNCTIONS;EXPORTED_RUNTIME_METHODS;
-         PRELOAD_FILES;EMBED_FILES"
+    set(_options
+            WASM STANDALONE_WASM NODE_JS PTHREAD PROXY_TO_PTHREAD OFFSCREEN_CANVAS
+            SIMD RELAXED_SIMD WASM_BIGINT ASYNCIFY JSPI ASSERTIONS SAFE_HEAP
+            ALLOW_MEMORY_GROWTH CLOSURE_COMPILER DEV_SERVER PRELOAD_LZ4 PRELOAD_CACHE
+    )
+    set(_one_value_args
+            CXX_STANDARD HTML_TEMPLATE HTML_TITLE CANVAS_ID OUTPUT_DIR
+            DEV_SERVER_PORT OPTIMIZE MALLOC PTHREAD_POOL_SIZE
+            INITIAL_MEMORY MAXIMUM_MEMORY STACK_SIZE INSTALL_DESTINATION
+            ENABLE_EXCEPTIONS ENABLE_IPO WARNINGS_AS_ERRORS
+            ENABLE_SANITIZER_ADDRESS ENABLE_SANITIZER_LEAK
+            ENABLE_SANITIZER_UNDEFINED_BEHAVIOR ENABLE_SANITIZER_THREAD
+            ENABLE_SANITIZER_MEMORY ENABLE_HARDENING
+            ENABLE_CLANG_TIDY ENABLE_CPPCHECK
     )
+    set(_multi_value_args
+            SOURCES HEADERS CXX_MODULES INCLUDE_DIRS LINK_LIBS
+            COMPILE_OPTIONS COMPILE_DEFINITIONS PROPERTIES DEPENDENCIES
+            EXPORTED_FUNCTIONS EXPORTED_RUNTIME_METHODS
+            PRELOAD_FILES EMBED_FILES COMPRESS
+    )
+    cmake_parse_arguments(PARSE_ARGV 1 ARG "${_options}" "${_one_value_args}" "${_multi_value_args}")
+
+    if (ARG_ASYNCIFY AND ARG_JSPI)
+        message(FATAL_ERROR "register_emscripten: '${name}' sets both ASYNCIFY and JSPI, pick one")
+    endif ()
+    if (ARG_MALLOC AND NOT ARG_MALLOC MATCHES "^(dlmalloc|emmalloc|mimalloc)$")
+        message(FATAL_ERROR "register_emscripten: unknown MALLOC '${ARG_MALLOC}' (expected dlmalloc, emmalloc or mimalloc)")
+    endif ()
+    if (ARG_PTHREAD_POOL_SIZE AND NOT ARG_PTHREAD_POOL_SIZE MATCHES "^([0-9]+|navigator\\.hardwareConcurrency)$")
+        message(FATAL_ERROR "register_emscripten: PTHREAD_POOL_SIZE must be a count or navigator.hardwareConcurrency, got '${ARG_PTHREAD_POOL_SIZE}'")
+    endif ()
+    foreach (_format ${ARG_COMPRESS})
+        if (NOT _format MATCHES "^(gzip|brotli)$")
+            message(FATAL_ERROR "register_emscripten: unknown COMPRESS format '${_format}' (expected gzip or brotli)")
+        endif ()
+    endforeach ()
+    if (ARG_PROXY_TO_PTHREAD OR ARG_PTHREAD_POOL_SIZE)
+        set(ARG_PTHREAD ON)
+    endif ()
 
     add_executable(${name})
 
@@ -697,7 +1457,7 @@ function(register_emscripten name)
         set(_shell "${ARG_HTML_TEMPLATE}")
     else ()
         set(_shell "${CMAKE_CURRENT_BINARY_DIR}/${name}_shell.html")
-        _register_emscripten_write_shell("${_shell}" "${ARG_HTML_TITLE}" "${ARG_CANVAS_ID}")
+        _register_emscripten_write_shell("${_shell}" "${ARG_HTML_TITLE}" "${ARG_CANVAS_ID}" "${ARG_PTHREAD}" "${name}.wasm")
     endif ()
 
     set_target_properties(${name} PROPERTIES SUFFIX ".html")
@@ -748,11 +1508,29 @@ function(register_emscripten name)
     foreach (_f IN LISTS ARG_EMBED_FILES)
         target_link_options(${name} PRIVATE "SHELL:--embed-file ${_f}")
     endforeach ()
+    if (ARG_PRELOAD_FILES AND ARG_PRELOAD_LZ4)
+        target_link_options(${name} PRIVATE "SHELL:-s LZ4=1")
+    endif ()
+    if (ARG_PRELOAD_FILES AND ARG_PRELOAD_CACHE)
+        target_link_options(${name} PRIVATE "--use-preload-cache")
+    endif ()
 
     if (ARG_PTHREAD)
         target_compile_options(${name} PRIVATE "SHELL:-s USE_PTHREADS=1")
         target_link_options(${name} PRIVATE "SHELL:-s USE_PTHREADS=1")
     endif ()
+    if (ARG_PTHREAD_POOL_SIZE)
+        target_link_options(${name} PRIVATE "SHELL:-s PTHREAD_POOL_SIZE=${ARG_PTHREAD_POOL_SIZE}")
+    endif ()
+    if (ARG_PROXY_TO_PTHREAD)
+        target_link_options(${name} PRIVATE "SHELL:-s PROXY_TO_PTHREAD=1")
+    endif ()
+    if (ARG_OFFSCREEN_CANVAS)
+        target_link_options(${name} PRIVATE "SHELL:-s OFFSCREENCANVAS_SUPPORT=1")
+        if (ARG_PROXY_TO_PTHREAD)
+            target_link_options(${name} PRIVATE "SHELL:-s OFFSCREENCANVASES_TO_PTHREAD=#${ARG_CANVAS_ID}")
+        endif ()
+    endif ()
 
     if (ARG_NODE_JS)
         target_link_options(${name} PRIVATE "SHELL:-s ENVIRONMENT=node")
@@ -762,12 +1540,34 @@ function(register_emscripten name)
         target_link_options(${name} PRIVATE "SHELL:-s ENVIRONMENT=web")
     endif ()
 
-    if (ARG_SIMD)
+    if (ARG_SIMD OR ARG_RELAXED_SIMD)
         target_compile_options(${name} PRIVATE "-msimd128")
     endif ()
+    if (ARG_RELAXED_SIMD)
+        target_compile_options(${name} PRIVATE "-mrelaxed-simd")
+    endif ()
+    if (ARG_WASM_BIGINT)
+        target_link_options(${name} PRIVATE "SHELL:-s WASM_BIGINT=1")
+    endif ()
+    if (ARG_MALLOC)
+        target_link_options(${name} PRIVATE "SHELL:-s MALLOC=${ARG_MALLOC}")
+    endif ()
+    if (ARG_OPTIMIZE)
+        _register_emscripten_optimize(${name} ${ARG_OPTIMIZE})
+    endif ()
+
     if (ARG_ASYNCIFY)
         target_link_options(${name} PRIVATE "SHELL:-s ASYNCIFY=1")
     endif ()
+    if (ARG_JSPI)
+        # Older releases only know JSPI as the second Asyncify mode
+        _register_emscripten_version(_emscripten_version)
+        if (_emscripten_version VERSION_LESS "3.1.61")
+            target_link_options(${name} PRIVATE "SHELL:-s ASYNCIFY=2")
+        else ()
+            target_link_options(${name} PRIVATE "SHELL:-s JSPI=1")
+        endif ()
+    endif ()
     if (ARG_ASSERTIONS)
         target_link_options(${name} PRIVATE "SHELL:-s ASSERTIONS=1")
     endif ()
@@ -778,23 +1578,188 @@ function(register_emscripten name)
         target_link_options(${name} PRIVATE "SHELL:--closure 1")
     endif ()
 
+    set(_compressed_suffixes "")
+    if (ARG_COMPRESS)
+        set(_formats ${ARG_COMPRESS})
+        if ("brotli" IN_LIST _formats)
+            find_program(BROTLI_EXECUTABLE brotli)
+            if (BROTLI_EXECUTABLE)
+                list(APPEND _compressed_suffixes .br)
+            else ()
+                message(WARNING "register_emscripten: brotli not found, '${name}' gets no .br files")
+                list(REMOVE_ITEM _formats brotli)
+            endif ()
+        endif ()
+        if ("gzip" IN_LIST _formats)
+            list(APPEND _compressed_suffixes .gz)
+        endif ()
+
+        if (_formats)
+            string(JOIN "|" _formats ${_formats})
+            add_custom_command(TARGET ${name} POST_BUILD
+                    COMMAND ${CMAKE_COMMAND}
+                    "-DDIRECTORY=$<TARGET_FILE_DIR:${name}>"
+                    "-DBASE_NAME=${name}"
+                    "-DFORMATS=${_formats}"
+                    "-DBROTLI=${BROTLI_EXECUTABLE}"
+                    -P "${_EMSCRIPTEN_COMPRESS_SCRIPT}"
+                    COMMENT "Compressing ${name} output"
+                    VERBATIM
+            )
+        endif ()
+    endif ()
+
     # Uses INSTALL_DESTINATION as the gate (same logic as EXPORT_SET elsewhere).
     # Can't go through _register_target_common because Emscripten output is a
-    # file trio (.html/.js/.wasm), not an installable CMake target binary.
+    # file set (.html/.js/.wasm, .data, compressed copies), not an installable CMake target binary.
     if (DEFINED ARG_INSTALL_DESTINATION)
-        install(FILES
-                "$<TARGET_FILE_DIR:${name}>/${name}.html"
-                "$<TARGET_FILE_DIR:${name}>/${name}.js"
-                "$<TARGET_FILE_DIR:${name}>/${name}.wasm"
+        set(_install_files "")
+        foreach (_extension html js wasm data)
+            set(_file "$<TARGET_FILE_DIR:${name}>/${name}.${_extension}")
+            list(APPEND _install_files "${_file}")
+            if (NOT _extension STREQUAL "html")
+                foreach (_suffix ${_compressed_suffixes})
+                    list(APPEND _install_files "${_file}${_suffix}")
+                endforeach ()
+            endif ()
+        endforeach ()
+        install(FILES ${_install_files}
                 DESTINATION "${ARG_INSTALL_DESTINATION}"
                 OPTIONAL
         )
     endif ()
 
+    if (ARG_DEV_SERVER)
+        if (NOT ARG_DEV_SERVER_PORT)
+            set(ARG_DEV_SERVER_PORT 8080)
+        endif ()
+        _register_emscripten_add_server(${name} ${ARG_DEV_SERVER_PORT})
+    endif ()
+
     message(STATUS "[register_emscripten] configured '${name}'")
 endfunction()
 
 
+# _register_emscripten_add_server(<name> <port>)
+# Adds <name>_serve, a local HTTP server for the output directory of <name>. It sends the
+# cross-origin isolation headers SharedArrayBuffer (and so PTHREAD) needs, and application/wasm.
+function(_register_emscripten_add_server name port)
+    find_package(Python3 COMPONENTS Interpreter QUIET)
+    if (NOT Python3_Interpreter_FOUND)
+        message(WARNING "register_emscripten: no Python interpreter found, '${name}_serve' is not available")
+        return()
+    endif ()
+
+    set(_script "${CMAKE_BINARY_DIR}/CMakeFiles/EmscriptenServe.py")
+    # Rewritten only when the content changes, so existing build trees pick up a changed server
+    file(CONFIGURE OUTPUT "${_script}" @ONLY CONTENT [=[
+# Serves a directory with the cross-origin isolation headers, generated by RegisterTarget.cmake.
+# Precompressed .br / .gz copies are sent instead of the original when the browser accepts them.
+import functools
+import http.server
+import os
+import sys
+
+
+class Handler(http.server.SimpleHTTPRequestHandler):
+    extensions_map = {
+        **http.server.SimpleHTTPRequestHandler.extensions_map,
+        ".wasm": "application/wasm",
+        ".js": "text/javascript",
+        ".data": "application/octet-stream",
+    }
+
+    def send_head(self):
+        path = self.translate_path(self.path)
+        accepted = self.headers.get("Accept-Encoding", "")
+        for encoding, suffix in (("br", ".br"), ("gzip", ".gz")):
+            if encoding in accepted and os.path.isfile(path + suffix):
+                file = open(path + suffix, "rb")
+                self.send_response(200)
+                self.send_header("Content-Type", self.guess_type(path))
+                self.send_header("Content-Encoding", encoding)
+                self.send_header("Content-Length", str(os.fstat(file.fileno()).st_size))
+                self.end_headers()
+                return file
+        return super().send_head()
+
+    def end_headers(self):
+        self.send_header("Cross-Origin-Opener-Policy", "same-origin")
+        self.send_header("Cross-Origin-Embedder-Policy", "require-corp")
+        self.send_header("Cache-Control", "no-cache")
+        super().end_headers()
+
+
+directory, port, page = sys.argv[1], int(sys.argv[2]), sys.argv[3]
+server = http.server.ThreadingHTTPServer(("127.0.0.1", port), functools.partial(Handler, directory=directory))
+print(f"Serving http://127.0.0.1:{port}/{page} (Ctrl+C to stop)", flush=True)
+try:
+    server.serve_forever()
+except KeyboardInterrupt:
+    pass
+]=])
+
+    add_custom_target(${name}_serve
+            COMMAND "${Python3_EXECUTABLE}" "${_script}" "$<TARGET_FILE_DIR:${name}>" ${port} "$<TARGET_FILE_NAME:${name}>"
+            DEPENDS ${name}
+            USES_TERMINAL
+            COMMENT "Serving ${name} on port ${port}"
+            VERBATIM
+    )
+endfunction()
+
+
+# _register_emscripten_optimize(<name> size|speed|startup)
+# Optimization profile of the non-Debug configurations. The link step needs the level too,
+# that is where wasm-opt runs.
+function(_register_emscripten_optimize name profile)
+    if (profile STREQUAL "size")
+        set(_level -Os)
+        set(_link_extra "")
+    elseif (profile STREQUAL "speed")
+        set(_level -O3)
+        set(_link_extra "")
+    elseif (profile STREQUAL "startup")
+        # Static constructors run at build time (wasm-ctor-eval) instead of on every page load
+        set(_level -Oz)
+        set(_link_extra -sEVAL_CTORS=1)
+    else ()
+        message(FATAL_ERROR "register_emscripten: unknown OPTIMIZE '${profile}' (expected size, speed or startup)")
+    endif ()
+
+    set(_optimized "$<NOT:$<CONFIG:Debug>>")
+    set(_link_flags ${_level} -flto ${_link_extra})
+    target_compile_options(${name} PRIVATE "$<${_optimized}:${_level};-flto>")
+    target_link_options(${name} PRIVATE "$<${_optimized}:${_link_flags}>")
+endfunction()
+
+
+# _register_emscripten_version(<output_var>)
+# Emscripten release, EMSCRIPTEN_VERSION when the platform module set it, else parsed from emcc --version
+# once and kept in the toolchain profile.
+function(_register_emscripten_version out_var)
+    if (DEFINED EMSCRIPTEN_VERSION AND NOT EMSCRIPTEN_VERSION STREQUAL "")
+        set(${out_var} "${EMSCRIPTEN_VERSION}" PARENT_SCOPE)
+        return()
+    endif ()
+
+    toolchain_profile_get(EMSCRIPTEN_VERSION _version)
+    if (NOT _version_FOUND)
+        execute_process(
+                COMMAND "${CMAKE_CXX_COMPILER}" --version
+                OUTPUT_VARIABLE _output
+                ERROR_QUIET
+        )
+        string(REGEX MATCH "[0-9]+\\.[0-9]+\\.[0-9]+" _version "${_output}")
+        if (NOT _version)
+            message(FATAL_ERROR "register_emscripten: cannot tell the Emscripten version from '${CMAKE_CXX_COMPILER} --version', JSPI needs it to pick -sJSPI or -sASYNCIFY=2")
+        endif ()
+        toolchain_profile_set(EMSCRIPTEN_VERSION "${_version}")
+    endif ()
+    set(${out_var} "${_version}" PARENT_SCOPE)
+endfunction()
+
+
 # _register_emscripten_parse_memory(<input> <output_var>)
 # Converts "16MB" / "1GB" / raw bytes → byte count.
 function(_register_emscripten_parse_memory size_str out_var)
@@ -820,9 +1785,21 @@ function(_register_emscripten_parse_memory size_str out_var)
 endfunction()
 
 
-# _register_emscripten_write_shell(<output_file> <title> <canvas_id>)
+# _register_emscripten_write_shell(<output_file> <title> <canvas_id> <pthread> <wasm_file>)
 # Writes a minimal Emscripten HTML shell to disk at configure time.
-function(_register_emscripten_write_shell output_file title canvas_id)
+# The wasm download and compilation start with the page (WebAssembly.compileStreaming), in parallel
+# with the download of the JS glue, falling back to an ArrayBuffer when the server sends another MIME type.
+# Threaded builds report a page that is not cross-origin isolated instead of failing silently.
+function(_register_emscripten_write_shell output_file title canvas_id pthread wasm_file)
+    set(_isolation_check "")
+    if (pthread)
+        set(_isolation_check "
+    if (!self.crossOriginIsolated) {
+      document.getElementById('status').textContent =
+        'Not cross-origin isolated: serve with Cross-Origin-Opener-Policy: same-origin and ' +
+        'Cross-Origin-Embedder-Policy: require-corp (DEV_SERVER) to enable threads';
+    }")
+    endif ()
     file(WRITE "${output_file}" "\
 <!DOCTYPE html>
 <html lang=\"en\">
@@ -848,8 +1825,29 @@ function(_register_emscripten_write_shell output_file title canvas_id)
   <div id=\"output\"></div>
   <div id=\"status\" class=\"status\">Loading...</div>
   <script>
+    var wasmCompilation = (function() {
+      function compileBuffer() {
+        return fetch('${wasm_file}')
+          .then(function(response) { return response.arrayBuffer(); })
+          .then(function(bytes) { return WebAssembly.compile(bytes); });
+      }
+      if (!WebAssembly.compileStreaming) return compileBuffer();
+      return WebAssembly.compileStreaming(fetch('${wasm_file}')).catch(compileBuffer);
+    })();
     var Module = {
       canvas: document.getElementById('${canvas_id}'),
+      instantiateWasm: function(imports, receiveInstance) {
+        wasmCompilation
+          .then(function(module) {
+            return WebAssembly.instantiate(module, imports).then(function(instance) {
+              receiveInstance(instance, module);
+            });
+          })
+          .catch(function(error) {
+            document.getElementById('status').textContent = 'Failed to load ${wasm_file}: ' + error;
+          });
+        return {};
+      },
       print: function(t) {
         var o = document.getElementById('output');
         o.textContent += t + '\\n'; o.scrollTop = o.scrollHeight;
@@ -861,7 +1859,7 @@ function(_register_emscripten_write_shell output_file title canvas_id)
       onRuntimeInitialized: function() {
         document.getElementById('status').textContent = 'Ready';
       }
-    };
+    };${_isolation_check}
   </script>
   {{{ SCRIPT }}}
 </body>
@@ -0,0 +1,39 @@
+#
+# Runs one shard of a doctest executable, used by register_test(SHARDS) for doctest tests:
+#
+#   cmake -DTEST_COMMAND=<exe>[|<arg>...] -DSHARD_INDEX=<i> -DSHARD_COUNT=<n> -P TestShard.cmake
+#
+# doctest has no shard option, so the test cases passing the filters in TEST_COMMAND are counted first
+# (--dt-count) and shard SHARD_INDEX (0 based) runs its slice of them through --dt-first / --dt-last.
+# Google Test and Catch2 shard natively and do not use this script.
+#
+
+string(REPLACE "|" ";" TEST_COMMAND "${TEST_COMMAND}")
+
+execute_process(
+        COMMAND ${TEST_COMMAND} --dt-count=1
+        OUTPUT_VARIABLE _output
+        ERROR_VARIABLE _output
+        RESULT_VARIABLE _result
+)
+if (NOT _result EQUAL 0 OR NOT _output MATCHES "passing the current filters: ([0-9]+)")
+    message(FATAL_ERROR "Could not count the test cases of ${TEST_COMMAND}:\n${_output}")
+endif ()
+set(_count ${CMAKE_MATCH_1})
+
+# Ranges are 1 based and inclusive, shard sizes differ by one test case at most
+math(EXPR _first "${SHARD_INDEX} * ${_count} / ${SHARD_COUNT} + 1")
+math(EXPR _last "(${SHARD_INDEX} + 1) * ${_count} / ${SHARD_COUNT}")
+if (_first GREATER _last)
+    message(STATUS "Shard ${SHARD_INDEX} of ${SHARD_COUNT}: no test cases left (${_count} total)")
+    return()
+endif ()
+
+message(STATUS "Shard ${SHARD_INDEX} of ${SHARD_COUNT}: test cases ${_first} to ${_last} of ${_count}")
+execute_process(
+        COMMAND ${TEST_COMMAND} --dt-first=${_first} --dt-last=${_last}
+        RESULT_VARIABLE _result
+)
+if (NOT _result EQUAL 0)
+    message(FATAL_ERROR "Shard ${SHARD_INDEX} of ${SHARD_COUNT} failed (${_result})")
+endif ()
@@ -1,4 +1,5 @@
 include_guard(DIRECTORY)
+include(GetUserCacheDirectory)
 
 # Note: XMake package manager works with Emscripten, but XMake itself must be built with host compiler
 # Store cross-compilation environment variables to restore later
@@ -9,6 +10,17 @@ endif ()
 option(XREPO_PACKAGE_DISABLE "Disable Xrepo Packages" OFF)
 option(XREPO_PACKAGE_VERBOSE "Enable verbose output for Xrepo Packages" OFF)
 option(XREPO_BOOTSTRAP_XMAKE "Bootstrap Xmake automatically" ON)
+option(XREPO_BATCH_INSTALL "Queue every xrepo_package() call and install them together in xrepo_resolve_all()" OFF)
+set(XREPO_FETCH_PARALLEL_JOBS "" CACHE STRING "Concurrent xrepo fetch processes in xrepo_resolve_all(), empty uses the number of logical cores")
+
+# Fetch results shared by every build tree of the machine, so a new build directory skips xrepo install and fetch
+if (DEFINED ENV{XREPO_FETCH_CACHE_DIR})
+    set(_xrepo_fetch_cache_default "$ENV{XREPO_FETCH_CACHE_DIR}")
+else ()
+    get_user_cache_directory(xrepo _xrepo_fetch_cache_default)
+endif ()
+set(XREPO_FETCH_CACHE_DIR "${_xrepo_fetch_cache_default}" CACHE PATH "Directory of xrepo fetch results shared across build trees, empty disables it")
+unset(_xrepo_fetch_cache_default)
 
 # Following options are for cross compilation, or when specifying a specific compiler.
 set(XREPO_PLATFORM "" CACHE STRING "Xrepo package platform")
@@ -52,6 +64,12 @@ set(XREPO_XMAKEFILE "" CACHE STRING "Xmake script file of Xrepo package")
 #          If specified, setup include and link directories for the package in
 #          CMake directory scope. CMake code in `add_subdirectory` can also use
 #          the package directly.
+#          Packages with DIRECTORY_SCOPE are never queued, they are installed immediately.
+#      DEFER: optional
+#          Queue the package instead of installing it now (implied by XREPO_BATCH_INSTALL).
+#          Queued packages are installed and fetched together by xrepo_resolve_all(),
+#          which also runs automatically at the end of the top-level CMakeLists.txt.
+#          xrepo_target_packages() calls on queued packages are replayed after resolution.
 #
 # Example:
 #
@@ -64,6 +82,7 @@ set(XREPO_XMAKEFILE "" CACHE STRING "Xmake script file of Xrepo package")
 #          [MODE debug|release]
 #          [OUTPUT verbose|diagnosis|quiet]
 #          [DIRECTORY_SCOPE]
+#          [DEFER]
 #      )
 #
 # `xrepo_package` does the following tasks for the above call:
@@ -79,6 +98,16 @@ set(XREPO_XMAKEFILE "" CACHE STRING "Xmake script file of Xrepo package")
 #           include_directories(foo_INCLUDE_DIRS)
 #           link_directories(foo_LIBRARY_DIRS)
 # 3. Append package install directory to `CMAKE_PREFIX_PATH`.
+#
+# xrepo_resolve_all:
+#
+#      xrepo_resolve_all()
+#
+# Installs every queued package, with one `xrepo install` per distinct set of
+# install options (platform, arch, toolchain, mode, configs), then runs the
+# `xrepo fetch` calls side by side (XREPO_FETCH_PARALLEL_JOBS at a time).
+# Call it before find_package() on queued packages, since CMAKE_PREFIX_PATH is
+# only updated once the packages are resolved.
 
 function(_install_xmake_program)
     if (NOT XMAKE_RELEASE_LATEST)
@@ -397,7 +426,7 @@ function(xrepo_package package)
         return()
     endif ()
 
-    set(options "DIRECTORY_SCOPE;DEPS;USE_ABSOLUTE_LIBS")
+    set(options "DIRECTORY_SCOPE;DEPS;USE_ABSOLUTE_LIBS;DEFER")
     set(one_value_args CONFIGS MODE OUTPUT ALIAS)
     cmake_parse_arguments(ARG "${options}" "${one_value_args}" "" ${ARGN})
 
@@ -467,7 +496,8 @@ function(xrepo_package package)
 
     # Verbose option should not be passed to xrepo fetch.
     # Otherwise, the output would be invalid to parse.
-    set(_xrepo_cmdargs ${platform} ${arch} ${toolchain} ${includes} ${mode} ${configs})
+    set(_xrepo_install_args ${platform} ${arch} ${toolchain} ${includes} ${mode} ${configs})
+    set(_xrepo_cmdargs ${_xrepo_install_args})
     if (NOT DEFINED _config_lua_script)
         list(APPEND _xrepo_cmdargs ${package})
     endif ()
@@ -492,6 +522,27 @@ function(xrepo_package package)
         return()
     endif ()
 
+    # Another build tree may already have installed and fetched the same package
+    _xrepo_fetch_cache_key(${package_name} "${_xrepo_cmdargs_${package_name}}" _fetch_cache_key)
+    _xrepo_fetch_cache_load(${package_name} "${_fetch_cache_key}" _fetch_cache_hit)
+    if (_fetch_cache_hit)
+        message(STATUS "xrepo: ${package} found in ${XREPO_FETCH_CACHE_DIR}, using cached variables")
+
+        foreach (var ${_cache_xrepo_vars_${package_name}})
+            message(STATUS "xrepo: ${var} ${${var}}")
+        endforeach ()
+
+        set(_cache_xrepo_cmdargs_${package_name} "${_xrepo_cmdargs_${package_name}}" CACHE INTERNAL "")
+        _xrepo_finish_package_setup(${package_name})
+        return()
+    endif ()
+
+    # Batched mode, xrepo_resolve_all() installs and fetches the whole queue at once
+    if ((ARG_DEFER OR XREPO_BATCH_INSTALL) AND NOT ARG_DIRECTORY_SCOPE)
+        _xrepo_queue_package(${package_name})
+        return()
+    endif ()
+
     if (XREPO_BUILD_PARALLEL_JOBS)
         set(XREPO_BUILD_PARALLEL_JOBS_STR -j${XREPO_BUILD_PARALLEL_JOBS})
     endif ()
@@ -508,6 +559,7 @@ function(xrepo_package package)
     else ()
         _xrepo_fetch_cflags()
     endif ()
+    _xrepo_fetch_cache_store(${package_name} "${_fetch_cache_key}")
 
     _xrepo_finish_package_setup(${package_name})
 
@@ -515,6 +567,112 @@ function(xrepo_package package)
     set(_cache_xrepo_cmdargs_${package_name} "${_xrepo_cmdargs_${package_name}}" CACHE INTERNAL "")
 endfunction()
 
+function(xrepo_resolve_all)
+    if (XREPO_PACKAGE_DISABLE OR NOT XMAKE_AVAILABLE)
+        return()
+    endif ()
+
+    get_property(_queue GLOBAL PROPERTY _XREPO_QUEUE)
+    if (NOT _queue)
+        return()
+    endif ()
+    set_property(GLOBAL PROPERTY _XREPO_QUEUE "")
+
+    if (XREPO_BUILD_PARALLEL_JOBS)
+        set(XREPO_BUILD_PARALLEL_JOBS_STR -j${XREPO_BUILD_PARALLEL_JOBS})
+    endif ()
+
+    # Packages sharing platform, arch, toolchain, mode and configs go into a single xrepo install,
+    # xmake then downloads and builds them concurrently
+    set(_groups "")
+    foreach (package_name ${_queue})
+        get_property(_install_args GLOBAL PROPERTY _XREPO_QUEUE_${package_name}_INSTALL_ARGS)
+        get_property(_verbose GLOBAL PROPERTY _XREPO_QUEUE_${package_name}_VERBOSE)
+        get_property(_package GLOBAL PROPERTY _XREPO_QUEUE_${package_name}_PACKAGE)
+        string(MD5 _group "${_verbose};${_install_args}")
+        if (NOT _group IN_LIST _groups)
+            list(APPEND _groups ${_group})
+            set(_group_args_${_group} ${_verbose} ${XREPO_BUILD_PARALLEL_JOBS_STR} ${_install_args})
+            set(_group_packages_${_group} "")
+        endif ()
+        list(APPEND _group_packages_${_group} ${_package})
+    endforeach ()
+
+    foreach (_group ${_groups})
+        list(REMOVE_DUPLICATES _group_packages_${_group})
+        set(_install_cmdargs ${_group_args_${_group}} ${_group_packages_${_group}})
+        string(REPLACE ";" " " _description "${XREPO_CMD};install;${_install_cmdargs}")
+        message(STATUS "xrepo: ${_description}")
+        execute_process(COMMAND ${CMAKE_COMMAND} -E env --unset=CC --unset=CXX --unset=LD ${XREPO_CMD} install --yes ${_install_cmdargs}
+                RESULT_VARIABLE exit_code)
+        if (NOT "${exit_code}" STREQUAL "0")
+            message(FATAL_ERROR "xrepo install ${_group_packages_${_group}} failed, exit code: ${exit_code}")
+        endif ()
+    endforeach ()
+
+    # Fetches only read the installed packages, run them side by side.
+    # execute_process() starts all COMMANDs of a call at once, each worker writes its output to files.
+    set(_fetch_dir "${CMAKE_BINARY_DIR}/xrepo/fetch")
+    set(_worker "${_fetch_dir}/fetch.cmake")
+    file(WRITE "${_worker}" [=[
+# Runs one xrepo fetch for xrepo_resolve_all(), XREPO_FETCH is the output prefix
+include("${XREPO_FETCH}.cmake")
+execute_process(COMMAND ${XREPO_FETCH_COMMAND}
+        OUTPUT_FILE "${XREPO_FETCH}.out"
+        ERROR_FILE "${XREPO_FETCH}.err"
+        RESULT_VARIABLE exit_code)
+file(WRITE "${XREPO_FETCH}.rc" "${exit_code}")
+]=])
+
+    set(_jobs ${XREPO_FETCH_PARALLEL_JOBS})
+    if (NOT _jobs)
+        cmake_host_system_information(RESULT _jobs QUERY NUMBER_OF_LOGICAL_CORES)
+    endif ()
+
+    list(LENGTH _queue _count)
+    set(_index 0)
+    set(_batch "")
+    set(_batch_size 0)
+    foreach (package_name ${_queue})
+        get_property(_fetch_args GLOBAL PROPERTY _XREPO_QUEUE_${package_name}_FETCH_ARGS)
+        get_property(_deps GLOBAL PROPERTY _XREPO_QUEUE_${package_name}_DEPS)
+        if (NOT XREPO_FETCH_JSON)
+            set(_format --cflags)
+        elseif (_deps)
+            set(_format --deps --json)
+        else ()
+            set(_format --json)
+        endif ()
+
+        # The command goes through a file, package specs contain spaces and configs may contain anything
+        set(_command ${XREPO_CMD} fetch ${_format} ${_fetch_args})
+        file(WRITE "${_fetch_dir}/${package_name}.cmake" "set(XREPO_FETCH_COMMAND [==[${_command}]==])\n")
+        file(REMOVE "${_fetch_dir}/${package_name}.rc")
+        list(APPEND _batch COMMAND ${CMAKE_COMMAND} "-DXREPO_FETCH=${_fetch_dir}/${package_name}" -P "${_worker}")
+
+        math(EXPR _index "${_index} + 1")
+        math(EXPR _batch_size "${_batch_size} + 1")
+        if (_batch_size EQUAL _jobs OR _index EQUAL _count)
+            message(STATUS "xrepo: fetching ${_batch_size} package(s)")
+            execute_process(${_batch} OUTPUT_QUIET)
+            set(_batch "")
+            set(_batch_size 0)
+        endif ()
+    endforeach ()
+
+    foreach (package_name ${_queue})
+        _xrepo_resolve_queued(${package_name} "${_fetch_dir}")
+    endforeach ()
+    set(CMAKE_PREFIX_PATH ${CMAKE_PREFIX_PATH} PARENT_SCOPE)
+
+    get_property(_calls GLOBAL PROPERTY _XREPO_QUEUE_TARGET_CALLS)
+    set_property(GLOBAL PROPERTY _XREPO_QUEUE_TARGET_CALLS "")
+    foreach (_call ${_calls})
+        string(REPLACE "|" ";" _call "${_call}")
+        xrepo_target_packages(${_call})
+    endforeach ()
+endfunction()
+
 function(xrepo_target_packages target)
     if (XREPO_PACKAGE_DISABLE)
         return()
@@ -523,6 +681,16 @@ function(xrepo_target_packages target)
     set(options NO_LINK_LIBRARIES PRIVATE PUBLIC INTERFACE)
     cmake_parse_arguments(ARG "${options}" "" "" ${ARGN})
 
+    # Variables of queued packages do not exist yet, replay the call after xrepo_resolve_all()
+    get_property(_queue GLOBAL PROPERTY _XREPO_QUEUE)
+    foreach (package_name IN LISTS ARG_UNPARSED_ARGUMENTS)
+        if (package_name IN_LIST _queue)
+            string(REPLACE ";" "|" _call "${target};${ARGN}")
+            set_property(GLOBAL APPEND PROPERTY _XREPO_QUEUE_TARGET_CALLS "${_call}")
+            return()
+        endif ()
+    endforeach ()
+
     if (ARG_PRIVATE)
         set(_visibility "PRIVATE")
     elseif (ARG_PUBLIC)
@@ -599,6 +767,133 @@ macro(_xrepo_finish_package_setup package_name)
     set(CMAKE_PREFIX_PATH ${CMAKE_PREFIX_PATH} PARENT_SCOPE)
 endmacro()
 
+# Queue the package for xrepo_resolve_all(), with the arguments xrepo_package() computed
+macro(_xrepo_queue_package package_name)
+    get_property(_resolve_scheduled GLOBAL PROPERTY _XREPO_RESOLVE_SCHEDULED)
+    if (NOT _resolve_scheduled)
+        # Resolve whatever is still queued once the whole project has been read
+        cmake_language(DEFER DIRECTORY ${CMAKE_SOURCE_DIR} CALL xrepo_resolve_all)
+        set_property(GLOBAL PROPERTY _XREPO_RESOLVE_SCHEDULED TRUE)
+    endif ()
+
+    get_property(_queue GLOBAL PROPERTY _XREPO_QUEUE)
+    if (NOT ${package_name} IN_LIST _queue)
+        set_property(GLOBAL APPEND PROPERTY _XREPO_QUEUE ${package_name})
+    endif ()
+
+    if (DEFINED _config_lua_script)
+        set_property(GLOBAL PROPERTY _XREPO_QUEUE_${package_name}_PACKAGE "")
+    else ()
+        set_property(GLOBAL PROPERTY _XREPO_QUEUE_${package_name}_PACKAGE "${package}")
+    endif ()
+    set_property(GLOBAL PROPERTY _XREPO_QUEUE_${package_name}_INSTALL_ARGS "${_xrepo_install_args}")
+    set_property(GLOBAL PROPERTY _XREPO_QUEUE_${package_name}_FETCH_ARGS "${_xrepo_cmdargs}")
+    set_property(GLOBAL PROPERTY _XREPO_QUEUE_${package_name}_VERBOSE "${verbose}")
+    set_property(GLOBAL PROPERTY _XREPO_QUEUE_${package_name}_DEPS "${ARG_DEPS}")
+    set_property(GLOBAL PROPERTY _XREPO_QUEUE_${package_name}_USE_ABSOLUTE_LIBS "${ARG_USE_ABSOLUTE_LIBS}")
+    set_property(GLOBAL PROPERTY _XREPO_QUEUE_${package_name}_CMDARGS "${_xrepo_cmdargs_${package_name}}")
+    set_property(GLOBAL PROPERTY _XREPO_QUEUE_${package_name}_FETCH_CACHE_KEY "${_fetch_cache_key}")
+
+    message(STATUS "xrepo: ${package} queued for xrepo_resolve_all()")
+endmacro()
+
+# Set the variables of a queued package from the output of its xrepo fetch worker
+function(_xrepo_resolve_queued package_name fetch_dir)
+    get_property(ARG_DEPS GLOBAL PROPERTY _XREPO_QUEUE_${package_name}_DEPS)
+    get_property(ARG_USE_ABSOLUTE_LIBS GLOBAL PROPERTY _XREPO_QUEUE_${package_name}_USE_ABSOLUTE_LIBS)
+    get_property(_cmdargs GLOBAL PROPERTY _XREPO_QUEUE_${package_name}_CMDARGS)
+    get_property(_fetch_cache_key GLOBAL PROPERTY _XREPO_QUEUE_${package_name}_FETCH_CACHE_KEY)
+    set(ARG_DIRECTORY_SCOPE OFF)
+
+    set(exit_code "no result")
+    if (EXISTS "${fetch_dir}/${package_name}.rc")
+        file(READ "${fetch_dir}/${package_name}.rc" exit_code)
+        file(READ "${fetch_dir}/${package_name}.out" fetch_output)
+    endif ()
+    if (NOT "${exit_code}" STREQUAL "0")
+        if (EXISTS "${fetch_dir}/${package_name}.err")
+            file(READ "${fetch_dir}/${package_name}.err" fetch_error_output)
+        endif ()
+        message(STATUS "xrepo fetch ${package_name}:")
+        message(STATUS "STDOUT:\n${fetch_output}")
+        message(STATUS "STDERR:\n${fetch_error_output}")
+        message(FATAL_ERROR "xrepo fetch ${package_name} failed, exit code: ${exit_code}")
+    endif ()
+
+    if (XREPO_FETCH_JSON)
+        set(json_output "${fetch_output}")
+        _xrepo_parse_json()
+    else ()
+        set(cflags_output "${fetch_output}")
+        _xrepo_parse_cflags()
+    endif ()
+    _xrepo_fetch_cache_store(${package_name} "${_fetch_cache_key}")
+
+    # Stored before the prefix path setup, which returns early for packages without include dirs
+    set(_cache_xrepo_cmdargs_${package_name} "${_cmdargs}" CACHE INTERNAL "")
+    _xrepo_finish_package_setup(${package_name})
+endfunction()
+
+# Content address of a fetch result: the xrepo command line (spec, configs, platform, arch, toolchain,
+# configs script mtime), the compilers behind the default toolchain, the xmake file and the parse options
+function(_xrepo_fetch_cache_key package_name cmdargs RESULT_VAR)
+    set(_key "${package_name}|${cmdargs}|json=${XREPO_FETCH_JSON}|deps=${ARG_DEPS}|absolute=${ARG_USE_ABSOLUTE_LIBS}")
+    if ("${XREPO_TOOLCHAIN}" STREQUAL "")
+        string(APPEND _key "|${CMAKE_C_COMPILER}|${CMAKE_CXX_COMPILER}")
+    endif ()
+    if (NOT "${XREPO_XMAKEFILE}" STREQUAL "" AND EXISTS "${XREPO_XMAKEFILE}")
+        file(TIMESTAMP "${XREPO_XMAKEFILE}" _xmakefile_timestamp)
+        string(APPEND _key "|${XREPO_XMAKEFILE} (mtime: ${_xmakefile_timestamp})")
+    endif ()
+
+    string(SHA256 _key "${_key}")
+    set(${RESULT_VAR} "${_key}" PARENT_SCOPE)
+endfunction()
+
+# Load a fetch result written by any build tree, stale entries (package removed from xmake) are misses
+function(_xrepo_fetch_cache_load package_name key RESULT_VAR)
+    set(${RESULT_VAR} FALSE PARENT_SCOPE)
+    set(_entry "${XREPO_FETCH_CACHE_DIR}/${key}.cmake")
+    if ("${XREPO_FETCH_CACHE_DIR}" STREQUAL "" OR NOT EXISTS "${_entry}")
+        return()
+    endif ()
+
+    include("${_entry}")
+    foreach (_dir ${${package_name}_INCLUDE_DIRS} ${${package_name}_LIBRARY_DIRS})
+        if (NOT EXISTS "${_dir}")
+            message(STATUS "xrepo: ${_dir} no longer exists, ignoring the fetch cache for ${package_name}")
+            return()
+        endif ()
+    endforeach ()
+
+    set(${RESULT_VAR} TRUE PARENT_SCOPE)
+endfunction()
+
+function(_xrepo_fetch_cache_store package_name key)
+    if ("${XREPO_FETCH_CACHE_DIR}" STREQUAL "")
+        return()
+    endif ()
+
+    set(_vars ${_cache_xrepo_vars_${package_name}})
+    foreach (_compat_var INCLUDE_DIR LINK_DIR LIBRARIES)
+        if (DEFINED ${package_name}_${_compat_var})
+            list(APPEND _vars ${package_name}_${_compat_var})
+        endif ()
+    endforeach ()
+
+    set(_content "# xrepo fetch result for ${package_name}, generated by xrepo_package()\n")
+    foreach (_var ${_vars})
+        string(APPEND _content "set(${_var} [==[${${_var}}]==] CACHE INTERNAL \"\")\n")
+    endforeach ()
+    string(APPEND _content "set(_cache_xrepo_vars_${package_name} [==[${_cache_xrepo_vars_${package_name}}]==] CACHE INTERNAL \"\")\n")
+
+    # Write then rename, several build trees may configure at the same time
+    string(RANDOM LENGTH 8 _suffix)
+    set(_entry "${XREPO_FETCH_CACHE_DIR}/${key}.cmake")
+    file(WRITE "${_entry}.${_suffix}" "${_content}")
+    file(RENAME "${_entry}.${_suffix}" "${_entry}")
+endfunction()
+
 function(_xrepo_package_name package)
     # For find_package(pkg) to work, we need to set variable <pkg>_DIR to the
     # cmake module directory provided by the package. Thus we need to extract
@@ -635,6 +930,10 @@ macro(_xrepo_fetch_json)
         message(FATAL_ERROR "xrepo fetch --json failed, exit code: ${exit_code}")
     endif ()
 
+    _xrepo_parse_json()
+endmacro()
+
+macro(_xrepo_parse_json)
     # Loop over out most array for the json object.
     # The following code supports parsing the output of `xrepo fetch --deps`.
     # But pulling in the output of `--deps` is problematic because the dependent
@@ -801,6 +1100,10 @@ macro(_xrepo_fetch_cflags)
         message(FATAL_ERROR "xrepo fetch --cflags failed, exit code: ${exit_code}")
     endif ()
 
+    _xrepo_parse_cflags()
+endmacro()
+
+macro(_xrepo_parse_cflags)
     string(REGEX REPLACE "-I(.*)/include.*" "\\1" install_dir ${cflags_output})
 
     set(${package_name}_INCLUDE_DIRS "${install_dir}/include" CACHE INTERNAL "")
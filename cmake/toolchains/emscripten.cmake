@@ -1,10 +1,11 @@
 include_guard(DIRECTORY)
+include(${CMAKE_CURRENT_LIST_DIR}/emscripten/EmsdkManager.cmake)
 
-# First, try to set up EMSDK if it's not available
+# First, try to set up EMSDK if it's not available (installs EMSDK_VERSION to EMSDK_CACHE_DIR)
 if (NOT DEFINED ENV{EMSDK} OR NOT EXISTS "$ENV{EMSDK}")
-    # Include the EMSDK manager to install it automatically
-    include(${CMAKE_CURRENT_LIST_DIR}/emscripten/EmsdkManager.cmake)
     ensure_emsdk_available()
+elseif (EMSDK_EM_CACHE)
+    _use_prebuilt_em_cache("")
 endif ()
 
 # Ensure EMSDK is available and find the Emscripten installation
@@ -39,6 +40,15 @@ endif ()
 set(CMAKE_C_FLAGS_INIT "-pthread")
 set(CMAKE_CXX_FLAGS_INIT "-pthread")
 
+# The build doesn't see the environment of the configure, pass the system library cache on the command line
+if (DEFINED ENV{EM_CACHE} AND NOT "$ENV{EM_CACHE}" STREQUAL "")
+    string(APPEND CMAKE_C_FLAGS_INIT " --cache \"$ENV{EM_CACHE}\"")
+    string(APPEND CMAKE_CXX_FLAGS_INIT " --cache \"$ENV{EM_CACHE}\"")
+endif ()
+
+# Build the system libraries of the pthread and LTO variants up front when EMSDK_PREWARM is on
+prewarm_emscripten_cache()
+
 # Set default linker flags for WebAssembly
 set(CMAKE_EXE_LINKER_FLAGS_INIT "-s WASM=1")
 set(CMAKE_SHARED_LINKER_FLAGS_INIT "-s WASM=1")
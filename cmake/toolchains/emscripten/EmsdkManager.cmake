@@ -1,10 +1,17 @@
 include_guard(DIRECTORY)
 
 #
-# check if EMSDK is available and install it locally if needed
+# check if EMSDK is available and install it to the shared cache if needed
 # usage:
 # ensure_emsdk_available()
 #
+# Looks for EMSDK in this order:
+#   1. the EMSDK environment variable (emsdk_env, setup-emsdk in CI)
+#   2. ${PROJECT_SOURCE_DIR}/.emsdk, left by older versions of this script
+#   3. ${EMSDK_CACHE_DIR}/${EMSDK_VERSION}, shared by every checkout of the user or runner
+# and installs 3. when ENABLE_EMSDK_AUTO_INSTALL is on. The system library cache (EM_CACHE) is taken from
+# EMSDK_EM_CACHE or the EM_CACHE environment variable when set, otherwise it lives next to the installed version.
+#
 function(ensure_emsdk_available)
     # Check if EMSDK is already available and properly activated
     if (DEFINED ENV{EMSDK} AND EXISTS "$ENV{EMSDK}")
@@ -12,67 +19,198 @@ function(ensure_emsdk_available)
         find_program(EMCC_TEST emcc PATHS "$ENV{EMSDK}/upstream/emscripten" NO_DEFAULT_PATH)
         if (EMCC_TEST)
             message(STATUS "Found existing EMSDK at: $ENV{EMSDK}")
+            _use_prebuilt_em_cache("")
             set(EMSDK_ROOT "$ENV{EMSDK}" PARENT_SCOPE)
             return()
         else ()
-            message(STATUS "EMSDK found at $ENV{EMSDK} but compilers not accessible. Will install locally.")
+            message(STATUS "EMSDK found at $ENV{EMSDK} but compilers not accessible. Will install it to the cache.")
         endif ()
     endif ()
 
-    # Check if we have a local installation
-    set(LOCAL_EMSDK_DIR "${PROJECT_SOURCE_DIR}/.emsdk")
-    set(EMSDK_SCRIPT "${LOCAL_EMSDK_DIR}/emsdk")
-
-    if (CMAKE_HOST_WIN32)
-        set(EMSDK_SCRIPT "${EMSDK_SCRIPT}.bat")
-        set(EMSDK_ENV_SCRIPT "${LOCAL_EMSDK_DIR}/emsdk_env.bat")
-    else ()
-        set(EMSDK_ENV_SCRIPT "${LOCAL_EMSDK_DIR}/emsdk_env.sh")
-    endif ()
+    get_emsdk_install_dir(LOCAL_EMSDK_DIR)
+    _get_emsdk_script("${LOCAL_EMSDK_DIR}" EMSDK_SCRIPT)
 
-    if (EXISTS "${EMSDK_SCRIPT}")
-        message(STATUS "Found local EMSDK installation at: ${LOCAL_EMSDK_DIR}")
+    # A checkout's .emsdk was installed before the stamp existed
+    if (EXISTS "${LOCAL_EMSDK_DIR}/.cmake-installed" OR LOCAL_EMSDK_DIR STREQUAL "${PROJECT_SOURCE_DIR}/.emsdk")
+        message(STATUS "Found EMSDK installation at: ${LOCAL_EMSDK_DIR}")
 
-        # Activate the local EMSDK
+        # Activate the installed EMSDK
         _activate_local_emsdk("${LOCAL_EMSDK_DIR}")
         set(EMSDK_ROOT "${LOCAL_EMSDK_DIR}" PARENT_SCOPE)
         return()
     endif ()
 
     if (ENABLE_EMSDK_AUTO_INSTALL)
-        message(STATUS "EMSDK not found. Automatically installing it locally to ${LOCAL_EMSDK_DIR}")
+        message(STATUS "EMSDK not found. Automatically installing ${EMSDK_VERSION_VALUE} to ${LOCAL_EMSDK_DIR}")
     else ()
         message(FATAL_ERROR "EMSDK not found. Please install it manually or enable ENABLE_EMSDK_AUTO_INSTALL to download it automatically.")
     endif ()
 
-    # Create the directory
-    file(MAKE_DIRECTORY "${LOCAL_EMSDK_DIR}")
+    # Checkouts and CI jobs configuring in parallel share the directory, let one of them install
+    get_filename_component(_cache_dir "${LOCAL_EMSDK_DIR}" DIRECTORY)
+    file(MAKE_DIRECTORY "${_cache_dir}")
+    file(LOCK "${LOCAL_EMSDK_DIR}.lock" GUARD FUNCTION TIMEOUT 3600 RESULT_VARIABLE LOCK_RESULT)
+    if (NOT LOCK_RESULT EQUAL 0)
+        message(FATAL_ERROR "Failed to lock ${LOCAL_EMSDK_DIR}.lock: ${LOCK_RESULT}")
+    endif ()
 
-    # Clone EMSDK repository
-    find_package(Git QUIET)
-    if (NOT GIT_FOUND)
-        message(FATAL_ERROR "Git is required to download EMSDK. Please install Git first.")
+    # Another configure may have finished the install while this one waited for the lock
+    if (EXISTS "${LOCAL_EMSDK_DIR}/.cmake-installed")
+        message(STATUS "EMSDK ${EMSDK_VERSION_VALUE} was installed by another configure")
+        _activate_local_emsdk("${LOCAL_EMSDK_DIR}")
+        set(EMSDK_ROOT "${LOCAL_EMSDK_DIR}" PARENT_SCOPE)
+        return()
     endif ()
 
-    message(STATUS "Downloading EMSDK...")
-    execute_process(
-            COMMAND ${GIT_EXECUTABLE} clone --depth 1 https://github.com/emscripten-core/emsdk.git "${LOCAL_EMSDK_DIR}"
-            RESULT_VARIABLE GIT_RESULT
-            OUTPUT_QUIET
-            ERROR_VARIABLE GIT_ERROR
-    )
+    # Clone EMSDK repository, unless an interrupted install left it behind
+    if (NOT EXISTS "${EMSDK_SCRIPT}")
+        file(REMOVE_RECURSE "${LOCAL_EMSDK_DIR}")
+
+        find_package(Git QUIET)
+        if (NOT GIT_FOUND)
+            message(FATAL_ERROR "Git is required to download EMSDK. Please install Git first.")
+        endif ()
+
+        message(STATUS "Downloading EMSDK...")
+        execute_process(
+                COMMAND ${GIT_EXECUTABLE} clone --depth 1 https://github.com/emscripten-core/emsdk.git "${LOCAL_EMSDK_DIR}"
+                RESULT_VARIABLE GIT_RESULT
+                OUTPUT_QUIET
+                ERROR_VARIABLE GIT_ERROR
+        )
 
-    if (NOT GIT_RESULT EQUAL 0)
-        message(FATAL_ERROR "Failed to download EMSDK: ${GIT_ERROR}")
+        if (NOT GIT_RESULT EQUAL 0)
+            message(FATAL_ERROR "Failed to download EMSDK: ${GIT_ERROR}")
+        endif ()
     endif ()
 
-    # Install and activate latest EMSDK
-    _install_and_activate_emsdk("${LOCAL_EMSDK_DIR}")
+    # Install and activate the requested EMSDK version
+    _install_and_activate_emsdk("${LOCAL_EMSDK_DIR}" "${EMSDK_VERSION_VALUE}")
+    file(WRITE "${LOCAL_EMSDK_DIR}/.cmake-installed" "${EMSDK_VERSION_VALUE}\n")
     set(EMSDK_ROOT "${LOCAL_EMSDK_DIR}" PARENT_SCOPE)
 
     message(STATUS "EMSDK installed successfully at: ${LOCAL_EMSDK_DIR}")
 endfunction()
 
+#
+# usage:
+#   get_emsdk_install_dir(OUTPUT_VARIABLE)
+#
+# Sets OUTPUT_VARIABLE to the EMSDK directory used when the EMSDK environment variable is not set:
+# ${PROJECT_SOURCE_DIR}/.emsdk when an older install is there, ${EMSDK_CACHE_DIR}/${EMSDK_VERSION} otherwise.
+# EMSDK_CACHE_DIR defaults to the EMSDK_CACHE_DIR environment variable, then to %LOCALAPPDATA%/emsdk on Windows
+# and $XDG_CACHE_HOME/emsdk or ~/.cache/emsdk elsewhere. Also sets EMSDK_VERSION_VALUE in the caller.
+#
+function(get_emsdk_install_dir OUTPUT_VARIABLE)
+    set(_version "latest")
+    if (EMSDK_VERSION)
+        set(_version "${EMSDK_VERSION}")
+    endif ()
+    set(EMSDK_VERSION_VALUE "${_version}" PARENT_SCOPE)
+
+    _get_emsdk_script("${PROJECT_SOURCE_DIR}/.emsdk" _legacy_script)
+    if (EXISTS "${_legacy_script}")
+        set(${OUTPUT_VARIABLE} "${PROJECT_SOURCE_DIR}/.emsdk" PARENT_SCOPE)
+        return()
+    endif ()
+
+    if (EMSDK_CACHE_DIR)
+        set(_cache_dir "${EMSDK_CACHE_DIR}")
+    elseif (DEFINED ENV{EMSDK_CACHE_DIR} AND NOT "$ENV{EMSDK_CACHE_DIR}" STREQUAL "")
+        set(_cache_dir "$ENV{EMSDK_CACHE_DIR}")
+    elseif (CMAKE_HOST_WIN32 AND DEFINED ENV{LOCALAPPDATA})
+        set(_cache_dir "$ENV{LOCALAPPDATA}/emsdk")
+    elseif (DEFINED ENV{XDG_CACHE_HOME} AND NOT "$ENV{XDG_CACHE_HOME}" STREQUAL "")
+        set(_cache_dir "$ENV{XDG_CACHE_HOME}/emsdk")
+    elseif (DEFINED ENV{HOME})
+        set(_cache_dir "$ENV{HOME}/.cache/emsdk")
+    else ()
+        # No user directory (some service accounts), fall back to the checkout
+        set(_cache_dir "${PROJECT_SOURCE_DIR}/.emsdk-cache")
+    endif ()
+    file(TO_CMAKE_PATH "${_cache_dir}" _cache_dir)
+
+    set(${OUTPUT_VARIABLE} "${_cache_dir}/${_version}" PARENT_SCOPE)
+endfunction()
+
+#
+# usage:
+#   prewarm_emscripten_cache()
+#
+# Builds the system libraries (embuilder build MINIMAL) of every variant in EMSDK_PREWARM_VARIANTS into the
+# Emscripten cache, when EMSDK_PREWARM or the EMSDK_PREWARM environment variable is on. The toolchain file calls it
+# once EMSDK is activated, so the first compile doesn't build libc, libc++ and the rest on demand. Variants:
+#   default       - single threaded libraries
+#   pthreads      - the -mt libraries every target links, this toolchain compiles with -pthread
+#                   (register_emscripten(PTHREAD) needs the same ones)
+#   lto           - the LTO libraries register_emscripten(OPTIMIZE ...) links in non-Debug configurations
+#   pthreads-lto  - both
+# SIMD doesn't need its own variant, the system libraries are the same with and without -msimd128.
+# A stamp per variant is kept in the cache, Emscripten clears it with the cache when its version changes.
+#
+function(prewarm_emscripten_cache)
+    if (NOT EMSDK_PREWARM AND NOT "$ENV{EMSDK_PREWARM}")
+        return()
+    endif ()
+
+    if (NOT DEFINED ENV{EMSDK})
+        message(FATAL_ERROR "prewarm_emscripten_cache: EMSDK is not activated, call ensure_emsdk_available() first")
+    endif ()
+    set(EMSCRIPTEN_ROOT "$ENV{EMSDK}/upstream/emscripten")
+    if (CMAKE_HOST_WIN32)
+        set(EMBUILDER "${EMSCRIPTEN_ROOT}/embuilder.bat")
+    else ()
+        set(EMBUILDER "${EMSCRIPTEN_ROOT}/embuilder")
+    endif ()
+    if (NOT EXISTS "${EMBUILDER}")
+        message(WARNING "embuilder not found at ${EMBUILDER}, the Emscripten cache is not prewarmed")
+        return()
+    endif ()
+
+    if (DEFINED ENV{EM_CACHE} AND NOT "$ENV{EM_CACHE}" STREQUAL "")
+        set(_em_cache "$ENV{EM_CACHE}")
+    else ()
+        set(_em_cache "${EMSCRIPTEN_ROOT}/cache")
+    endif ()
+
+    set(_variants "pthreads;pthreads-lto")
+    if (DEFINED EMSDK_PREWARM_VARIANTS)
+        set(_variants ${EMSDK_PREWARM_VARIANTS})
+    endif ()
+
+    foreach (_variant ${_variants})
+        if (_variant STREQUAL "default")
+            set(_flags "")
+        elseif (_variant STREQUAL "pthreads")
+            set(_flags --pthreads)
+        elseif (_variant STREQUAL "lto")
+            set(_flags --lto)
+        elseif (_variant STREQUAL "pthreads-lto")
+            set(_flags --pthreads --lto)
+        else ()
+            message(FATAL_ERROR "Unknown EMSDK_PREWARM_VARIANTS entry '${_variant}' (expected default, pthreads, lto or pthreads-lto)")
+        endif ()
+
+        set(_stamp "${_em_cache}/cmake-prewarm-${_variant}.stamp")
+        if (EXISTS "${_stamp}")
+            continue()
+        endif ()
+
+        message(STATUS "** Prewarming the Emscripten cache (${_variant} system libraries)...")
+        execute_process(
+                COMMAND "${EMBUILDER}" build MINIMAL ${_flags}
+                RESULT_VARIABLE PREWARM_RESULT
+                OUTPUT_VARIABLE PREWARM_OUTPUT
+                ERROR_VARIABLE PREWARM_OUTPUT
+        )
+        if (NOT PREWARM_RESULT EQUAL 0)
+            message(WARNING "embuilder build MINIMAL ${_flags} failed, the libraries are built on first use:\n${PREWARM_OUTPUT}")
+            continue()
+        endif ()
+        file(WRITE "${_stamp}" "${_variant}\n")
+    endforeach ()
+endfunction()
+
 # Get the EMSDK toolchain file path
 function(get_emsdk_toolchain_file output_var)
     ensure_emsdk_available()
@@ -80,7 +218,8 @@ function(get_emsdk_toolchain_file output_var)
     if (DEFINED ENV{EMSDK})
         set(TOOLCHAIN_FILE "$ENV{EMSDK}/upstream/emscripten/cmake/Modules/Platform/Emscripten.cmake")
     else ()
-        set(TOOLCHAIN_FILE "${PROJECT_SOURCE_DIR}/.emsdk/upstream/emscripten/cmake/Modules/Platform/Emscripten.cmake")
+        get_emsdk_install_dir(EMSDK_DIR)
+        set(TOOLCHAIN_FILE "${EMSDK_DIR}/upstream/emscripten/cmake/Modules/Platform/Emscripten.cmake")
     endif ()
 
     if (NOT EXISTS "${TOOLCHAIN_FILE}")
@@ -100,7 +239,7 @@ function(verify_and_setup_emscripten_compilers)
     if (DEFINED ENV{EMSDK})
         set(EMSDK_DIR "$ENV{EMSDK}")
     else ()
-        set(EMSDK_DIR "${PROJECT_SOURCE_DIR}/.emsdk")
+        get_emsdk_install_dir(EMSDK_DIR)
     endif ()
 
     # Set up the toolchain file FIRST
@@ -143,20 +282,16 @@ function(verify_and_setup_emscripten_compilers)
 endfunction()
 
 #
-# install and activate EMSDK in the given directory
+# install and activate the given EMSDK version in the given directory
 #
-function(_install_and_activate_emsdk emsdk_dir)
-    set(EMSDK_SCRIPT "${emsdk_dir}/emsdk")
-
-    if (CMAKE_HOST_WIN32)
-        set(EMSDK_SCRIPT "${EMSDK_SCRIPT}.bat")
-    endif ()
+function(_install_and_activate_emsdk emsdk_dir version)
+    _get_emsdk_script("${emsdk_dir}" EMSDK_SCRIPT)
 
-    message(STATUS "Installing latest Emscripten...")
+    message(STATUS "Installing Emscripten ${version}...")
 
-    # Install latest version
+    # Install the requested version
     execute_process(
-            COMMAND "${EMSDK_SCRIPT}" install latest
+            COMMAND "${EMSDK_SCRIPT}" install ${version}
             WORKING_DIRECTORY "${emsdk_dir}"
             RESULT_VARIABLE INSTALL_RESULT
             OUTPUT_VARIABLE INSTALL_OUTPUT
@@ -168,9 +303,9 @@ function(_install_and_activate_emsdk emsdk_dir)
         message(FATAL_ERROR "Failed to install EMSDK: ${INSTALL_ERROR}")
     endif ()
 
-    # Activate latest version
+    # Activate the requested version
     execute_process(
-            COMMAND "${EMSDK_SCRIPT}" activate latest
+            COMMAND "${EMSDK_SCRIPT}" activate ${version}
             WORKING_DIRECTORY "${emsdk_dir}"
             RESULT_VARIABLE ACTIVATE_RESULT
             OUTPUT_VARIABLE ACTIVATE_OUTPUT
@@ -247,8 +382,8 @@ function(_activate_local_emsdk emsdk_dir)
     # Set Emscripten-specific environment variables
     set(ENV{EMSCRIPTEN} "${EMSCRIPTEN_ROOT}")
     set(ENV{EM_CONFIG} "${emsdk_dir}/.emscripten")
-    set(ENV{EM_CACHE} "${emsdk_dir}/.emscripten_cache")
     set(ENV{EM_PORTS} "${emsdk_dir}/.emscripten_ports")
+    _use_prebuilt_em_cache("${emsdk_dir}/.emscripten_cache")
 
     message(STATUS "Local EMSDK activated:")
     message(STATUS "  - EMSDK: ${emsdk_dir}")
@@ -259,4 +394,28 @@ function(_activate_local_emsdk emsdk_dir)
     if (PYTHON_PATH)
         message(STATUS "  - Python: ${PYTHON_PATH}")
     endif ()
+    message(STATUS "  - Cache: $ENV{EM_CACHE}")
+endfunction()
+
+#
+# point EM_CACHE at EMSDK_EM_CACHE, else keep the EM_CACHE environment variable, else use default_dir (if not empty)
+#
+function(_use_prebuilt_em_cache default_dir)
+    if (EMSDK_EM_CACHE)
+        file(TO_CMAKE_PATH "${EMSDK_EM_CACHE}" _em_cache)
+        set(ENV{EM_CACHE} "${_em_cache}")
+    elseif ((NOT DEFINED ENV{EM_CACHE} OR "$ENV{EM_CACHE}" STREQUAL "") AND NOT default_dir STREQUAL "")
+        set(ENV{EM_CACHE} "${default_dir}")
+    endif ()
+endfunction()
+
+#
+# get the emsdk script of the given EMSDK directory
+#
+function(_get_emsdk_script emsdk_dir output_var)
+    if (CMAKE_HOST_WIN32)
+        set(${output_var} "${emsdk_dir}/emsdk.bat" PARENT_SCOPE)
+    else ()
+        set(${output_var} "${emsdk_dir}/emsdk" PARENT_SCOPE)
+    endif ()
 endfunction()
@@ -0,0 +1,120 @@
+#include <benchmark/benchmark.h>
+#include "math_utils.hpp"
+#include "math_utils_batch.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <vector>
+
+namespace
+{
+    constexpr int LargestPrimeCandidate = 1 << 20;
+
+    std::vector<int> MakeInputs(std::size_t count, int largest)
+    {
+        // Fixed seed, every run and the baseline measure the same inputs
+        std::mt19937 engine(42);
+        std::uniform_int_distribution<int> distribution(0, largest);
+
+        std::vector<int> inputs(count);
+        for (int& value : inputs)
+        {
+            value = distribution(engine);
+        }
+        return inputs;
+    }
+
+    void BM_IsPrimeScalar(benchmark::State& state)
+    {
+        const auto count = static_cast<std::size_t>(state.range(0));
+        const auto inputs = MakeInputs(count, LargestPrimeCandidate);
+        auto results = std::make_unique<bool[]>(count);
+
+        for (auto _ : state)
+        {
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                results[i] = math_utils::IsPrime(inputs[i]);
+            }
+            benchmark::DoNotOptimize(results.get());
+            benchmark::ClobberMemory();
+        }
+        state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(count));
+    }
+
+    void BM_IsPrimeBatch(benchmark::State& state)
+    {
+        const auto count = static_cast<std::size_t>(state.range(0));
+        const auto inputs = MakeInputs(count, LargestPrimeCandidate);
+        auto results = std::make_unique<bool[]>(count);
+
+        // A fast wrong answer is not a result
+        math_utils::IsPrimeBatch(inputs, { results.get(), count });
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            if (results[i] != math_utils::IsPrime(inputs[i]))
+            {
+                state.SkipWithError("IsPrimeBatch disagrees with IsPrime");
+                return;
+            }
+        }
+
+        for (auto _ : state)
+        {
+            math_utils::IsPrimeBatch(inputs, { results.get(), count });
+            benchmark::DoNotOptimize(results.get());
+            benchmark::ClobberMemory();
+        }
+        state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(count));
+    }
+
+    void BM_FactorialScalar(benchmark::State& state)
+    {
+        const auto count = static_cast<std::size_t>(state.range(0));
+        const auto inputs = MakeInputs(count, math_utils::MaxFactorial);
+        std::vector<long long> results(count);
+
+        for (auto _ : state)
+        {
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                results[i] = math_utils::Factorial(inputs[i]);
+            }
+            benchmark::DoNotOptimize(results.data());
+            benchmark::ClobberMemory();
+        }
+        state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(count));
+    }
+
+    void BM_FactorialBatch(benchmark::State& state)
+    {
+        const auto count = static_cast<std::size_t>(state.range(0));
+        const auto inputs = MakeInputs(count, math_utils::MaxFactorial);
+        std::vector<long long> results(count);
+
+        math_utils::FactorialBatch(inputs, results);
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            if (results[i] != math_utils::Factorial(inputs[i]))
+            {
+                state.SkipWithError("FactorialBatch disagrees with Factorial");
+                return;
+            }
+        }
+
+        for (auto _ : state)
+        {
+            math_utils::FactorialBatch(inputs, results);
+            benchmark::DoNotOptimize(results.data());
+            benchmark::ClobberMemory();
+        }
+        state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(count));
+    }
+}
+
+// The sieve only pays off once enough values share it, the small sizes show where that starts
+BENCHMARK(BM_IsPrimeScalar)->RangeMultiplier(16)->Range(1 << 8, 1 << 16);
+BENCHMARK(BM_IsPrimeBatch)->RangeMultiplier(16)->Range(1 << 8, 1 << 16);
+BENCHMARK(BM_FactorialScalar)->RangeMultiplier(16)->Range(1 << 8, 1 << 16);
+BENCHMARK(BM_FactorialBatch)->RangeMultiplier(16)->Range(1 << 8, 1 << 16);
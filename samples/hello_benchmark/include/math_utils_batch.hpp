@@ -0,0 +1,68 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <span>
+#include <stdexcept>
+
+namespace math_utils
+{
+    /**
+     * @brief Largest n whose factorial fits in a long long
+     */
+    inline constexpr int MaxFactorial = 20;
+
+    /**
+     * @brief Factorials of 0 to MaxFactorial, computed at compile time
+     */
+    inline constexpr std::array<long long, MaxFactorial + 1> FactorialTable = []
+    {
+        std::array<long long, MaxFactorial + 1> table{};
+        table[0] = 1;
+        for (std::size_t i = 1; i < table.size(); ++i)
+        {
+            table[i] = table[i - 1] * static_cast<long long>(i);
+        }
+        return table;
+    }();
+
+    /**
+     * @brief Calculate factorial with a table lookup
+     * @param n Integer from 0 to MaxFactorial
+     * @return Factorial of n
+     * @throws std::invalid_argument if n is negative
+     * @throws std::overflow_error if n is greater than MaxFactorial
+     */
+    constexpr long long FactorialLookup(int n)
+    {
+        if (n < 0)
+        {
+            throw std::invalid_argument("Factorial is not defined for negative numbers");
+        }
+        if (n > MaxFactorial)
+        {
+            throw std::overflow_error("Factorial does not fit in a long long");
+        }
+        return FactorialTable[static_cast<std::size_t>(n)];
+    }
+
+    /**
+     * @brief Check many numbers for primality at once
+     * @param values Numbers to check
+     * @param results Receives IsPrime(values[i]) at index i
+     * @throws std::invalid_argument if the spans differ in size
+     *
+     * Uses a sieve of Eratosthenes up to the largest value when that is cheaper
+     * than trial division of every value, IsPrime() otherwise.
+     */
+    void IsPrimeBatch(std::span<const int> values, std::span<bool> results);
+
+    /**
+     * @brief Calculate many factorials at once
+     * @param values Integers from 0 to MaxFactorial
+     * @param results Receives Factorial(values[i]) at index i
+     * @throws std::invalid_argument if the spans differ in size or a value is negative
+     * @throws std::overflow_error if a value is greater than MaxFactorial
+     */
+    void FactorialBatch(std::span<const int> values, std::span<long long> results);
+}
@@ -0,0 +1,87 @@
+#include "math_utils_batch.hpp"
+#include "math_utils.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace math_utils
+{
+    namespace
+    {
+        // 16 MiB of sieve at most, larger values are checked one by one
+        constexpr int SieveLimit = 1 << 24;
+
+        std::vector<std::uint8_t> BuildSieve(int limit)
+        {
+            // One byte per number instead of std::vector<bool>, so lookups need no bit twiddling
+            std::vector<std::uint8_t> sieve(static_cast<std::size_t>(limit) + 1, 1);
+            sieve[0] = 0;
+            if (limit >= 1)
+            {
+                sieve[1] = 0;
+            }
+            const auto last = static_cast<std::size_t>(limit);
+            for (std::size_t i = 2; i * i <= last; ++i)
+            {
+                if (sieve[i])
+                {
+                    for (std::size_t multiple = i * i; multiple <= last; multiple += i)
+                    {
+                        sieve[multiple] = 0;
+                    }
+                }
+            }
+            return sieve;
+        }
+    }
+
+    void IsPrimeBatch(std::span<const int> values, std::span<bool> results)
+    {
+        if (values.size() != results.size())
+        {
+            throw std::invalid_argument("IsPrimeBatch needs one result per value");
+        }
+        if (values.empty())
+        {
+            return;
+        }
+
+        const int largest = *std::max_element(values.begin(), values.end());
+
+        // The sieve costs about one step per number up to the largest value,
+        // trial division about sqrt(value) steps per value
+        const bool use_sieve = largest <= SieveLimit &&
+                               static_cast<std::size_t>(largest) / 64 <= values.size();
+        if (!use_sieve)
+        {
+            std::transform(values.begin(), values.end(), results.begin(), IsPrime);
+            return;
+        }
+
+        const auto sieve = BuildSieve(std::max(largest, 1));
+        for (std::size_t i = 0; i < values.size(); ++i)
+        {
+            const int value = values[i];
+            results[i] = value >= 0 && sieve[static_cast<std::size_t>(value)] != 0;
+        }
+    }
+
+    void FactorialBatch(std::span<const int> values, std::span<long long> results)
+    {
+        if (values.size() != results.size())
+        {
+            throw std::invalid_argument("FactorialBatch needs one result per value");
+        }
+
+        // Validate first, so the lookup loop has no branches and can be vectorized
+        for (const int value : values)
+        {
+            FactorialLookup(value);
+        }
+        for (std::size_t i = 0; i < values.size(); ++i)
+        {
+            results[i] = FactorialTable[static_cast<std::size_t>(values[i])];
+        }
+    }
+}
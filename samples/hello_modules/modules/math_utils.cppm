@@ -0,0 +1,108 @@
+module;
+
+#ifndef CXX_IMPORT_STD
+#include <stdexcept>
+#endif
+
+export module math_utils;
+
+#ifdef CXX_IMPORT_STD
+import std;
+#endif
+
+export namespace math_utils
+{
+    /**
+     * @brief Add two integers
+     * @param a First integer
+     * @param b Second integer
+     * @return Sum of a and b
+     */
+    int Add(int a, int b)
+    {
+        return a + b;
+    }
+
+    /**
+     * @brief Subtract two integers
+     * @param a First integer
+     * @param b Second integer
+     * @return Difference of a and b
+     */
+    int Subtract(int a, int b)
+    {
+        return a - b;
+    }
+
+    /**
+     * @brief Multiply two integers
+     * @param a First integer
+     * @param b Second integer
+     * @return Product of a and b
+     */
+    int Multiply(int a, int b)
+    {
+        return a * b;
+    }
+
+    /**
+     * @brief Divide two integers
+     * @param a Dividend
+     * @param b Divisor
+     * @return Quotient of a and b
+     * @throws std::invalid_argument if b is zero
+     */
+    int Divide(int a, int b)
+    {
+        if (b == 0)
+        {
+            throw std::invalid_argument("Division by zero is not allowed");
+        }
+        return a / b;
+    }
+
+    /**
+     * @brief Check if a number is prime
+     * @param n Number to check
+     * @return true if n is prime, false otherwise
+     */
+    bool IsPrime(int n)
+    {
+        if (n < 2)
+            return false;
+        if (n == 2)
+            return true;
+        if (n % 2 == 0)
+            return false;
+
+        for (int i = 3; i * i <= n; i += 2)
+        {
+            if (n % i == 0)
+                return false;
+        }
+        return true;
+    }
+
+    /**
+     * @brief Calculate factorial
+     * @param n Non-negative integer
+     * @return Factorial of n
+     * @throws std::invalid_argument if n is negative
+     */
+    long long Factorial(int n)
+    {
+        if (n < 0)
+        {
+            throw std::invalid_argument("Factorial is not defined for negative numbers");
+        }
+        if (n == 0 || n == 1)
+            return 1;
+
+        long long result = 1;
+        for (int i = 2; i <= n; ++i)
+        {
+            result *= i;
+        }
+        return result;
+    }
+}
@@ -0,0 +1,42 @@
+#ifdef CXX_IMPORT_STD
+import std;
+#else
+#include <algorithm>
+#include <iostream>
+#include <map>
+#include <numeric>
+#include <ranges>
+#include <string>
+#include <vector>
+#endif
+
+import math_utils;
+
+int main()
+{
+    std::vector<int> numbers(20);
+    std::iota(numbers.begin(), numbers.end(), 1);
+
+    std::map<std::string, std::vector<int>> groups;
+    for (int n : numbers)
+    {
+        groups[math_utils::IsPrime(n) ? "primes" : "others"].push_back(n);
+    }
+
+    for (const auto& [name, values] : groups)
+    {
+        int sum = std::accumulate(values.begin(), values.end(), 0, math_utils::Add);
+        std::cout << name << ": " << values.size() << " numbers, sum " << sum << std::endl;
+    }
+
+    auto squares = numbers | std::views::take(5) | std::views::transform([](int n) { return math_utils::Multiply(n, n); });
+    std::cout << "squares:";
+    std::ranges::for_each(squares, [](int n) { std::cout << ' ' << n; });
+    std::cout << std::endl;
+
+    std::cout << "10! = " << math_utils::Factorial(10) << std::endl;
+#ifdef CXX_IMPORT_STD
+    std::cout << "Built with import std" << std::endl;
+#endif
+    return 0;
+}
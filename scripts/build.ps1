@@ -53,6 +53,13 @@
     information. Useful for debugging build issues.
     Default: false
 
+.PARAMETER ProfileConfigure
+    Profile the configure step: CMake writes a trace of every command it ran to
+    {build directory}/configure-profile.json (--profiling-format=google-trace), open it in
+    chrome://tracing or https://ui.perfetto.dev. Sets CONFIGURE_QUIET=ON so the per-target
+    output does not skew the timings.
+    Default: false
+
 .PARAMETER ExtraArgs
     Additional arguments to pass directly to CMake commands. Useful for passing
     custom variables or options that aren't covered by other parameters.
@@ -76,6 +83,12 @@
     Build with Clang compiler and verbose output.
     Good for testing with different compilers or debugging build issues.
 
+.EXAMPLE
+    .\scripts\build.ps1 -Preset unixlike-x64-gcc-debug -ProfileConfigure
+
+    Build and write out/build/unixlike-x64-gcc-debug/configure-profile.json, showing where
+    the configure step spends its time.
+
 .EXAMPLE
     .\scripts\build.ps1 -Preset unixlike-gcc-release -Jobs 16
     
@@ -100,6 +113,7 @@ param(
     [string]$BuildDir = "out",
     [int]$Jobs = 0,
     [switch]$VerboseOutput,
+    [switch]$ProfileConfigure,
     [string[]]$ExtraArgs = @()
 )
 
@@ -181,6 +195,12 @@ try {
     
     $ConfigCmd = @("cmake", "-S", ".", "-B", $BuildOutputDir, "--preset", $Preset)
     $ConfigCmd += $ConfigArgs
+
+    if ($ProfileConfigure) {
+        $ProfileOutput = Join-Path $BuildOutputDir "configure-profile.json"
+        $ConfigCmd += @("--profiling-output=$ProfileOutput", "--profiling-format=google-trace", "-DCONFIGURE_QUIET=ON")
+        Write-Host "Configure profile: $ProfileOutput" -ForegroundColor Yellow
+    }
     
     if ($VerboseOutput) {
         Write-Host "Command: $($ConfigCmd -join ' ')" -ForegroundColor DarkGray